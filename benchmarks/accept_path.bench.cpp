@@ -0,0 +1,70 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "support/harness.h"
+#include "../src/http/http.h"
+
+/*
+Measures what accepting a connection costs. First the handler every
+accepted connection gets is constructed in a tight loop, then short lived
+connections are opened against a running server, each sending a single
+request and waiting for the server to close it.
+
+    bench_accept_path --backend=epoll --handlers=100000 --connections=10000
+*/
+
+int main(int argc, char* argv[])
+{
+    using namespace nimlib::Benchmarks;
+    using nimlib::Server::Handlers::Http::HttpHandler;
+    using clock = std::chrono::steady_clock;
+
+    static const std::string port{ argument(argc, argv, "port", "8092") };
+    auto backend = argument(argc, argv, "backend", "epoll");
+    int handler_count = std::stoi(argument(argc, argv, "handlers", "100000"));
+    int connection_count = std::stoi(argument(argc, argv, "connections", "10000"));
+
+    std::vector<std::shared_ptr<HttpHandler>> handlers;
+    handlers.reserve(handler_count);
+
+    auto start = clock::now();
+    for (int i = 0; i < handler_count; i++)
+    {
+        handlers.push_back(std::make_shared<HttpHandler>());
+    }
+    auto handler_time = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    handlers.clear();
+
+    raise_file_limit();
+    start_server(backend, port);
+
+    const std::string request{ "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n" };
+    int served{};
+
+    start = clock::now();
+    for (int i = 0; i < connection_count; i++)
+    {
+        int client = connect_client(port);
+        if (client < 0) continue;
+
+        if (send_all(client, request) && read_until_closed(client) > 0) served++;
+        close(client);
+    }
+    auto connection_time = std::chrono::duration<double>(clock::now() - start).count();
+
+    std::printf(
+        "backend=%s handler_ns=%.0f connections=%d served=%d connections_per_second=%.0f connection_us=%.1f\n",
+        backend.c_str(),
+        handler_time / handler_count,
+        connection_count,
+        served,
+        connection_count / connection_time,
+        1e6 * connection_time / connection_count
+    );
+
+    std::fflush(stdout);
+    std::_Exit(0);
+}
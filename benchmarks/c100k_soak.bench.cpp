@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <poll.h>
+
+#include "support/harness.h"
+
+/*
+Opens a hundred thousand concurrent connections, holds them open for the
+soak period and reports how much memory the server needs per connection,
+along with how many connections were lost during the soak.
+
+Connections come from several loopback source addresses, a single one
+runs out of ephemeral ports long before the target is reached. The file
+descriptor limit must allow two descriptors per connection.
+
+    bench_c100k_soak --backend=epoll --connections=100000 --seconds=30
+*/
+
+int main(int argc, char* argv[])
+{
+    using namespace nimlib::Benchmarks;
+
+    static const std::string port{ argument(argc, argv, "port", "8091") };
+    auto backend = argument(argc, argv, "backend", "epoll");
+    int connection_count = std::stoi(argument(argc, argv, "connections", "100000"));
+    int seconds = std::stoi(argument(argc, argv, "seconds", "30"));
+    const int CONNECTIONS_PER_SOURCE_ADDRESS = 20'000;
+    const uint32_t LOOPBACK = 0x7f000001;
+
+    raise_file_limit();
+    start_server(backend, port);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    long baseline_memory = resident_memory();
+
+    std::vector<int> clients;
+    clients.reserve(connection_count);
+    for (int i = 0; i < connection_count; i++)
+    {
+        int client = connect_client(port, LOOPBACK + i / CONNECTIONS_PER_SOURCE_ADDRESS);
+        if (client < 0) break;
+        clients.push_back(client);
+    }
+
+    // The server is done accepting once its memory stops growing.
+    long memory = resident_memory();
+    while (true)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        long now = resident_memory();
+        if (now == memory) break;
+        memory = now;
+    }
+
+    long peak_memory = memory;
+    for (int i = 0; i < seconds; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        peak_memory = std::max(peak_memory, resident_memory());
+    }
+
+    // A connection the server has given up on reads as closed.
+    std::vector<pollfd> sockets(clients.size());
+    for (int i = 0; i < clients.size(); i++) sockets[i] = { clients[i], POLLIN, 0 };
+    int dropped = poll(sockets.data(), sockets.size(), 0);
+
+    long per_connection = clients.empty() ? 0 : (memory - baseline_memory) / static_cast<long>(clients.size());
+    std::printf(
+        "backend=%s connections=%zu soak_seconds=%d baseline_rss_mb=%.1f rss_mb=%.1f peak_rss_mb=%.1f bytes_per_connection=%ld dropped=%d\n",
+        backend.c_str(),
+        clients.size(),
+        seconds,
+        baseline_memory / 1048576.0,
+        memory / 1048576.0,
+        peak_memory / 1048576.0,
+        per_connection,
+        dropped
+    );
+
+    std::fflush(stdout);
+    std::_Exit(0);
+}
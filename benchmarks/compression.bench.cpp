@@ -0,0 +1,103 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include "support/harness.h"
+#include "../src/utils/compression.h"
+
+/*
+Weighs CPU against ratio for each compression level response compression
+can be set to. For every gzip level it reports how fast a metrics-like text
+report is compressed, in MB of input per second, and how small it gets, once
+compressed whole and once in pieces flushed one at a time, as a body
+streamed with RECALL is. gzip is the only codec the server is built with, a
+build without zlib reports nothing.
+
+    bench_compression --size=65536 --piece=8192 --iterations=2000
+*/
+
+namespace
+{
+    // Lines like the ones in the /metrics report.
+    std::string report_text(size_t size)
+    {
+        std::string text{};
+        for (size_t row = 0; text.size() < size; row++)
+        {
+            text += "metric=time_to_response aggregation=avg window=" + std::to_string(row % 10)
+                + " value=" + std::to_string(row * 7919 % 100003) + "\n";
+        }
+        text.resize(size);
+        return text;
+    }
+
+    template <typename F>
+    double megabytes_per_second(size_t bytes, int iterations, F compress_once)
+    {
+        using clock = std::chrono::steady_clock;
+
+        compress_once();
+        auto start = clock::now();
+        for (int i = 0; i < iterations; i++) compress_once();
+        auto seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+        return static_cast<double>(bytes) * iterations / seconds / 1e6;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace nimlib::Benchmarks;
+    using nimlib::Server::Utils::GzipStream;
+
+    const size_t size = std::stoul(argument(argc, argv, "size", "65536"));
+    const size_t piece = std::stoul(argument(argc, argv, "piece", "8192"));
+    const int iterations = std::stoi(argument(argc, argv, "iterations", "2000"));
+
+    if (!nimlib::Server::Utils::gzip_available())
+    {
+        std::printf("built without zlib, nothing to measure\n");
+        return 0;
+    }
+
+    const std::string text{ report_text(size) };
+    const std::string_view input{ text };
+    std::string compressed{};
+
+    for (int level = 1; level <= 9; level++)
+    {
+        GzipStream stream{ level };
+
+        size_t whole_bytes{};
+        auto whole = megabytes_per_second(size, iterations, [&]() {
+            compressed.clear();
+            stream.finish(input, compressed);
+            whole_bytes = compressed.size();
+            });
+
+        size_t pieces_bytes{};
+        auto pieces = megabytes_per_second(size, iterations, [&]() {
+            compressed.clear();
+            size_t at = 0;
+            for (; at + piece < input.size(); at += piece) stream.write(input.substr(at, piece), compressed, true);
+            stream.finish(input.substr(at), compressed);
+            pieces_bytes = compressed.size();
+            });
+
+        std::printf(
+            "codec=gzip level=%d input_bytes=%zu whole_mbps=%.1f whole_ratio=%.2f pieces_of=%zu pieces_mbps=%.1f pieces_ratio=%.2f\n",
+            level,
+            size,
+            whole,
+            static_cast<double>(size) / whole_bytes,
+            piece,
+            pieces,
+            static_cast<double>(size) / pieces_bytes
+        );
+        std::fflush(stdout);
+    }
+
+    std::_Exit(0);
+}
@@ -0,0 +1,131 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "support/harness.h"
+#include "../src/http/parser.h"
+#include "../src/utils/scan.h"
+
+/*
+Reports how fast each scan level gets through header heavy requests, in GB
+of request head per second: finding every line end, finding the colon and
+checking the name of every header, lower casing every name (in GB of names),
+and the whole of RequestParser::parse.
+
+    bench_header_scan --headers=60 --iterations=100000
+*/
+
+namespace
+{
+    std::string header_heavy_request(int header_count)
+    {
+        const std::vector<std::pair<std::string, std::string>> headers{
+            {"Host", "www.example.com"},
+            {"User-Agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36"},
+            {"Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8"},
+            {"Accept-Language", "en-GB,en-US;q=0.9,en;q=0.8"},
+            {"Accept-Encoding", "gzip, deflate, br, zstd"},
+            {"Cookie", "session=4f2a9c1e7b3d5a6f8e9d0c1b2a3f4e5d; theme=dark; _ga=GA1.1.1234567890.1700000000"},
+            {"X-Forwarded-For", "203.0.113.195, 70.41.3.18, 150.172.238.178"},
+            {"X-Request-Id", "f058ebd6-02f7-4d3f-942e-904344e8cde5"},
+            {"Sec-Fetch-Site", "same-origin"},
+            {"Traceparent", "00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01"},
+        };
+
+        std::string request{ "GET /api/v2/catalogue/items?page=3&sort=price HTTP/1.1\r\n" };
+        for (int i = 0; i < header_count; i++)
+        {
+            const auto& [name, value] = headers[i % headers.size()];
+            request += name + (i < static_cast<int>(headers.size()) ? "" : "-" + std::to_string(i)) + ": " + value + "\r\n";
+        }
+        request += "\r\n";
+
+        return request;
+    }
+
+    template <typename F>
+    double gigabytes_per_second(size_t bytes, int iterations, F scan_once)
+    {
+        using clock = std::chrono::steady_clock;
+
+        scan_once();
+        auto start = clock::now();
+        for (int i = 0; i < iterations; i++) scan_once();
+        auto seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+        return static_cast<double>(bytes) * iterations / seconds / 1e9;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace nimlib::Benchmarks;
+    using nimlib::Server::Handlers::Http::RequestParser;
+    namespace Scan = nimlib::Server::Utils::Scan;
+
+    int header_count = std::stoi(argument(argc, argv, "headers", "60"));
+    int iterations = std::stoi(argument(argc, argv, "iterations", "100000"));
+
+    const std::string request{ header_heavy_request(header_count) };
+    const std::string_view input{ request };
+    std::string lowered(request.size(), '\0');
+    RequestParser parser;
+    long checksum{};
+
+    parser.parse(input);
+    size_t name_bytes{};
+    for (const auto& header : parser.headers()) name_bytes += header.name.size();
+
+    for (auto level : { Scan::Level::SCALAR, Scan::Level::SSE2, Scan::Level::AVX2 })
+    {
+        if (!Scan::use_level(level)) continue;
+
+        auto line_ends = gigabytes_per_second(request.size(), iterations, [&]() {
+            for (size_t at = Scan::find_line_end(input); at != std::string_view::npos; at = Scan::find_line_end(input, at + 2))
+            {
+                checksum += at;
+            }
+            });
+
+        auto names = gigabytes_per_second(request.size(), iterations, [&]() {
+            for (size_t begin = input.find('\n') + 1, end; (end = Scan::find_line_end(input, begin)) != begin; begin = end + 2)
+            {
+                auto line = input.substr(begin, end - begin);
+                auto colon = Scan::find_char(line, ':');
+                checksum += Scan::is_token(line.substr(0, colon)) ? colon : 0;
+            }
+            });
+
+        auto lower = gigabytes_per_second(name_bytes, iterations, [&]() {
+            for (const auto& header : parser.headers())
+            {
+                Scan::to_lower(header.name, lowered.data());
+                checksum += lowered[0];
+            }
+            });
+
+        RequestParser level_parser;
+        auto parse = gigabytes_per_second(request.size(), iterations, [&]() {
+            level_parser.reset();
+            checksum += level_parser.parse(input) == RequestParser::Result::COMPLETE ? level_parser.headers().size() : 0;
+            });
+
+        std::printf(
+            "level=%s head_bytes=%zu headers=%d line_ends_gbps=%.2f header_names_gbps=%.2f lower_case_gbps=%.2f parse_gbps=%.2f\n",
+            Scan::level_name(level),
+            request.size(),
+            header_count,
+            line_ends,
+            names,
+            lower,
+            parse
+        );
+    }
+
+    std::printf("checksum=%ld\n", checksum);
+    std::fflush(stdout);
+    std::_Exit(0);
+}
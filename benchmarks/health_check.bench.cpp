@@ -0,0 +1,100 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "support/harness.h"
+#include "../src/http/http.h"
+#include "../src/http/route_table.h"
+#include "../src/http/static_response.h"
+
+/*
+Serves a trivial health check over kept alive connections, once from a route
+handler building its response on every request and once from a constant
+route serialized when it was added, and reports the requests per second and
+CPU time per request of each.
+
+    bench_health_check --backend=epoll --requests=100000
+*/
+
+int main(int argc, char* argv[])
+{
+    using namespace nimlib::Benchmarks;
+    using namespace nimlib::Server::Handlers::Http;
+    using nimlib::Server::Constants::HandlerState;
+    using clock = std::chrono::steady_clock;
+
+    static const std::string port{ argument(argc, argv, "port", "8099") };
+    auto backend = argument(argc, argv, "backend", "epoll");
+    int request_count = std::stoi(argument(argc, argv, "requests", "100000"));
+
+    Router router{};
+    router.get("/built", [](const Request&, Response& response, params_t&) -> std::optional<HandlerState>
+        {
+            response.status = 200;
+            response.reason = "OK";
+            response.headers.set("content-type", "text/plain");
+            response.headers.set("date", http_date(std::time(nullptr)));
+            response.body = "ok";
+            return HandlerState::FINISHED_WAIT;
+        });
+    router.constant("/constant", { 200, "OK", "text/plain", "ok", true });
+    route_table().publish(std::make_shared<const Router>(std::move(router)));
+
+    start_server(backend, port);
+
+    for (std::string route : { "built", "constant" })
+    {
+        const std::string request{ "GET /" + route + " HTTP/1.1\r\nHost: localhost\r\n\r\n" };
+
+        // The server closes a connection after MAX_KEEP_ALIVE_REQUESTS, the
+        // client opens a new one before it would get there.
+        int served{};
+        int client = -1;
+        int on_connection{};
+        std::string pending{};
+
+        auto cpu_before = cpu_seconds();
+        auto start = clock::now();
+        for (int i = 0; i < request_count; i++)
+        {
+            if (client < 0 || on_connection == HttpHandler::MAX_KEEP_ALIVE_REQUESTS)
+            {
+                if (client >= 0) close(client);
+                if ((client = connect_client(port)) < 0) continue;
+                on_connection = 0;
+                pending.clear();
+            }
+
+            on_connection++;
+            if (send_all(client, request) && read_response(client, pending))
+            {
+                served++;
+            }
+            else
+            {
+                close(client);
+                client = -1;
+            }
+        }
+        auto seconds = std::chrono::duration<double>(clock::now() - start).count();
+        auto cpu = cpu_seconds() - cpu_before;
+        if (client >= 0) close(client);
+
+        std::printf(
+            "backend=%s route=%s requests=%d served=%d requests_per_second=%.0f cpu_us_per_request=%.2f\n",
+            backend.c_str(),
+            route.c_str(),
+            request_count,
+            served,
+            served / seconds,
+            1e6 * cpu / request_count
+        );
+        std::fflush(stdout);
+    }
+
+    std::_Exit(0);
+}
@@ -0,0 +1,57 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "support/harness.h"
+
+/*
+Opens a large number of keep-alive connections that never send anything
+and reports how much CPU the server burns while they sit idle. With
+readiness interest following the connection state this should stay close
+to zero no matter how many connections are open.
+
+    bench_idle_connections --backend=epoll --connections=10000 --seconds=5
+*/
+
+int main(int argc, char* argv[])
+{
+    using namespace nimlib::Benchmarks;
+
+    static const std::string port{ argument(argc, argv, "port", "8090") };
+    auto backend = argument(argc, argv, "backend", "epoll");
+    int connection_count = std::stoi(argument(argc, argv, "connections", "10000"));
+    int seconds = std::stoi(argument(argc, argv, "seconds", "5"));
+
+    raise_file_limit();
+    start_server(backend, port);
+
+    std::vector<int> clients;
+    clients.reserve(connection_count);
+    for (int i = 0; i < connection_count; i++)
+    {
+        int client = connect_client(port);
+        if (client < 0) break;
+        clients.push_back(client);
+    }
+
+    // Give the server time to accept everything before measuring.
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    auto cpu_before = cpu_seconds();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    auto cpu_used = cpu_seconds() - cpu_before;
+
+    std::printf(
+        "backend=%s idle_connections=%zu seconds=%d cpu_seconds=%.3f cpu_usage=%.2f%%\n",
+        backend.c_str(),
+        clients.size(),
+        seconds,
+        cpu_used,
+        100.0 * cpu_used / seconds
+    );
+
+    std::fflush(stdout);
+    std::_Exit(0);
+}
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "support/harness.h"
+#include "../src/http/http.h"
+#include "../src/http/route_table.h"
+
+/*
+Compares serving requests one after the other over kept alive connections
+with opening a new connection for every request, which the client closes
+by sending `Connection: close`.
+
+With `--reactors=N` it then serves kept alive connections from 1 up to N
+event loops sharing a port, as `test_run <backend> N` does, the requests
+sent by `--clients` client threads at once. Each number of loops listens
+on a port of its own, the port given plus the number of loops.
+
+    bench_keep_alive --backend=epoll --requests=20000 --reactors=4 --clients=16
+*/
+
+namespace
+{
+    using nimlib::Server::Handlers::Http::HttpHandler;
+
+    const std::string REQUEST{ "GET /ping HTTP/1.1\r\nHost: localhost\r\n\r\n" };
+
+    // The server closes a connection after MAX_KEEP_ALIVE_REQUESTS, the
+    // client opens a new one before it would get there. Returns how many
+    // requests were answered.
+    int keep_alive_requests(const std::string& port, int request_count)
+    {
+        using namespace nimlib::Benchmarks;
+
+        int served{};
+        int client = -1;
+        int on_connection{};
+        std::string pending{};
+
+        for (int i = 0; i < request_count; i++)
+        {
+            if (client < 0 || on_connection == HttpHandler::MAX_KEEP_ALIVE_REQUESTS)
+            {
+                if (client >= 0) close(client);
+                if ((client = connect_client(port)) < 0) continue;
+                on_connection = 0;
+                pending.clear();
+            }
+
+            on_connection++;
+            if (send_all(client, REQUEST) && read_response(client, pending))
+            {
+                served++;
+            }
+            else
+            {
+                close(client);
+                client = -1;
+            }
+        }
+
+        if (client >= 0) close(client);
+        return served;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace nimlib::Benchmarks;
+    using namespace nimlib::Server::Handlers::Http;
+    using nimlib::Server::Constants::HandlerState;
+    using clock = std::chrono::steady_clock;
+
+    static const std::string port{ argument(argc, argv, "port", "8094") };
+    auto backend = argument(argc, argv, "backend", "epoll");
+    int request_count = std::stoi(argument(argc, argv, "requests", "20000"));
+    int max_reactors = std::stoi(argument(argc, argv, "reactors", "1"));
+    int client_count = std::max(1, std::stoi(argument(argc, argv, "clients", std::to_string(4 * max_reactors))));
+
+    Router router{};
+    router.get("/ping", [](const Request&, Response& response, params_t&) -> std::optional<HandlerState>
+        {
+            response.status = 200;
+            response.reason = "OK";
+            response.body = "pong";
+            return HandlerState::FINISHED_WAIT;
+        });
+    route_table().publish(std::make_shared<const Router>(std::move(router)));
+
+    raise_file_limit();
+    start_server(backend, port);
+
+    const std::string closing_request{ "GET /ping HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n" };
+
+    int served{};
+    auto start = clock::now();
+    for (int i = 0; i < request_count; i++)
+    {
+        int client = connect_client(port);
+        if (client < 0) continue;
+
+        if (send_all(client, closing_request) && read_until_closed(client) > 0) served++;
+        close(client);
+    }
+    auto close_time = std::chrono::duration<double>(clock::now() - start).count();
+
+    std::printf(
+        "backend=%s mode=close requests=%d served=%d requests_per_second=%.0f request_us=%.1f\n",
+        backend.c_str(),
+        request_count,
+        served,
+        request_count / close_time,
+        1e6 * close_time / request_count
+    );
+
+    start = clock::now();
+    served = keep_alive_requests(port, request_count);
+    auto keep_alive_time = std::chrono::duration<double>(clock::now() - start).count();
+
+    std::printf(
+        "backend=%s mode=keep_alive requests=%d served=%d requests_per_second=%.0f request_us=%.1f\n",
+        backend.c_str(),
+        request_count,
+        served,
+        request_count / keep_alive_time,
+        1e6 * keep_alive_time / request_count
+    );
+
+    // The loops started for one measurement stay up, idle, through the
+    // next ones. Servers keep a reference to their port.
+    static std::vector<std::string> ports{};
+    ports.reserve(max_reactors);
+    int per_client = request_count / client_count;
+
+    for (int reactors = 1; max_reactors > 1 && reactors <= max_reactors; reactors++)
+    {
+        const auto& loop_port = ports.emplace_back(std::to_string(std::stoi(port) + reactors));
+        start_server(backend, loop_port, reactors);
+
+        std::vector<int> served_by(client_count);
+        std::vector<std::thread> clients{};
+        start = clock::now();
+        for (int i = 0; i < client_count; i++)
+        {
+            clients.emplace_back([&loop_port, &served_by, per_client, i]() {
+                served_by[i] = keep_alive_requests(loop_port, per_client);
+                });
+        }
+        for (auto& client : clients) client.join();
+        auto scaling_time = std::chrono::duration<double>(clock::now() - start).count();
+
+        served = 0;
+        for (auto count : served_by) served += count;
+
+        std::printf(
+            "backend=%s mode=keep_alive_loops reactors=%d clients=%d requests=%d served=%d requests_per_second=%.0f\n",
+            backend.c_str(),
+            reactors,
+            client_count,
+            per_client * client_count,
+            served,
+            per_client * client_count / scaling_time
+        );
+    }
+
+    std::fflush(stdout);
+    std::_Exit(0);
+}
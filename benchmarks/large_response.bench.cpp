@@ -0,0 +1,90 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "support/harness.h"
+#include "../src/http/http.h"
+#include "../src/http/route_table.h"
+
+/*
+Downloads a large response body over and over on one kept alive connection
+and reports the transfer rate and the CPU time the process, client
+included, spent per response.
+
+    bench_large_response --backend=epoll --kilobytes=1024 --requests=500
+*/
+
+int main(int argc, char* argv[])
+{
+    using namespace nimlib::Benchmarks;
+    using namespace nimlib::Server::Handlers::Http;
+    using nimlib::Server::Constants::HandlerState;
+    using clock = std::chrono::steady_clock;
+
+    static const std::string port{ argument(argc, argv, "port", "8096") };
+    auto backend = argument(argc, argv, "backend", "epoll");
+    long kilobytes = std::stol(argument(argc, argv, "kilobytes", "1024"));
+    int request_count = std::stoi(argument(argc, argv, "requests", "500"));
+
+    static const std::string body(kilobytes * 1024, 'x');
+
+    Router router{};
+    router.get("/large", [](const Request&, Response& response, params_t&) -> std::optional<HandlerState>
+        {
+            response.status = 200;
+            response.reason = "OK";
+            response.body = body;
+            return HandlerState::FINISHED_WAIT;
+        });
+    route_table().publish(std::make_shared<const Router>(std::move(router)));
+
+    start_server(backend, port);
+
+    const std::string request{ "GET /large HTTP/1.1\r\nHost: localhost\r\n\r\n" };
+    int served{};
+    int client = -1;
+    int on_connection{};
+    std::string pending{};
+
+    auto cpu_before = cpu_seconds();
+    auto start = clock::now();
+    for (int i = 0; i < request_count; i++)
+    {
+        if (client < 0 || on_connection == HttpHandler::MAX_KEEP_ALIVE_REQUESTS)
+        {
+            if (client >= 0) close(client);
+            if ((client = connect_client(port)) < 0) continue;
+            on_connection = 0;
+            pending.clear();
+        }
+
+        on_connection++;
+        if (send_all(client, request) && read_response(client, pending))
+        {
+            served++;
+        }
+        else
+        {
+            close(client);
+            client = -1;
+        }
+    }
+    auto seconds = std::chrono::duration<double>(clock::now() - start).count();
+    auto cpu = cpu_seconds() - cpu_before;
+
+    std::printf(
+        "backend=%s body_kb=%ld requests=%d served=%d mb_per_second=%.1f cpu_us_per_response=%.1f\n",
+        backend.c_str(),
+        kilobytes,
+        request_count,
+        served,
+        served * kilobytes / 1024.0 / seconds,
+        1e6 * cpu / request_count
+    );
+
+    std::fflush(stdout);
+    std::_Exit(0);
+}
@@ -0,0 +1,91 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "support/harness.h"
+#include "../src/http/http.h"
+#include "../src/http/route_table.h"
+
+/*
+Measures requests per second over keep-alive connections with 1, 4 and 16
+requests in flight. Each round sends `depth` requests in one write
+and waits for all of their responses before sending the next round.
+
+    bench_pipelining --backend=epoll --seconds=3
+*/
+
+int main(int argc, char* argv[])
+{
+    using namespace nimlib::Benchmarks;
+    using namespace nimlib::Server::Handlers::Http;
+    using nimlib::Server::Constants::HandlerState;
+    using clock = std::chrono::steady_clock;
+
+    static const std::string port{ argument(argc, argv, "port", "8093") };
+    auto backend = argument(argc, argv, "backend", "epoll");
+    double seconds = std::stod(argument(argc, argv, "seconds", "3"));
+
+    Router router{};
+    router.get("/ping", [](const Request&, Response& response, params_t&) -> std::optional<HandlerState>
+        {
+            response.status = 200;
+            response.reason = "OK";
+            response.body = "pong";
+            return HandlerState::FINISHED_WAIT;
+        });
+    route_table().publish(std::make_shared<const Router>(std::move(router)));
+
+    const std::string request{ "GET /ping HTTP/1.1\r\nHost: localhost\r\n\r\n" };
+
+    start_server(backend, port);
+
+    for (int depth : { 1, 4, 16 })
+    {
+        std::string batch{};
+        for (int i = 0; i < depth; i++) batch += request;
+
+        // The server closes a connection after MAX_KEEP_ALIVE_REQUESTS, the
+        // client opens a new one before it would get there.
+        int client = -1;
+        int on_connection{};
+        std::string pending{};
+        long answered{};
+        auto start = clock::now();
+        auto elapsed = 0.0;
+        while (elapsed < seconds)
+        {
+            if (client < 0 || on_connection + depth > HttpHandler::MAX_KEEP_ALIVE_REQUESTS)
+            {
+                if (client >= 0) close(client);
+                if ((client = connect_client(port)) < 0) break;
+                on_connection = 0;
+                pending.clear();
+            }
+
+            if (!send_all(client, batch)) break;
+
+            int read = 0;
+            while (read < depth && read_response(client, pending)) read++;
+            if (read < depth) break;
+
+            on_connection += depth;
+            answered += depth;
+            elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        }
+        if (client >= 0) close(client);
+
+        std::printf(
+            "backend=%s depth=%d requests=%ld requests_per_second=%.0f\n",
+            backend.c_str(),
+            depth,
+            answered,
+            answered / elapsed
+        );
+    }
+
+    std::fflush(stdout);
+    std::_Exit(0);
+}
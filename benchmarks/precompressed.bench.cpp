@@ -0,0 +1,146 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+#include "support/harness.h"
+#include "../src/http/http.h"
+#include "../src/http/route_table.h"
+
+/*
+Downloads a compressible text file over one kept alive connection, first as
+it is and then asking for gzip, and reports the bytes each response took on
+the wire and the rate they were served at. The file is written to /tmp first,
+its gzip copy made when the route is registered, and both removed at the end.
+
+    bench_precompressed --backend=epoll --size=65536 --requests=20000
+*/
+
+// Reads one response and drops it, returning how many bytes it was, head
+// included, or 0 when the connection failed.
+static size_t read_response_size(int client, std::string& pending)
+{
+    char buffer[65536];
+    size_t head_end{};
+
+    while ((head_end = pending.find("\r\n\r\n")) == std::string::npos)
+    {
+        auto received = recv(client, buffer, sizeof(buffer), 0);
+        if (received <= 0) return 0;
+        pending.append(buffer, received);
+    }
+
+    auto length = pending.find("content-length: ");
+    if (length == std::string::npos || length > head_end) return 0;
+    size_t remaining = std::stoul(pending.substr(length + 16, head_end - length - 16));
+    size_t total = head_end + 4 + remaining;
+    pending.erase(0, head_end + 4);
+
+    auto kept = std::min(remaining, pending.size());
+    pending.erase(0, kept);
+    remaining -= kept;
+
+    while (remaining > 0)
+    {
+        auto received = recv(client, buffer, std::min(sizeof(buffer), remaining), 0);
+        if (received <= 0) return 0;
+        remaining -= received;
+    }
+
+    return total;
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace nimlib::Benchmarks;
+    using namespace nimlib::Server::Handlers::Http;
+    using clock = std::chrono::steady_clock;
+
+    static const std::string port{ argument(argc, argv, "port", "8098") };
+    auto backend = argument(argc, argv, "backend", "epoll");
+    const size_t size = std::stoul(argument(argc, argv, "size", "65536"));
+    const int request_count = std::stoi(argument(argc, argv, "requests", "20000"));
+
+    // Markup-like text, repetitive the way real pages are.
+    const std::string path{ "/tmp/nimlib_bench_page.html" };
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return 1;
+    for (size_t written = 0, row = 0; written < size; row++)
+    {
+        auto line = "<tr><td class=\"id\">" + std::to_string(row) + "</td><td class=\"name\">item "
+            + std::to_string(row * 7919 % 10007) + "</td></tr>\n";
+        line.resize(std::min(line.size(), size - written));
+        std::fwrite(line.data(), 1, line.size(), file);
+        written += line.size();
+    }
+    std::fclose(file);
+
+    Router router{};
+    router.serve_static("/page", path);
+    route_table().publish(std::make_shared<const Router>(std::move(router)));
+
+    start_server(backend, port);
+
+    for (std::string accept_encoding : { "", "gzip, deflate, br;q=0" })
+    {
+        std::string request{ "GET /page HTTP/1.1\r\nHost: localhost\r\n" };
+        if (!accept_encoding.empty()) request += "Accept-Encoding: " + accept_encoding + "\r\n";
+        request += "\r\n";
+
+        int served{};
+        size_t wire_bytes{};
+        int client = -1;
+        int on_connection{};
+        std::string pending{};
+
+        auto cpu_before = cpu_seconds();
+        auto start = clock::now();
+        for (int i = 0; i < request_count; i++)
+        {
+            if (client < 0 || on_connection == HttpHandler::MAX_KEEP_ALIVE_REQUESTS)
+            {
+                if (client >= 0) close(client);
+                if ((client = connect_client(port)) < 0) continue;
+                on_connection = 0;
+                pending.clear();
+            }
+
+            on_connection++;
+            size_t received{};
+            if (send_all(client, request) && (received = read_response_size(client, pending)) > 0)
+            {
+                served++;
+                wire_bytes += received;
+            }
+            else
+            {
+                close(client);
+                client = -1;
+            }
+        }
+        auto seconds = std::chrono::duration<double>(clock::now() - start).count();
+        auto cpu = cpu_seconds() - cpu_before;
+        if (client >= 0) close(client);
+
+        std::printf(
+            "backend=%s accept_encoding=\"%s\" file_bytes=%zu requests=%d served=%d bytes_per_response=%zu requests_per_second=%.0f cpu_us_per_response=%.1f\n",
+            backend.c_str(),
+            accept_encoding.c_str(),
+            size,
+            request_count,
+            served,
+            served > 0 ? wire_bytes / served : 0,
+            served / seconds,
+            1e6 * cpu / request_count
+        );
+        std::fflush(stdout);
+    }
+
+    unlink(path.c_str());
+    unlink((path + ".gz").c_str());
+
+    std::fflush(stdout);
+    std::_Exit(0);
+}
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "support/harness.h"
+#include "../src/http/parser.h"
+#include "../src/http/serializer.h"
+#include "../src/utils/output_queue.h"
+
+/*
+Compares writing response heads through a stringstream, the way
+response_head used to, with write_response_head writing them straight to an
+output queue, and reports the time and allocations each takes per response.
+Each response is also answered in a full round trip: its request parsed in
+place, the response filled in and its head written to the queue.
+
+Before timing anything, both heads of every response are checked to hold
+the same lines, the old one given its Content-Length and Date by hand.
+
+    bench_round_trip --iterations=200000
+*/
+
+static std::atomic<long> allocations{};
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace
+{
+    using nimlib::Server::Handlers::Http::Response;
+
+    struct Result
+    {
+        double ns;
+        double allocations;
+    };
+
+    template <typename F>
+    Result measure(int iterations, F write_one)
+    {
+        using clock = std::chrono::steady_clock;
+
+        // One round first, so that buffers reused between rounds are
+        // allocated before counting.
+        write_one();
+
+        long allocations_before = allocations.load();
+        auto start = clock::now();
+        for (int i = 0; i < iterations; i++) write_one();
+        auto elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+        return { elapsed / iterations, static_cast<double>(allocations.load() - allocations_before) / iterations };
+    }
+
+    // How response heads were written before write_response_head.
+    std::string stream_head(const Response& response)
+    {
+        std::stringstream head{};
+        head << response.version << " " << response.status << " " << response.reason << "\r\n";
+        for (const auto& [name, value] : response.headers) head << name << ": " << value << "\r\n";
+        head << "\r\n";
+        return head.str();
+    }
+
+    std::vector<std::string> sorted_lines(const std::string& head)
+    {
+        std::vector<std::string> lines{};
+        for (size_t at = 0, end; (end = head.find("\r\n", at)) != std::string::npos; at = end + 2)
+        {
+            lines.emplace_back(head.substr(at, end - at));
+        }
+        std::sort(lines.begin(), lines.end());
+        return lines;
+    }
+
+    struct Case
+    {
+        const char* name;
+        std::string request;
+        Response response;
+    };
+
+    std::vector<Case> cases()
+    {
+        std::vector<Case> all{};
+
+        Response api{};
+        api.status = 200;
+        api.reason = "OK";
+        api.headers.set("content-type", "application/json");
+        api.headers.set("cache-control", "no-store");
+        api.headers.set("connection", "keep-alive");
+        api.body = "{\"id\":\"bd7f1c\",\"status\":\"accepted\"}";
+        all.push_back({ "api", "POST /api/v1/orders HTTP/1.1\r\nHost: api.example.com\r\nContent-Type: application/json\r\n\r\n", std::move(api) });
+
+        Response page{};
+        page.status = 200;
+        page.reason = "OK";
+        page.headers.set("content-type", "text/html; charset=UTF-8");
+        page.headers.set("etag", "\"2ebc3c21.0-64\"");
+        page.headers.set("last-modified", "Sun, 06 Nov 1994 08:49:37 GMT");
+        page.headers.set("accept-ranges", "bytes");
+        page.headers.set("vary", "accept-encoding");
+        page.headers.set("content-encoding", "gzip");
+        page.body = std::string(2048, 'p');
+        all.push_back({ "page", "GET /index.html HTTP/1.1\r\nHost: localhost\r\nAccept-Encoding: gzip, br\r\n\r\n", std::move(page) });
+
+        Response missing{};
+        missing.status = 404;
+        missing.reason = "Not Found";
+        missing.headers.set("content-type", "text/plain");
+        missing.body = "not found";
+        all.push_back({ "not_found", "GET /favicon.ico HTTP/1.1\r\nHost: localhost\r\n\r\n", std::move(missing) });
+
+        return all;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace nimlib::Benchmarks;
+    using namespace nimlib::Server::Handlers::Http;
+    using nimlib::Server::Utils::OutputQueue;
+
+    int iterations = std::stoi(argument(argc, argv, "iterations", "200000"));
+    long checksum{};
+
+    for (auto& [name, request, response] : cases())
+    {
+        // The same lines, with the ones the serializer adds given by hand.
+        auto written = response_head(response);
+        auto by_hand_date = written.substr(written.find("\r\ndate: ") + 8);
+        Response by_hand{};
+        by_hand.status = response.status;
+        by_hand.reason = response.reason;
+        by_hand.headers = response.headers;
+        by_hand.headers.set("content-length", std::to_string(response.body.size()));
+        by_hand.headers.set("date", by_hand_date.substr(0, by_hand_date.find("\r\n")));
+        if (sorted_lines(stream_head(by_hand)) != sorted_lines(written))
+        {
+            std::printf("response=%s heads differ\n%s\n%s\n", name, stream_head(by_hand).c_str(), written.c_str());
+            return 1;
+        }
+
+        auto stream_result = measure(iterations, [&]() {
+            checksum += stream_head(by_hand).size();
+            });
+
+        OutputQueue queue{};
+        auto queue_result = measure(iterations, [&]() {
+            write_response_head(response, queue);
+            checksum += queue.size();
+            queue.consume(queue.size());
+            });
+
+        RequestParser parser;
+        auto round_trip_result = measure(iterations, [&]() {
+            parser.reset();
+            checksum += parser.parse(request) == RequestParser::Result::COMPLETE ? parser.headers().size() : 0;
+            write_response_head(response, queue);
+            queue.append(response.body);
+            checksum += queue.size();
+            queue.consume(queue.size());
+            });
+
+        std::printf(
+            "response=%s head_bytes=%zu stream_ns=%.0f stream_allocations=%.1f queue_ns=%.0f queue_allocations=%.1f round_trip_ns=%.0f round_trip_allocations=%.1f\n",
+            name,
+            written.size(),
+            stream_result.ns,
+            stream_result.allocations,
+            queue_result.ns,
+            queue_result.allocations,
+            round_trip_result.ns,
+            round_trip_result.allocations
+        );
+    }
+
+    std::printf("checksum=%ld\n", checksum);
+    std::fflush(stdout);
+    std::_Exit(0);
+}
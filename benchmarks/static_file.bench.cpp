@@ -0,0 +1,150 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+#include "support/harness.h"
+#include "../src/http/http.h"
+#include "../src/http/route_table.h"
+
+/*
+Downloads static files of several sizes over one kept alive connection and
+reports, for each size, the transfer rate and the CPU time the process,
+client included, spent per response. The files are written to /tmp first
+and removed at the end.
+
+    bench_static_file --backend=epoll --sizes=4096,1048576,1073741824
+*/
+
+// Reads one response like read_response(), but drops its body as it
+// arrives so that a big file does not have to fit in memory.
+static bool read_discarding(int client, std::string& pending)
+{
+    char buffer[65536];
+    size_t head_end{};
+
+    while ((head_end = pending.find("\r\n\r\n")) == std::string::npos)
+    {
+        auto received = recv(client, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        pending.append(buffer, received);
+    }
+
+    auto length = pending.find("content-length: ");
+    if (length == std::string::npos || length > head_end) return false;
+    size_t remaining = std::stoul(pending.substr(length + 16, head_end - length - 16));
+    pending.erase(0, head_end + 4);
+
+    auto kept = std::min(remaining, pending.size());
+    pending.erase(0, kept);
+    remaining -= kept;
+
+    while (remaining > 0)
+    {
+        auto received = recv(client, buffer, std::min(sizeof(buffer), remaining), 0);
+        if (received <= 0) return false;
+        remaining -= received;
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace nimlib::Benchmarks;
+    using namespace nimlib::Server::Handlers::Http;
+    using clock = std::chrono::steady_clock;
+
+    static const std::string port{ argument(argc, argv, "port", "8097") };
+    auto backend = argument(argc, argv, "backend", "epoll");
+    auto sizes_argument = argument(argc, argv, "sizes", "4096,1048576,1073741824");
+    // Each size is downloaded about this many bytes worth, and at least
+    // three times.
+    const double bytes_per_size = std::stod(argument(argc, argv, "total", "4294967296"));
+
+    std::vector<size_t> sizes{};
+    for (size_t at = 0; at < sizes_argument.size();)
+    {
+        auto comma = std::min(sizes_argument.find(',', at), sizes_argument.size());
+        sizes.push_back(std::stoul(sizes_argument.substr(at, comma - at)));
+        at = comma + 1;
+    }
+
+    Router router{};
+    std::vector<std::string> paths{};
+    for (auto size : sizes)
+    {
+        auto path = "/tmp/nimlib_bench_" + std::to_string(size) + ".jpg";
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) return 1;
+
+        const std::string piece(1024 * 1024, 'x');
+        for (size_t written = 0; written < size; written += piece.size())
+        {
+            std::fwrite(piece.data(), 1, std::min(piece.size(), size - written), file);
+        }
+        std::fclose(file);
+
+        router.serve_static("/" + std::to_string(size), path);
+        paths.push_back(path);
+    }
+    route_table().publish(std::make_shared<const Router>(std::move(router)));
+
+    start_server(backend, port);
+
+    for (auto size : sizes)
+    {
+        const std::string request{ "GET /" + std::to_string(size) + " HTTP/1.1\r\nHost: localhost\r\n\r\n" };
+        int request_count = std::max(3, static_cast<int>(std::min(bytes_per_size / size, 20000.0)));
+        int served{};
+        int client = -1;
+        int on_connection{};
+        std::string pending{};
+
+        auto cpu_before = cpu_seconds();
+        auto start = clock::now();
+        for (int i = 0; i < request_count; i++)
+        {
+            if (client < 0 || on_connection == HttpHandler::MAX_KEEP_ALIVE_REQUESTS)
+            {
+                if (client >= 0) close(client);
+                if ((client = connect_client(port)) < 0) continue;
+                on_connection = 0;
+                pending.clear();
+            }
+
+            on_connection++;
+            if (send_all(client, request) && read_discarding(client, pending))
+            {
+                served++;
+            }
+            else
+            {
+                close(client);
+                client = -1;
+            }
+        }
+        auto seconds = std::chrono::duration<double>(clock::now() - start).count();
+        auto cpu = cpu_seconds() - cpu_before;
+        if (client >= 0) close(client);
+
+        std::printf(
+            "backend=%s file_bytes=%zu requests=%d served=%d requests_per_second=%.0f mb_per_second=%.1f cpu_us_per_response=%.1f\n",
+            backend.c_str(),
+            size,
+            request_count,
+            served,
+            served / seconds,
+            served * (size / 1048576.0) / seconds,
+            1e6 * cpu / request_count
+        );
+        std::fflush(stdout);
+    }
+
+    for (const auto& path : paths) unlink(path.c_str());
+
+    std::fflush(stdout);
+    std::_Exit(0);
+}
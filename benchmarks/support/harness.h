@@ -0,0 +1,217 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../../src/common/types.h"
+#include "../../src/polling_server.h"
+#include "../../src/epoll_server.h"
+#ifdef NIMLIB_WITH_IO_URING
+#include "../../src/uring_server.h"
+#endif
+
+// Small helpers shared by the benchmark executables. Every benchmark runs
+// the server in-process on a background thread and drives it with plain
+// blocking client sockets from the main thread. The event loops never
+// return, so a benchmark ends the process once it has printed its results.
+namespace nimlib::Benchmarks
+{
+    using nimlib::Server::Types::Server;
+
+    inline std::unique_ptr<Server> make_server(std::string_view backend, const std::string& port, bool reuse_port = false)
+    {
+        if (backend == "epoll") return std::make_unique<nimlib::Server::EpollServer>(port, reuse_port);
+#ifdef NIMLIB_WITH_IO_URING
+        if (backend == "io_uring")
+        {
+            auto server = std::make_unique<nimlib::Server::UringServer>(port, reuse_port);
+            if (server->ready()) return server;
+
+            std::fprintf(stderr, "io_uring could not be set up (%s), using epoll\n", std::strerror(server->setup_error()));
+            server.reset();
+            return std::make_unique<nimlib::Server::EpollServer>(port, reuse_port);
+        }
+#endif
+        return std::make_unique<nimlib::Server::PollingServer>(port, reuse_port);
+    }
+
+    // Starts `loops` event loops on the port, each on its own thread. More
+    // than one listen with SO_REUSEPORT, like MultiReactorServer, and the
+    // kernel spreads new connections between them.
+    inline void start_server(std::string_view backend, const std::string& port, int loops = 1)
+    {
+        auto listening = std::make_shared<std::atomic<int>>(0);
+
+        // The server is created on the thread running it, as the connection
+        // pool and metrics store are per thread.
+        for (int i = 0; i < loops; i++)
+        {
+            std::thread{ [backend, &port, loops, listening]() {
+                auto server = make_server(backend, port, loops > 1);
+                (*listening)++;
+                server->run();
+                } }.detach();
+        }
+
+        while (*listening < loops) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Connects to the server over loopback. A source address in 127.0.0.0/8
+    // can be picked so that more connections can be opened than a single
+    // address has ephemeral ports for.
+    inline int connect_client(const std::string& port, uint32_t source_address = 0)
+    {
+        int client = socket(AF_INET, SOCK_STREAM, 0);
+        if (client < 0) return -1;
+
+        if (source_address)
+        {
+            int set = 1;
+            setsockopt(client, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &set, sizeof(set));
+
+            sockaddr_in source{};
+            source.sin_family = AF_INET;
+            source.sin_addr.s_addr = htonl(source_address);
+            if (bind(client, reinterpret_cast<sockaddr*>(&source), sizeof(source)) < 0)
+            {
+                close(client);
+                return -1;
+            }
+        }
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(std::stoi(port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        if (connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+        {
+            close(client);
+            return -1;
+        }
+
+        int set = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &set, sizeof(set));
+        return client;
+    }
+
+    inline bool send_all(int client, std::string_view data)
+    {
+        while (!data.empty())
+        {
+            auto sent = send(client, data.data(), data.size(), MSG_NOSIGNAL);
+            if (sent <= 0) return false;
+            data.remove_prefix(sent);
+        }
+
+        return true;
+    }
+
+    // Reads until the server closes the connection, returns the bytes read.
+    inline size_t read_until_closed(int client)
+    {
+        char buffer[4096];
+        size_t total{};
+
+        while (true)
+        {
+            auto received = recv(client, buffer, sizeof(buffer), 0);
+            if (received <= 0) return total;
+            total += received;
+        }
+    }
+
+    // Reads one response framed by its content-length header. Bytes read
+    // past its end are left in `pending` for the next call. Returns false if
+    // the connection closes or fails before the response is complete.
+    inline bool read_response(int client, std::string& pending)
+    {
+        char buffer[16384];
+        size_t head_end{ std::string::npos };
+        size_t response_size{ std::string::npos };
+
+        while (true)
+        {
+            if (head_end == std::string::npos && (head_end = pending.find("\r\n\r\n")) != std::string::npos)
+            {
+                auto length = pending.find("content-length: ");
+                if (length == std::string::npos || length > head_end) return false;
+                response_size = head_end + 4 + std::stoul(pending.substr(length + 16, head_end - length - 16));
+            }
+
+            if (pending.size() >= response_size)
+            {
+                pending.erase(0, response_size);
+                return true;
+            }
+
+            auto received = recv(client, buffer, sizeof(buffer), 0);
+            if (received <= 0) return false;
+            pending.append(buffer, received);
+        }
+    }
+
+    inline void raise_file_limit()
+    {
+        rlimit limit{};
+        getrlimit(RLIMIT_NOFILE, &limit);
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    // User and system time consumed by the whole process, in seconds.
+    inline double cpu_seconds()
+    {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+            + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    }
+
+    // Resident set size of the process in bytes, as reported by procfs.
+    inline long resident_memory()
+    {
+        std::ifstream status{ "/proc/self/status" };
+        std::string field{};
+        long kilobytes{};
+
+        while (status >> field)
+        {
+            if (field == "VmRSS:")
+            {
+                status >> kilobytes;
+                return kilobytes * 1024;
+            }
+        }
+
+        return 0;
+    }
+
+    // Reads a `--name=value` command line argument.
+    inline std::string argument(int argc, char* argv[], std::string_view name, std::string_view fallback)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string_view arg{ argv[i] };
+            if (arg.starts_with("--") && arg.substr(2).starts_with(name) && arg.substr(2 + name.size()).starts_with('='))
+            {
+                return std::string{ arg.substr(3 + name.size()) };
+            }
+        }
+
+        return std::string{ fallback };
+    }
+};
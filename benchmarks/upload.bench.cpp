@@ -0,0 +1,86 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "support/harness.h"
+#include "../src/http/http.h"
+#include "../src/http/route_table.h"
+
+/*
+Uploads one large body, with Content-Length or chunked, to a route reading
+it back a piece at a time, and reports the upload rate and how much the
+resident memory of the process grew while the server took it in.
+
+    bench_upload --backend=epoll --megabytes=64 --chunked=0
+*/
+
+int main(int argc, char* argv[])
+{
+    using namespace nimlib::Benchmarks;
+    using namespace nimlib::Server::Handlers::Http;
+    using nimlib::Server::Constants::HandlerState;
+    using clock = std::chrono::steady_clock;
+
+    static const std::string port{ argument(argc, argv, "port", "8095") };
+    auto backend = argument(argc, argv, "backend", "epoll");
+    long megabytes = std::stol(argument(argc, argv, "megabytes", "64"));
+    bool chunked = argument(argc, argv, "chunked", "0") == "1";
+
+    Router router{};
+    router.post("/upload", [](const Request& request, Response& response, params_t&) -> std::optional<HandlerState>
+        {
+            char piece[64 * 1024];
+            size_t total{};
+            for (size_t copied; (copied = request.content->read(total, piece, sizeof(piece))) > 0;) total += copied;
+
+            response.status = 200;
+            response.reason = "OK";
+            response.body = std::to_string(total);
+            return HandlerState::FINISHED_WAIT;
+        });
+    route_table().publish(std::make_shared<const Router>(std::move(router)));
+
+    start_server(backend, port);
+    int client = connect_client(port);
+    if (client < 0) return 1;
+
+    const size_t body_size = megabytes * 1024 * 1024;
+    const std::string piece(64 * 1024, 'x');
+    std::string head{ "POST /upload HTTP/1.1\r\nHost: localhost\r\n" };
+    head += chunked ? "Transfer-Encoding: chunked\r\n\r\n" : "Content-Length: " + std::to_string(body_size) + "\r\n\r\n";
+
+    char size_line[32];
+    std::snprintf(size_line, sizeof(size_line), "%zx\r\n", piece.size());
+
+    auto memory_before = resident_memory();
+    auto start = clock::now();
+
+    bool sent = send_all(client, head);
+    for (size_t at = 0; sent && at < body_size; at += piece.size())
+    {
+        sent = chunked
+            ? send_all(client, size_line) && send_all(client, piece) && send_all(client, "\r\n")
+            : send_all(client, piece);
+    }
+    if (sent && chunked) sent = send_all(client, "0\r\n\r\n");
+
+    std::string pending{};
+    bool answered = sent && read_response(client, pending);
+    auto seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+    std::printf(
+        "backend=%s chunked=%d body_mb=%ld answered=%d upload_mb_per_second=%.1f memory_growth_mb=%.1f\n",
+        backend.c_str(),
+        chunked,
+        megabytes,
+        answered,
+        megabytes / seconds,
+        (resident_memory() - memory_before) / 1048576.0
+    );
+
+    std::fflush(stdout);
+    std::_Exit(0);
+}
@@ -2,11 +2,14 @@
 
 #include <span>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <functional>
 #include <vector>
 #include <unordered_map>
 
 #include "common.h"
+#include "../utils/byte_buffer.h"
+#include "../utils/output_queue.h"
 #include "../utils/state_manager.h"
 
 namespace nimlib::Server::Types
@@ -38,6 +41,12 @@ namespace nimlib::Server::Types
 		virtual int tcp_read(std::span<uint8_t> buffer, int flags) = 0;
 		virtual int tcp_send(std::span<uint8_t> buffer) = 0;
 		virtual int tcp_send(std::string_view buffer) = 0;
+		// Sends the buffers in order with a single call, like writev(2). With
+		// `more`, the caller has more to send right after, which the buffers
+		// may be held back to go out with, like MSG_MORE.
+		virtual int tcp_send(std::span<const iovec> buffers, bool more) = 0;
+		// Sends `count` bytes of a file from `offset`, like sendfile(2).
+		virtual int tcp_send_file(int file_descriptor, size_t offset, size_t count) = 0;
 		virtual void tcp_close() = 0;  // TODO: may never be used
 		virtual const int get_tcp_socket_descriptor() const = 0;
 		virtual const std::string& get_port() const = 0;
@@ -51,8 +60,10 @@ namespace nimlib::Server::Types
 	{
 		virtual ~StreamsProvider() = default;
 
-		virtual std::stringstream& source() = 0;
-		virtual std::stringstream& sink() = 0;
+		// Input is read from in place, see ByteBuffer, and output is queued
+		// as slices written together, see OutputQueue.
+		virtual nimlib::Server::Utils::ByteBuffer& source() = 0;
+		virtual nimlib::Server::Utils::OutputQueue& sink() = 0;
 	};
 
 	struct Handler
@@ -74,7 +85,7 @@ namespace nimlib::Server::Types
 		{
 			{HandlerState::READY_TO_HANDLE, {HandlerState::H_HANDLING}},
 			{HandlerState::H_HANDLING, {HandlerState::FINISHED_WAIT, HandlerState::FINISHED_NO_WAIT, HandlerState::RECALL, HandlerState::INCOMPLETE_INPUT}},
-			{HandlerState::INCOMPLETE_INPUT, {HandlerState::FINISHED_WAIT, HandlerState::FINISHED_NO_WAIT, HandlerState::RECALL}},
+			{HandlerState::INCOMPLETE_INPUT, {HandlerState::H_HANDLING, HandlerState::FINISHED_WAIT, HandlerState::FINISHED_NO_WAIT, HandlerState::RECALL}},
 			{HandlerState::FINISHED_NO_WAIT, {HandlerState::READY_TO_HANDLE}},
 			{HandlerState::FINISHED_WAIT, {HandlerState::READY_TO_HANDLE}},
 			{HandlerState::RECALL, {HandlerState::FINISHED_WAIT, HandlerState::FINISHED_NO_WAIT}},
@@ -98,6 +109,7 @@ namespace nimlib::Server::Types
 		virtual void notify(Handler& handler) = 0;
 		virtual void set_handler(std::shared_ptr<Handler>) = 0;
 		virtual void halt() = 0;
+		virtual void time_out() = 0;
 		virtual ConnectionState get_state() = 0;
 		virtual const int get_id() const = 0;
 	};
@@ -106,5 +118,3 @@ namespace nimlib::Server::Types
 using connection_ptr = std::shared_ptr<nimlib::Server::Types::Connection>;
 using socket_ptr = std::unique_ptr<nimlib::Server::Types::Socket>;
 using connection_id = int;
-using headers_t = std::unordered_map<std::string, std::vector<std::string>>;
-using header_validator = const std::function<bool(const std::string& value, const std::unordered_map<std::string, std::vector<std::string>>& headers)>;
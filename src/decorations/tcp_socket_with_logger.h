@@ -104,6 +104,26 @@ namespace nimlib::Server::Sockets
             return bytes_count;
         };
 
+        int tcp_send(std::span<const iovec> buffers, bool more)
+        {
+            int bytes_count = tcp_socket->tcp_send(buffers, more);
+            if (bytes_count > 0)
+            {
+                log_agent->info(std::format("wrote {} bytes to socket {}", bytes_count, tcp_socket_descriptor));
+            }
+            return bytes_count;
+        };
+
+        int tcp_send_file(int file_descriptor, size_t offset, size_t count)
+        {
+            int bytes_count = tcp_socket->tcp_send_file(file_descriptor, offset, count);
+            if (bytes_count > 0)
+            {
+                log_agent->info(std::format("sent {} bytes of file {} to socket {}", bytes_count, file_descriptor, tcp_socket_descriptor));
+            }
+            return bytes_count;
+        };
+
         void tcp_close()
         {
             log_agent->info(std::format("TCP socket {} closing", tcp_socket_descriptor));
@@ -0,0 +1,189 @@
+#include <string>
+#include <cassert>
+#include <unistd.h>
+
+#include "epoll_server.h"
+#include "tcp_socket.h"
+
+#ifdef NO_TESTING
+#include "common/decorators.h"
+#else
+#include "../tests/support/decorators.h"
+#endif
+
+using nimlib::Server::Sockets::TcpSocket;
+
+namespace nimlib::Server
+{
+	EpollServer::EpollServer(const std::string& port, bool reuse_port)
+		: port{ port },
+		server_socket{ nimlib::Server::Decorators::decorate(std::make_unique<TcpSocket>(port, reuse_port)) },
+		connection_pool{ nimlib::Server::TcpConnectionPool::get_pool() },
+		epoll_fd{ epoll_create1(EPOLL_CLOEXEC) },
+		ready_events(MAX_EVENTS)
+	{
+		server_socket->tcp_bind();
+		server_socket->tcp_listen();
+		register_socket(server_socket->get_tcp_socket_descriptor(), EPOLLIN);
+	}
+
+	EpollServer::~EpollServer()
+	{
+		server_socket->tcp_close();
+		if (epoll_fd >= 0) close(epoll_fd);
+	}
+
+	void EpollServer::run()
+	{
+		int ready_count{};
+
+		while (true)
+		{
+			// Connections waiting to continue handling must not be delayed by
+			// an idle kernel, so the wait returns immediately if there are any.
+			// Otherwise the loop sleeps until the next connection deadline.
+			int timeout = pending.empty() ? connection_pool.next_time_out() : 0;
+			ready_count = epoll_wait(epoll_fd, ready_events.data(), ready_events.size(), timeout);
+			// Deadlines set while the events are handled start from here,
+			// not from before the wait.
+			connection_pool.refresh_clock();
+
+			for (int i = 0; i < ready_count; i++)
+			{
+				if (ready_events[i].data.fd == server_socket->get_tcp_socket_descriptor())
+				{
+					accept_new_connection();
+				}
+				else
+				{
+					handle_connection(ready_events[i]);
+				}
+			}
+
+			// Timed out connections are halted once the ready events are done.
+			// Closing one earlier could let an accept in the same batch reuse
+			// its descriptor and then receive the stale event.
+			for (auto id : connection_pool.time_out_connections())
+			{
+				clean_up(id);
+			}
+
+			handle_pending_connections();
+		}
+	}
+
+	void EpollServer::accept_new_connection()
+	{
+		auto accepted_socket = nimlib::Server::Decorators::decorate(server_socket->tcp_accept());
+
+		if (accepted_socket)
+		{
+			int socket = accepted_socket->get_tcp_socket_descriptor();
+			connection_pool.record_connection(std::move(accepted_socket));
+			register_socket(socket, interest(connection_pool.find(socket)->get_state()));
+		}
+	}
+
+	void EpollServer::handle_connection(const epoll_event& event)
+	{
+		auto connection = connection_pool.find(event.data.fd);
+		auto state = connection->get_state();
+
+		if (event.events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+		{
+			if (allowed_to_read(state)) connection->notify(ServerDirective::READ_SOCKET);
+		}
+		if (event.events & EPOLLOUT)
+		{
+			if (allowed_to_write(state)) connection->notify(ServerDirective::WRITE_SOCKET);
+		}
+
+		clean_up(event.data.fd);
+	}
+
+	void EpollServer::handle_pending_connections()
+	{
+		// clean_up() may push the same connection back onto the pending list,
+		// so the list being iterated is swapped out first.
+		pending_swap.clear();
+		std::swap(pending, pending_swap);
+
+		for (auto id : pending_swap)
+		{
+			clean_up(id);
+		}
+	}
+
+	void EpollServer::clean_up(connection_id id)
+	{
+		// Connections on the pending list may have been halted meanwhile.
+		auto connection = connection_pool.find(id);
+		if (!connection) return;
+
+		auto state = connection->get_state();
+
+		if (state == ConnectionState::CONNECTION_ERROR || state == ConnectionState::DONE)
+		{
+			// The socket is removed from the interest list before the connection
+			// halts, as halting closes the socket and frees the descriptor.
+			deregister_socket(id);
+		}
+
+		state = connection_pool.clean_up(id);
+		if (state == ConnectionState::INACTIVE) return;
+
+		// A connection with nothing to wait for is scheduled without the
+		// kernel, whether it continues handling or is halted next time.
+		auto events = interest(state);
+		if (!events) pending.push_back(id);
+		update_interest(id, events);
+	}
+
+	bool EpollServer::register_socket(int socket, uint32_t events)
+	{
+		epoll_event event{};
+		event.events = events;
+		event.data.fd = socket;
+		if (socket >= interests.size()) interests.resize(socket + 1, 0);
+		interests[socket] = events;
+		return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket, &event) == 0;
+	}
+
+	bool EpollServer::update_interest(int socket, uint32_t events)
+	{
+		// The kernel is only told about changes. A connection keeps waiting on
+		// the same event across many loop iterations.
+		if (interests[socket] == events) return true;
+
+		epoll_event event{};
+		event.events = events;
+		event.data.fd = socket;
+		interests[socket] = events;
+		return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, socket, &event) == 0;
+	}
+
+	bool EpollServer::deregister_socket(int socket)
+	{
+		interests[socket] = 0;
+		return epoll_ctl(epoll_fd, EPOLL_CTL_DEL, socket, nullptr) == 0;
+	}
+
+	uint32_t EpollServer::interest(ConnectionState state)
+	{
+		// Connections in any other state are either scheduled through the
+		// pending list or about to be cleaned up, there is nothing to wait for.
+		if (allowed_to_read(state)) return EPOLLIN;
+		if (allowed_to_write(state)) return EPOLLOUT;
+		return 0;
+	}
+
+	bool EpollServer::allowed_to_read(ConnectionState state)
+	{
+		return (state == ConnectionState::READY_TO_READ);
+	}
+
+	bool EpollServer::allowed_to_write(ConnectionState state)
+	{
+		return state == ConnectionState::READY_TO_WRITE;
+	}
+}
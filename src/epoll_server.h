@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <sys/epoll.h>
+
+#include "common/types.h"
+#include "tcp_connection_pool.h"
+
+namespace nimlib::Server
+{
+    using nimlib::Server::Types::Server;
+    using nimlib::Server::Types::Connection;
+    using nimlib::Server::Types::Socket;
+    using nimlib::Server::Constants::ServerDirective;
+    using nimlib::Server::Constants::ConnectionState;
+
+    class EpollServer : public Server
+    {
+    public:
+        EpollServer(const std::string& port, bool reuse_port = false);
+        ~EpollServer();
+
+        EpollServer(const EpollServer&) = delete;
+        EpollServer& operator=(const EpollServer&) = delete;
+        EpollServer(EpollServer&&) noexcept = delete;
+        EpollServer& operator=(EpollServer&&) noexcept = delete;
+
+        void run() override;
+
+    private:
+        void accept_new_connection();
+        void handle_connection(const epoll_event&);
+        void handle_pending_connections();
+        void clean_up(connection_id id);
+
+        bool register_socket(int socket, uint32_t events);
+        bool update_interest(int socket, uint32_t events);
+        bool deregister_socket(int socket);
+
+        static uint32_t interest(ConnectionState state);
+
+        static bool allowed_to_read(ConnectionState state);
+        static bool allowed_to_write(ConnectionState state);
+
+    private:
+        const std::string& port;
+        std::unique_ptr<Socket> server_socket;
+        TcpConnectionPool& connection_pool;
+        int epoll_fd{ -1 };
+        std::vector<epoll_event> ready_events;
+        // The events each registered socket is currently waiting on.
+        std::vector<uint32_t> interests{};
+        // Connections with no kernel event to wait for, ie. those that continue
+        // handling or are to be halted. They are revisited on the next loop.
+        std::vector<connection_id> pending{};
+        std::vector<connection_id> pending_swap{};
+
+        static const int MAX_EVENTS{ 1024 };
+    };
+};
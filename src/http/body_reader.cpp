@@ -0,0 +1,210 @@
+#include "body_reader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <unistd.h>
+
+namespace nimlib::Server::Handlers::Http
+{
+    RequestBody::RequestBody(size_t memory_limit) : memory_limit{ memory_limit } {}
+
+    RequestBody::~RequestBody() { clear(); }
+
+    bool RequestBody::append(std::string_view bytes)
+    {
+        if (sink) return sink(bytes);
+
+        if (!file && memory.size() + bytes.size() <= memory_limit)
+        {
+            memory.append(bytes);
+            return true;
+        }
+
+        if (!file && !spill()) return false;
+
+        while (!bytes.empty())
+        {
+            auto written = ::write(fileno(file), bytes.data(), bytes.size());
+            if (written < 0) return false;
+
+            file_size += written;
+            bytes.remove_prefix(written);
+        }
+
+        return true;
+    }
+
+    bool RequestBody::spill()
+    {
+        // The file is removed by the system as soon as it is closed.
+        file = std::tmpfile();
+        if (!file) return false;
+
+        std::string_view kept{ memory };
+        while (!kept.empty())
+        {
+            auto written = ::write(fileno(file), kept.data(), kept.size());
+            if (written < 0) return false;
+
+            file_size += written;
+            kept.remove_prefix(written);
+        }
+
+        std::string{}.swap(memory);
+        return true;
+    }
+
+    void RequestBody::clear()
+    {
+        // A connection keeps its body between requests, but not memory it only
+        // needed for one big body.
+        if (memory.capacity() > memory_limit) std::string{}.swap(memory);
+        memory.clear();
+
+        if (file)
+        {
+            std::fclose(file);
+            file = nullptr;
+            file_size = 0;
+        }
+
+        sink = nullptr;
+    }
+
+    void RequestBody::set_memory_limit(size_t bytes) { memory_limit = bytes; }
+
+    void RequestBody::set_sink(Sink sink) { this->sink = std::move(sink); }
+
+    size_t RequestBody::size() const { return file ? file_size : memory.size(); }
+
+    bool RequestBody::in_memory() const { return !file; }
+
+    std::string_view RequestBody::view() const { return memory; }
+
+    size_t RequestBody::read(size_t offset, char* out, size_t count) const
+    {
+        if (offset >= size()) return 0;
+        count = std::min(count, size() - offset);
+
+        if (!file)
+        {
+            memory.copy(out, count, offset);
+            return count;
+        }
+
+        auto copied = ::pread(fileno(file), out, count, offset);
+        return copied < 0 ? 0 : copied;
+    }
+
+    BodyReader::BodyReader(size_t max_size) : max_size{ max_size } {}
+
+    void BodyReader::expect_length(size_t length)
+    {
+        chunked = false;
+        remaining = length;
+        stage = length > max_size ? Stage::REFUSED : length > 0 ? Stage::DATA : Stage::DONE;
+    }
+
+    void BodyReader::expect_chunked()
+    {
+        chunked = true;
+        remaining = 0;
+        allowed = max_size;
+        stage = Stage::CHUNK_SIZE;
+    }
+
+    bool BodyReader::complete() const { return stage == Stage::DONE; }
+
+    BodyReader::Result BodyReader::fail()
+    {
+        stage = Stage::FAILED;
+        return Result::INVALID;
+    }
+
+    BodyReader::Result BodyReader::refuse()
+    {
+        stage = Stage::REFUSED;
+        return Result::TOO_LARGE;
+    }
+
+    BodyReader::Result BodyReader::read(std::string_view input, size_t& consumed, RequestBody& body)
+    {
+        consumed = 0;
+
+        while (true)
+        {
+            switch (stage)
+            {
+            case Stage::DATA:
+            {
+                auto available = std::min(remaining, input.size() - consumed);
+                if (available > 0 && !body.append(input.substr(consumed, available))) return fail();
+
+                consumed += available;
+                remaining -= available;
+                if (remaining > 0) return Result::INCOMPLETE;
+
+                stage = chunked ? Stage::CHUNK_END : Stage::DONE;
+                break;
+            }
+            case Stage::CHUNK_SIZE:
+            {
+                auto line_end = input.find("\r\n", consumed);
+                if (line_end == std::string_view::npos)
+                {
+                    return input.size() - consumed > MAX_LINE_SIZE ? fail() : Result::INCOMPLETE;
+                }
+                if (line_end - consumed > MAX_LINE_SIZE) return fail();
+
+                // Chunk extensions after the size are allowed but ignored.
+                auto line = input.substr(consumed, line_end - consumed);
+                size_t chunk_size{};
+                auto [size_end, error] = std::from_chars(line.data(), line.data() + line.size(), chunk_size, 16);
+                if (error != std::errc{} || size_end == line.data()) return fail();
+
+                auto rest = line.substr(size_end - line.data());
+                rest.remove_prefix(std::min(rest.find_first_not_of(" \t"), rest.size()));
+                if (!rest.empty() && rest.front() != ';') return fail();
+
+                if (chunk_size > allowed) return refuse();
+                allowed -= chunk_size;
+
+                consumed = line_end + 2;
+                remaining = chunk_size;
+                stage = chunk_size > 0 ? Stage::DATA : Stage::TRAILERS;
+                break;
+            }
+            case Stage::CHUNK_END:
+            {
+                if (input.size() - consumed < 2) return Result::INCOMPLETE;
+                if (input.substr(consumed, 2) != "\r\n") return fail();
+
+                consumed += 2;
+                stage = Stage::CHUNK_SIZE;
+                break;
+            }
+            case Stage::TRAILERS:
+            {
+                // Trailer fields are skipped, the body ends with an empty line.
+                auto line_end = input.find("\r\n", consumed);
+                if (line_end == std::string_view::npos)
+                {
+                    return input.size() - consumed > MAX_LINE_SIZE ? fail() : Result::INCOMPLETE;
+                }
+                if (line_end - consumed > MAX_LINE_SIZE) return fail();
+
+                bool last = line_end == consumed;
+                consumed = line_end + 2;
+                if (last) stage = Stage::DONE;
+                break;
+            }
+            case Stage::DONE:
+                return Result::COMPLETE;
+            case Stage::FAILED:
+                return Result::INVALID;
+            case Stage::REFUSED:
+                return Result::TOO_LARGE;
+            }
+        }
+    }
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace nimlib::Server::Handlers::Http
+{
+    // The body of a request, collected as it arrives. Bodies up to the memory
+    // limit are kept in memory, a longer one is moved to a temporary file as
+    // soon as it grows past the limit and the rest of it is written there, so
+    // an upload takes no more memory than the limit however big it is.
+    //
+    // A body can instead be passed to a sink as it arrives, see set_sink().
+    class RequestBody
+    {
+    public:
+        // Takes the bytes of a body as they are decoded, returns false to
+        // refuse the body.
+        using Sink = std::function<bool(std::string_view)>;
+
+        static constexpr size_t DEFAULT_MEMORY_LIMIT = 1024 * 1024;
+
+        explicit RequestBody(size_t memory_limit = DEFAULT_MEMORY_LIMIT);
+        ~RequestBody();
+
+        RequestBody(const RequestBody&) = delete;
+        RequestBody& operator=(const RequestBody&) = delete;
+        RequestBody(RequestBody&&) noexcept = delete;
+        RequestBody& operator=(RequestBody&&) noexcept = delete;
+
+        // Returns false if the body had to go to a file and writing it failed.
+        bool append(std::string_view bytes);
+        // Empties the body for the next request, removing its file, if any,
+        // and its sink.
+        void clear();
+        void set_memory_limit(size_t bytes);
+        // Until the next clear(), the bytes appended are passed to `sink`
+        // rather than kept, the body itself stays empty.
+        void set_sink(Sink sink);
+
+        size_t size() const;
+        bool in_memory() const;
+        // The whole body, while it is in memory.
+        std::string_view view() const;
+        // Copies up to `count` bytes from `offset` on to `out` and returns how
+        // many were copied, so a body in a file can be read a piece at a time.
+        size_t read(size_t offset, char* out, size_t count) const;
+
+    private:
+        bool spill();
+
+    private:
+        size_t memory_limit;
+        std::string memory{};
+        std::FILE* file{ nullptr };
+        size_t file_size{};
+        Sink sink{};
+    };
+
+    // Takes the body of a request off the bytes following its head, framed by
+    // Content-Length or by chunked transfer coding. The body may arrive in any
+    // number of pieces, read() is called with whatever has arrived since it
+    // last returned.
+    //
+    // A body longer than the maximum size is refused, as soon as its length
+    // or a chunk size tells, before the bytes past the limit are read.
+    class BodyReader
+    {
+    public:
+        enum class Result { COMPLETE, INCOMPLETE, INVALID, TOO_LARGE };
+
+        // Longest chunk size line, with its extensions, or trailer line.
+        static constexpr size_t MAX_LINE_SIZE = 4096;
+        static constexpr size_t DEFAULT_MAX_SIZE = size_t{ 1024 } * 1024 * 1024;
+
+        explicit BodyReader(size_t max_size = DEFAULT_MAX_SIZE);
+        ~BodyReader() = default;
+
+        BodyReader(const BodyReader&) = delete;
+        BodyReader& operator=(const BodyReader&) = delete;
+        BodyReader(BodyReader&&) noexcept = delete;
+        BodyReader& operator=(BodyReader&&) noexcept = delete;
+
+        void expect_length(size_t length);
+        void expect_chunked();
+        // Whether the whole body has been read, true for a request without one.
+        bool complete() const;
+
+        // Moves the body bytes at the start of `input` to `body`. `consumed`
+        // is set to how many bytes of `input` were used, framing included,
+        // they are not passed again. A chunk size line that has only partly
+        // arrived is not consumed and is passed again with the rest of it.
+        Result read(std::string_view input, size_t& consumed, RequestBody& body);
+
+    private:
+        enum class Stage { DATA, CHUNK_SIZE, CHUNK_END, TRAILERS, DONE, FAILED, REFUSED };
+
+        Result fail();
+        Result refuse();
+
+    private:
+        size_t max_size;
+        Stage stage{ Stage::DONE };
+        bool chunked{ false };
+        size_t remaining{};
+        // How much more of the body the chunks still to come may hold.
+        size_t allowed{};
+    };
+};
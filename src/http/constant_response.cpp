@@ -0,0 +1,58 @@
+#include "constant_response.h"
+
+#include <charconv>
+#include <ctime>
+
+namespace nimlib::Server::Handlers::Http
+{
+    ConstantResponse::ConstantResponse(
+        short status,
+        std::string_view reason,
+        std::string_view content_type,
+        std::string_view body,
+        bool dated
+    ) : status_code{ status }, with_date{ dated }
+    {
+        char length[24];
+        auto [length_end, _] = std::to_chars(length, length + sizeof(length), body.size());
+
+        std::string bytes{};
+        bytes.append("HTTP/1.1 ").append(std::to_string(status)).append(" ").append(reason).append("\r\n");
+        if (!content_type.empty()) bytes.append("content-type: ").append(content_type).append("\r\n");
+        bytes.append("content-length: ").append(length, length_end).append("\r\n");
+        head_length = bytes.size();
+        bytes.append("\r\n").append(body);
+
+        serialized = std::make_shared<const std::string>(std::move(bytes));
+    }
+
+    std::string_view ConstantResponse::head() const { return std::string_view{ *serialized }.substr(0, head_length); }
+
+    std::string_view ConstantResponse::tail() const { return std::string_view{ *serialized }.substr(head_length); }
+
+    const std::shared_ptr<const std::string>& ConstantResponse::bytes() const { return serialized; }
+
+    size_t ConstantResponse::head_size() const { return head_length; }
+
+    short ConstantResponse::status() const { return status_code; }
+
+    bool ConstantResponse::dated() const { return with_date; }
+
+    std::string_view date_header()
+    {
+        thread_local time_t formatted_at{ -1 };
+        thread_local char line[64];
+        thread_local size_t length{};
+
+        auto now = std::time(nullptr);
+        if (now != formatted_at)
+        {
+            tm fields{};
+            gmtime_r(&now, &fields);
+            length = std::strftime(line, sizeof(line), "date: %a, %d %b %Y %H:%M:%S GMT\r\n", &fields);
+            formatted_at = now;
+        }
+
+        return { line, length };
+    }
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace nimlib::Server::Handlers::Http
+{
+    // A response that is the same for every request, eg. a health check or
+    // a 404 page, serialized once when it is made. Serving it copies its
+    // bytes to the connection as they are, no headers are built for it.
+    //
+    // The headers that do depend on the request go between its head and its
+    // tail: the Connection header the handler adds, and the Date header when
+    // the response is dated.
+    class ConstantResponse
+    {
+    public:
+        ConstantResponse(
+            short status,
+            std::string_view reason,
+            std::string_view content_type,
+            std::string_view body,
+            bool dated = false
+        );
+        ~ConstantResponse() = default;
+
+        ConstantResponse(const ConstantResponse&) = default;
+        ConstantResponse& operator=(const ConstantResponse&) = default;
+        ConstantResponse(ConstantResponse&&) noexcept = default;
+        ConstantResponse& operator=(ConstantResponse&&) noexcept = default;
+
+        // The status line and the headers known ahead, each ending with CRLF.
+        std::string_view head() const;
+        // The empty line ending the headers, followed by the body.
+        std::string_view tail() const;
+        // Head and tail, in one string shared with every response sent.
+        const std::shared_ptr<const std::string>& bytes() const;
+        size_t head_size() const;
+        short status() const;
+        bool dated() const;
+
+    private:
+        std::shared_ptr<const std::string> serialized;
+        size_t head_length;
+        short status_code;
+        bool with_date;
+    };
+
+    // A Date header line for the current second, "date: ...\r\n". It is
+    // formatted again only once the second has passed, in a buffer of the
+    // calling thread valid until its next call.
+    std::string_view date_header();
+};
@@ -0,0 +1,354 @@
+#include "headers.h"
+
+#include "../utils/scan.h"
+
+#include <algorithm>
+
+namespace nimlib::Server::Handlers::Http
+{
+    static constexpr size_t KNOWN_COUNT = static_cast<size_t>(KnownHeader::COUNT);
+    static constexpr size_t FIRST_RESERVE = 512;
+
+    static constexpr std::array<std::string_view, KNOWN_COUNT> header_names
+    {
+        "accept",
+        "accept-encoding",
+        "accept-language",
+        "accept-ranges",
+        "cache-control",
+        "connection",
+        "content-encoding",
+        "content-length",
+        "content-range",
+        "content-type",
+        "cookie",
+        "date",
+        "etag",
+        "host",
+        "if-modified-since",
+        "if-none-match",
+        "if-range",
+        "last-modified",
+        "range",
+        "transfer-encoding",
+        "user-agent",
+        "vary"
+    };
+
+    // The length and the first and last characters tell the known names
+    // apart, the constants were searched for so that no two share a slot.
+    static constexpr size_t HASH_SLOTS = 64;
+
+    static constexpr size_t name_hash(std::string_view name)
+    {
+        return (name.size() * 5 + static_cast<unsigned char>(name.front()) * 26 + static_cast<unsigned char>(name.back())) % HASH_SLOTS;
+    }
+
+    // One more than the known header in each slot, 0 for none.
+    static constexpr std::array<uint8_t, HASH_SLOTS> hash_slots = []()
+        {
+            std::array<uint8_t, HASH_SLOTS> slots{};
+            for (size_t i = 0; i < KNOWN_COUNT; i++) slots[name_hash(header_names[i])] = static_cast<uint8_t>(i + 1);
+            return slots;
+        }();
+
+    static constexpr bool hash_is_perfect()
+    {
+        for (size_t i = 0; i < KNOWN_COUNT; i++)
+        {
+            if (hash_slots[name_hash(header_names[i])] != i + 1) return false;
+        }
+        return true;
+    }
+
+    static_assert(hash_is_perfect(), "two well known header names hash to the same slot, pick other constants");
+
+    std::string_view header_name(KnownHeader header) { return header_names[static_cast<size_t>(header)]; }
+
+    std::optional<KnownHeader> known_header(std::string_view name)
+    {
+        if (name.empty()) return {};
+
+        auto slot = hash_slots[name_hash(name)];
+        if (slot == 0 || header_names[slot - 1] != name) return {};
+        return static_cast<KnownHeader>(slot - 1);
+    }
+
+    static KnownHeader known_or_count(std::string_view name)
+    {
+        auto known = known_header(name);
+        return known ? *known : KnownHeader::COUNT;
+    }
+
+    namespace
+    {
+        // A name lower cased the way fields keep it, on the stack unless it is
+        // longer than header names usually are.
+        class LoweredName
+        {
+        public:
+            LoweredName(std::string_view name, std::pmr::polymorphic_allocator<> allocator) : long_name{ allocator }
+            {
+                char* out = short_name.data();
+                if (name.size() > short_name.size())
+                {
+                    long_name.resize(name.size());
+                    out = long_name.data();
+                }
+
+                Utils::Scan::to_lower(name, out);
+                lowered = { out, name.size() };
+            }
+
+            LoweredName(const LoweredName&) = delete;
+            LoweredName& operator=(const LoweredName&) = delete;
+
+            std::string_view view() const { return lowered; }
+
+        private:
+            std::array<char, 32> short_name;
+            std::pmr::string long_name;
+            std::string_view lowered;
+        };
+    };
+
+    Headers::Headers(allocator_type allocator) : more_fields{ allocator }, bytes{ allocator } {}
+
+    void Headers::add(std::string_view name, std::string_view value)
+    {
+        // Names are lower cased where they are kept, a known one only needs
+        // lower casing to be recognised.
+        LoweredName lowered{ name, bytes.get_allocator() };
+        auto known = known_or_count(lowered.view());
+        add_field(known, known == KnownHeader::COUNT ? lowered.view() : std::string_view{}, value);
+    }
+
+    void Headers::add(KnownHeader header, std::string_view value) { add_field(header, {}, value); }
+
+    void Headers::set(std::string_view name, std::string_view value)
+    {
+        LoweredName lowered{ name, bytes.get_allocator() };
+        auto known = known_or_count(lowered.view());
+        if (known != KnownHeader::COUNT) return set(known, value);
+
+        remove_fields(KnownHeader::COUNT, lowered.view());
+        add_field(KnownHeader::COUNT, lowered.view(), value);
+    }
+
+    void Headers::set(KnownHeader header, std::string_view value)
+    {
+        auto at = find(header, {});
+        if (at == NONE) return add_field(header, {}, value);
+
+        // The first field keeps its place and takes the value, any others
+        // go. Only fields after it are removed, it stays where it is.
+        auto& kept = field(at);
+        kept.value_at = static_cast<uint32_t>(bytes.size());
+        kept.value_size = static_cast<uint32_t>(value.size());
+        bytes.append(value);
+        if (find(header, {}, at + 1) != NONE)
+        {
+            kept.known = KnownHeader::COUNT;
+            remove_fields(header, {});
+            field(at).known = header;
+            first_known[static_cast<size_t>(header)] = static_cast<uint16_t>(at + 1);
+        }
+    }
+
+    void Headers::remove(std::string_view name)
+    {
+        LoweredName lowered{ name, bytes.get_allocator() };
+        remove_fields(known_or_count(lowered.view()), lowered.view());
+    }
+
+    void Headers::remove(KnownHeader header) { remove_fields(header, {}); }
+
+    std::optional<std::string_view> Headers::get(std::string_view name) const
+    {
+        LoweredName lowered{ name, bytes.get_allocator() };
+        auto at = find(known_or_count(lowered.view()), lowered.view());
+        if (at == NONE) return {};
+        return value_of(field(at));
+    }
+
+    std::optional<std::string_view> Headers::get(KnownHeader header) const
+    {
+        auto first = first_known[static_cast<size_t>(header)];
+        if (first == 0) return {};
+        return value_of(field(first - 1));
+    }
+
+    bool Headers::contains(std::string_view name) const
+    {
+        LoweredName lowered{ name, bytes.get_allocator() };
+        return find(known_or_count(lowered.view()), lowered.view()) != NONE;
+    }
+
+    bool Headers::contains(KnownHeader header) const { return first_known[static_cast<size_t>(header)] != 0; }
+
+    Headers::ValueList Headers::list(std::string_view name) const
+    {
+        LoweredName lowered{ name, bytes.get_allocator() };
+        auto known = known_or_count(lowered.view());
+        if (known != KnownHeader::COUNT) return { this, known, {} };
+
+        // The list outlives the lowered name, it looks for the name as the
+        // first field keeps it. With no such field nothing matches the
+        // name as given either.
+        auto at = find(known, lowered.view());
+        return { this, known, at == NONE ? name : name_of(field(at)) };
+    }
+
+    Headers::ValueList Headers::list(KnownHeader header) const { return { this, header, {} }; }
+
+    size_t Headers::size() const { return field_count; }
+
+    bool Headers::empty() const { return field_count == 0; }
+
+    void Headers::clear()
+    {
+        field_count = 0;
+        more_fields.clear();
+        first_known.fill(0);
+        bytes.clear();
+    }
+
+    HeaderView Headers::operator[](size_t i) const
+    {
+        const auto& at = field(i);
+        return { name_of(at), value_of(at) };
+    }
+
+    Headers::Iterator Headers::begin() const { return { this, 0 }; }
+
+    Headers::Iterator Headers::end() const { return { this, field_count }; }
+
+    Headers::allocator_type Headers::get_allocator() const { return bytes.get_allocator(); }
+
+    void Headers::add_field(KnownHeader known, std::string_view name, std::string_view value)
+    {
+        // Room for the usual fields of a request at once, rather than
+        // growing the string a few times on the way.
+        if (bytes.capacity() < FIRST_RESERVE) bytes.reserve(FIRST_RESERVE);
+
+        Field added{ static_cast<uint32_t>(bytes.size()), static_cast<uint32_t>(name.size()), 0, static_cast<uint32_t>(value.size()), known };
+        if (known == KnownHeader::COUNT) bytes.append(name);
+        added.value_at = static_cast<uint32_t>(bytes.size());
+        bytes.append(value);
+
+        if (field_count < INLINE_FIELDS) inline_fields[field_count] = added;
+        else more_fields.push_back(added);
+        field_count++;
+
+        if (known != KnownHeader::COUNT && first_known[static_cast<size_t>(known)] == 0)
+        {
+            first_known[static_cast<size_t>(known)] = static_cast<uint16_t>(field_count);
+        }
+    }
+
+    void Headers::remove_fields(KnownHeader known, std::string_view name)
+    {
+        // The fields left are moved up, their bytes stay where they are
+        // until the headers are cleared.
+        size_t kept = 0;
+        for (size_t i = 0; i < field_count; i++)
+        {
+            const auto& current = field(i);
+            bool removed = current.known == known && (known != KnownHeader::COUNT || name_of(current) == name);
+            if (!removed) field(kept++) = field(i);
+        }
+
+        if (kept == field_count) return;
+        field_count = kept;
+        if (more_fields.size() > field_count - std::min(field_count, INLINE_FIELDS))
+        {
+            more_fields.resize(field_count - std::min(field_count, INLINE_FIELDS));
+        }
+
+        first_known.fill(0);
+        for (size_t i = 0; i < field_count; i++)
+        {
+            auto at = field(i).known;
+            if (at != KnownHeader::COUNT && first_known[static_cast<size_t>(at)] == 0)
+            {
+                first_known[static_cast<size_t>(at)] = static_cast<uint16_t>(i + 1);
+            }
+        }
+    }
+
+    size_t Headers::find(KnownHeader known, std::string_view name, size_t from) const
+    {
+        if (known != KnownHeader::COUNT && from == 0)
+        {
+            auto first = first_known[static_cast<size_t>(known)];
+            return first == 0 ? NONE : first - 1;
+        }
+
+        for (size_t i = from; i < field_count; i++)
+        {
+            const auto& current = field(i);
+            if (current.known == known && (known != KnownHeader::COUNT || name_of(current) == name)) return i;
+        }
+
+        return NONE;
+    }
+
+    const Headers::Field& Headers::field(size_t i) const { return i < INLINE_FIELDS ? inline_fields[i] : more_fields[i - INLINE_FIELDS]; }
+
+    Headers::Field& Headers::field(size_t i) { return i < INLINE_FIELDS ? inline_fields[i] : more_fields[i - INLINE_FIELDS]; }
+
+    std::string_view Headers::name_of(const Field& field) const
+    {
+        if (field.known != KnownHeader::COUNT) return header_name(field.known);
+        return std::string_view{ bytes }.substr(field.name_at, field.name_size);
+    }
+
+    std::string_view Headers::value_of(const Field& field) const { return std::string_view{ bytes }.substr(field.value_at, field.value_size); }
+
+    static std::string_view trim(std::string_view s)
+    {
+        auto begin = s.find_first_not_of(" \t");
+        if (begin == std::string_view::npos) return {};
+        return s.substr(begin, s.find_last_not_of(" \t") + 1 - begin);
+    }
+
+    Headers::ValueList::Iterator::Iterator(const ValueList* list, size_t field) : list{ list }, field{ field }
+    {
+        if (field == NONE) return;
+        rest = list->headers->value_of(list->headers->field(field));
+        advance();
+    }
+
+    Headers::ValueList::Iterator& Headers::ValueList::Iterator::operator++()
+    {
+        advance();
+        return *this;
+    }
+
+    void Headers::ValueList::Iterator::advance()
+    {
+        while (field != NONE)
+        {
+            while (rest.data() != nullptr)
+            {
+                auto comma = rest.find(',');
+                value = trim(rest.substr(0, comma));
+                // The end of a field is told from an empty rest by its null
+                // data.
+                rest = comma == std::string_view::npos ? std::string_view{} : rest.substr(comma + 1);
+                if (!value.empty()) return;
+            }
+
+            field = list->headers->find(list->known, list->name, field + 1);
+            if (field != NONE) rest = list->headers->value_of(list->headers->field(field));
+        }
+
+        value = {};
+    }
+
+    Headers::ValueList::Iterator Headers::ValueList::begin() const { return { this, headers->find(known, name) }; }
+
+    Headers::ValueList::Iterator Headers::ValueList::end() const { return { this, NONE }; }
+
+    bool Headers::ValueList::empty() const { return begin() == end(); }
+};
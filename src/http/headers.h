@@ -0,0 +1,220 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nimlib::Server::Handlers::Http
+{
+    // Header names the server reads or writes itself, and the ones most
+    // requests carry. Their names are kept once, lower case as they are
+    // sent, rather than spelled out wherever they are used, and headers with
+    // them are found without comparing names, see Headers.
+    enum class KnownHeader : uint8_t
+    {
+        ACCEPT,
+        ACCEPT_ENCODING,
+        ACCEPT_LANGUAGE,
+        ACCEPT_RANGES,
+        CACHE_CONTROL,
+        CONNECTION,
+        CONTENT_ENCODING,
+        CONTENT_LENGTH,
+        CONTENT_RANGE,
+        CONTENT_TYPE,
+        COOKIE,
+        DATE,
+        ETAG,
+        HOST,
+        IF_MODIFIED_SINCE,
+        IF_NONE_MATCH,
+        IF_RANGE,
+        LAST_MODIFIED,
+        RANGE,
+        TRANSFER_ENCODING,
+        USER_AGENT,
+        VARY,
+        COUNT
+    };
+
+    std::string_view header_name(KnownHeader header);
+
+    // Which well known header a lower case name is, if any, found with a
+    // perfect hash over the known names: one hash and one comparison.
+    std::optional<KnownHeader> known_header(std::string_view name);
+
+    struct HeaderView
+    {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    // The header fields of a request or a response, in the order they were
+    // added, with their names in lower case.
+    //
+    // The first INLINE_FIELDS fields are kept in the object itself, names
+    // and values in one string next to them, so a request with the usual
+    // headers takes a single allocation for all of them, and a response
+    // reused from one request to the next takes none. The first field of
+    // each well known header is found without looking at the others.
+    //
+    // Values are kept as they were received. A field holding a list is split
+    // on its commas only by list(), as it is read.
+    //
+    // Fields past the inline ones, and the string, come from the allocator
+    // the headers are created with, see Arena.
+    class Headers
+    {
+    public:
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        static constexpr size_t INLINE_FIELDS = 16;
+
+        class Iterator;
+        class ValueList;
+
+        Headers() = default;
+        explicit Headers(allocator_type allocator);
+        ~Headers() = default;
+
+        Headers(const Headers&) = default;
+        Headers& operator=(const Headers&) = default;
+        Headers(Headers&&) noexcept = default;
+        Headers& operator=(Headers&&) noexcept = default;
+
+        // Adds a field after the others, the name is lower cased.
+        void add(std::string_view name, std::string_view value);
+        void add(KnownHeader header, std::string_view value);
+        // Replaces every field with the name by one with this value.
+        void set(std::string_view name, std::string_view value);
+        void set(KnownHeader header, std::string_view value);
+        void remove(std::string_view name);
+        void remove(KnownHeader header);
+
+        // The value of the first field with the name. Names given here and
+        // to the others above and below are matched in any case.
+        std::optional<std::string_view> get(std::string_view name) const;
+        std::optional<std::string_view> get(KnownHeader header) const;
+        bool contains(std::string_view name) const;
+        bool contains(KnownHeader header) const;
+        // The comma separated values of every field with the name, trimmed.
+        ValueList list(std::string_view name) const;
+        ValueList list(KnownHeader header) const;
+
+        size_t size() const;
+        bool empty() const;
+        // Forgets the fields, keeping the memory they took for the next ones.
+        void clear();
+
+        HeaderView operator[](size_t i) const;
+        Iterator begin() const;
+        Iterator end() const;
+
+        allocator_type get_allocator() const;
+
+    private:
+        struct Field
+        {
+            uint32_t name_at;
+            uint32_t name_size;
+            uint32_t value_at;
+            uint32_t value_size;
+            // COUNT for the other names, which are kept in `bytes`.
+            KnownHeader known;
+        };
+
+        static constexpr size_t NONE = static_cast<size_t>(-1);
+
+        void add_field(KnownHeader known, std::string_view name, std::string_view value);
+        void remove_fields(KnownHeader known, std::string_view name);
+        size_t find(KnownHeader known, std::string_view name, size_t from = 0) const;
+        const Field& field(size_t i) const;
+        Field& field(size_t i);
+        std::string_view name_of(const Field& field) const;
+        std::string_view value_of(const Field& field) const;
+
+    private:
+        std::array<Field, INLINE_FIELDS> inline_fields{};
+        std::pmr::vector<Field> more_fields{};
+        size_t field_count{};
+        // One more than the index of the first field of each well known
+        // header, 0 when there is none.
+        std::array<uint16_t, static_cast<size_t>(KnownHeader::COUNT)> first_known{};
+        // Names of the fields that are not well known, and all values.
+        std::pmr::string bytes{};
+    };
+
+    class Headers::Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = HeaderView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = HeaderView;
+
+        Iterator() = default;
+        Iterator(const Headers* headers, size_t at) : headers{ headers }, at{ at } {}
+
+        HeaderView operator*() const { return (*headers)[at]; }
+        Iterator& operator++() { at++; return *this; }
+        Iterator operator++(int) { auto before = *this; at++; return before; }
+        bool operator==(const Iterator& other) const { return at == other.at; }
+
+    private:
+        const Headers* headers{ nullptr };
+        size_t at{};
+    };
+
+    // The values of a list header, read a comma at a time from the fields
+    // they are in. Empty values are skipped.
+    class Headers::ValueList
+    {
+    public:
+        class Iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = std::string_view;
+
+            Iterator() = default;
+            Iterator(const ValueList* list, size_t field);
+
+            std::string_view operator*() const { return value; }
+            Iterator& operator++();
+            Iterator operator++(int) { auto before = *this; ++*this; return before; }
+            bool operator==(const Iterator& other) const { return field == other.field && rest.data() == other.rest.data(); }
+
+        private:
+            // Moves to the next value that is not empty, in this field or
+            // the ones after it.
+            void advance();
+
+        private:
+            const ValueList* list{ nullptr };
+            size_t field{ NONE };
+            std::string_view rest{};
+            std::string_view value{};
+        };
+
+        ValueList(const Headers* headers, KnownHeader known, std::string_view name) : headers{ headers }, known{ known }, name{ name } {}
+
+        Iterator begin() const;
+        Iterator end() const;
+        bool empty() const;
+
+    private:
+        const Headers* headers;
+        KnownHeader known;
+        std::string_view name;
+    };
+};
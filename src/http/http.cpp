@@ -1,69 +1,225 @@
 #include "http.h"
+#include "serializer.h"
+#include "static_response.h"
 #include "../metrics/metrics_store.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <memory>
 #include <sstream>
 #include <cassert>
 
 namespace nimlib::Server::Handlers::Http
 {
-    HttpHandler::HttpHandler()
+    const named_handlers& builtin_handlers()
     {
-        auto metrics_handler = [](const Request& request, Response& response, params_t params) -> std::optional<HandlerState>
-            {
-                auto& metrics_store = nimlib::Server::Metrics::MetricsStore<long>::get_instance();
-                auto report = metrics_store.generate_stats_report();
+        static const named_handlers handlers
+        {
+            // Reports the metrics of the loop answering the request only,
+            // with several loops each keeps its own, see MetricsStore. The
+            // static file cache's metric is registered with each store when
+            // its loop starts, not here.
+            {"metrics", [](const Request& request, Response& response, params_t& params) -> std::optional<HandlerState>
+                {
+                    auto& metrics_store = nimlib::Server::Metrics::MetricsStore<long>::get_instance();
+                    auto report = metrics_store.generate_stats_report();
 
-                response.status = 200;
-                response.reason = "OK";
-                response.headers["content-type"].push_back("text/plain");
-                response.body = report;
+                    response.status = 200;
+                    response.reason = "OK";
+                    response.headers.add(KnownHeader::CONTENT_TYPE, "text/plain");
+                    response.body = report;
 
-                return HandlerState::FINISHED_NO_WAIT;
-            };
+                    return HandlerState::FINISHED_WAIT;
+                }},
+            // Nothing about these depends on the request, they are serialized
+            // once and copied out as they are.
+            {"not_found", constant_handler({ 404, "Not found", "text/html; charset=UTF-8", "not found" })},
+            {"health", constant_handler({ 200, "OK", "text/plain", "ok", true })}
+        };
 
-        auto fallback_router = [](const Request& request, Response& response, params_t params) -> std::optional<HandlerState>
-            {
-                response.status = 404;
-                response.reason = "Not found";
-                response.headers["content-type"].push_back("text/html; charset=UTF-8");
-                response.body = "not found";
+        return handlers;
+    }
 
-                return HandlerState::FINISHED_NO_WAIT;
-            };
+    static std::shared_ptr<const Router> build_default_router()
+    {
+        Router router{};
+        auto& handlers = builtin_handlers();
 
-        router.get("/metrics", metrics_handler);
-        router.get("/", fallback_router);
+        router.get("/metrics", handlers.at("metrics"));
+        router.get("/health", handlers.at("health"));
+        router.get("/", handlers.at("not_found"));
         router.serve_static_big("/files/big", "/absolute/path/to/big/file");
         router.serve_static("/files/small", "/absolute/path/to/small/file");
-        router.fallback(fallback_router);
+        router.fallback(handlers.at("not_found"));
+
+        return std::make_shared<const Router>(std::move(router));
+    }
+
+    std::shared_ptr<const Router> default_router()
+    {
+        // Nothing about the routes depends on the connection, building them
+        // on every accept used to cost a trie and a few filesystem calls.
+        static const std::shared_ptr<const Router> router{ build_default_router() };
+        return router;
+    }
+
+    RouteTable& route_table()
+    {
+        static RouteTable table{ default_router() };
+        return table;
+    }
+
+    static std::atomic<size_t> body_memory_limit_bytes{ RequestBody::DEFAULT_MEMORY_LIMIT };
+
+    void set_body_memory_limit(size_t bytes) { body_memory_limit_bytes = bytes; }
+
+    size_t body_memory_limit() { return body_memory_limit_bytes; }
+
+    static std::atomic<size_t> max_body_size_bytes{ BodyReader::DEFAULT_MAX_SIZE };
+
+    void set_max_body_size(size_t bytes) { max_body_size_bytes = bytes; }
+
+    size_t max_body_size() { return max_body_size_bytes; }
+
+    // Answers a request refused for the size of its body.
+    static const std::shared_ptr<const ConstantResponse>& content_too_large()
+    {
+        static const auto response = std::make_shared<const ConstantResponse>(413, "Content Too Large", "text/plain", "content too large");
+        return response;
+    }
+
+    // Kept apart rather than as one atomic struct, which is too wide to be
+    // lock free.
+    static std::atomic<int> compression_level{ CompressionSettings{}.level };
+    static std::atomic<size_t> compression_min_size{ CompressionSettings{}.min_size };
+
+    void set_response_compression(CompressionSettings settings)
+    {
+        compression_min_size = settings.min_size;
+        compression_level = settings.level;
+    }
+
+    CompressionSettings response_compression() { return { compression_level, compression_min_size }; }
+
+    HttpHandler::HttpHandler() : HttpHandler(route_table()) {}
+
+    HttpHandler::HttpHandler(RouteTable& routes) : routes{ &routes } {}
+
+    HttpHandler::HttpHandler(std::shared_ptr<const Router> router) : router{ std::move(router) } {}
+
+    void HttpHandler::refresh_router()
+    {
+        // Only a handler about to start on a new request moves to newly
+        // published routes, a request already being served, or still being
+        // received, stays on the snapshot it started with.
+        if (routes && !receiving) routes->refresh(router, router_version);
     }
 
     void HttpHandler::notify(Connection& connection, StreamsProvider& streams)
     {
-        if (!http_request) // There is new data to parse.
+        handle(streams);
+        connection.notify(*this);
+    }
+
+    void HttpHandler::notify(Handler& handler, Connection& connection, StreamsProvider& streams)
+    {
+        handle(streams);
+        handler.notify(*this, connection, streams);
+    }
+
+    void HttpHandler::handle(StreamsProvider& streams)
+    {
+        if (http_request) // This is an existing request for further processing.
         {
-            if (state_manager.set_state(HandlerState::H_HANDLING) == HandlerState::HANDLER_ERROR)
+            // This branch should only be taken after the handler state has
+            // transitioned to RECALL. This means, there should be a parsed
+            // HTTP request already available.
+            recall_arena.reset();
+            reset_response();
+            std::optional<HandlerState> routing_result = router->route(http_request.value(), response, &recall_arena);
+
+            if (routing_result && routing_result.value() != HandlerState::HANDLER_ERROR)
             {
-                return;
+                bool compressed = !stream_compressor || compress_chunk(routing_result.value() != HandlerState::RECALL);
+                streams.sink().append(std::move(response.body));
+                // A stream that can not be compressed is cut short, the
+                // client sees it did not end.
+                state_manager.set_state(!compressed || (routing_result.value() == HandlerState::FINISHED_WAIT && !keep_alive)
+                    ? HandlerState::FINISHED_NO_WAIT
+                    : routing_result.value());
+            }
+
+            if (state_manager.get_state() != HandlerState::RECALL) http_request = std::nullopt;
+            if (state_manager.get_state() != HandlerState::FINISHED_WAIT) return;
+        }
+
+        // Every complete request received so far is answered in order, their
+        // responses are written to the sink one after the other and go out in
+        // a single write. A request that has only partly arrived is left for
+        // after that write.
+        auto& source = streams.source();
+        int answered = 0;
+
+        while (answered < MAX_PIPELINED_REQUESTS)
+        {
+            refresh_router();
+            recycle_arena();
+            auto parse_result = read_request(source);
+
+            if (parse_result == RequestParser::Result::INCOMPLETE)
+            {
+                // Only part of the request has arrived, the parser picks up
+                // where it stopped once there is more.
+                if (answered == 0 && start_request()) state_manager.set_state(HandlerState::INCOMPLETE_INPUT);
+                break;
             }
 
-            auto& connection_source = streams.source();
-            http_request = parse_request(connection_source);
+            if (!start_request()) break;
 
             if (http_request) // HTTP request parsed successfully.
             {
-                Response http_response;
-                std::optional<HandlerState> routing_result = router.route(http_request.value(), http_response);
+                reset_response();
+                std::optional<HandlerState> routing_result = router->route(http_request.value(), response);
 
-                if (routing_result && routing_result.value() != HandlerState::INCOMPLETE_INPUT)
+                if (routing_result && routing_result.value() != HandlerState::INCOMPLETE_INPUT && response.constant)
                 {
-                    auto response_opt = parse_response(http_response);
-                    if (response_opt)
+                    state_manager.set_state(send_constant(routing_result.value(), streams.sink()));
+                }
+                else if (routing_result && routing_result.value() != HandlerState::INCOMPLETE_INPUT)
+                {
+                    // The head is copied into the sink, a long body or a file is
+                    // handed over as it is and written from where it is.
+                    compress_response(routing_result.value());
+                    auto state = finish_response(routing_result.value());
+                    auto& sink = streams.sink();
+                    write_response_head(response, sink);
+                    if (!response.ranges.empty())
+                    {
+                        for (auto& range : response.ranges)
+                        {
+                            sink.append(std::move(range.head));
+                            if (response.file) sink.append(response.file, range.offset, range.size);
+                            else if (response.shared_body) sink.append(response.shared_body, range.offset, range.size);
+                        }
+                        sink.append(std::move(response.body));
+                    }
+                    else if (response.file)
+                    {
+                        auto size = response.file->size();
+                        sink.append(std::move(response.file), 0, size);
+                    }
+                    else if (response.shared_body)
+                    {
+                        sink.append(std::move(response.shared_body));
+                    }
+                    else
                     {
-                        auto& connection_sink = streams.sink();
-                        connection_sink << response_opt.value();
-                        state_manager.set_state(routing_result.value());
+                        sink.append(std::move(response.body));
                     }
+                    state_manager.set_state(state);
                 }
                 else
                 {
@@ -71,110 +227,321 @@ namespace nimlib::Server::Handlers::Http
                     state_manager.set_state(HandlerState::FINISHED_NO_WAIT);
                 }
             }
+            else if (body_too_large)
+            {
+                // The rest of the body is not read, the connection is closed
+                // once the answer is written.
+                body_too_large = false;
+                reset_response();
+                response.constant = content_too_large();
+                state_manager.set_state(send_constant(HandlerState::FINISHED_NO_WAIT, streams.sink()));
+            }
             else
             {
                 // Create and send a bad request response.
                 state_manager.set_state(HandlerState::FINISHED_NO_WAIT);
             }
-        }
-        else // This is an existing request for further processing.
-        {
-            // This branch should only be taken after the handler state has
-            // transitioned to INCOMPLETE_INPUT or RECALL. This means, there
-            // should be a parsed HTTP request already available.
-            auto state = state_manager.get_state();
-            assert(http_request);
 
-            Response http_response;
-            std::optional<HandlerState> routing_result = router.route(http_request.value(), http_response);
+            answered++;
 
-            if (routing_result && routing_result.value() != HandlerState::HANDLER_ERROR)
-            {
-                auto& connection_sink = streams.sink();
-                connection_sink << http_response.body;
-                state_manager.set_state(routing_result.value());
-            }
+            // Only a request answered in full, on a connection that stays
+            // open, lets the next one in.
+            auto state = state_manager.get_state();
+            if (state != HandlerState::RECALL) http_request = std::nullopt;
+            if (state != HandlerState::FINISHED_WAIT) break;
+
+            // Responses waiting to be written are not piled up further, the
+            // requests left are answered once they are out.
+            if (streams.sink().over_high_watermark()) break;
         }
+    }
 
+    bool HttpHandler::start_request()
+    {
         auto state = state_manager.get_state();
-        if (state == HandlerState::FINISHED_NO_WAIT
-            || state == HandlerState::FINISHED_WAIT
-            || state == HandlerState::HANDLER_ERROR)
+        if (state == HandlerState::FINISHED_WAIT || state == HandlerState::FINISHED_NO_WAIT)
         {
-            http_request = std::nullopt;
+            state_manager.set_state(HandlerState::READY_TO_HANDLE);
         }
 
-        connection.notify(*this);
+        return state_manager.set_state(HandlerState::H_HANDLING) != HandlerState::HANDLER_ERROR;
     }
 
-    void HttpHandler::notify(Handler& handler, Connection& connection, StreamsProvider& streams)
+    void HttpHandler::recycle_arena()
+    {
+        // A request whose body is still arriving is kept on the arena. Once
+        // the last response is written nothing on it is used any more, the
+        // response is built again, empty. Assigning an empty one would not
+        // do, a string moved from a short one keeps the memory it had.
+        if (receiving || http_request) return;
+
+        std::destroy_at(&response);
+        arena.reset();
+        std::construct_at(&response, &arena);
+    }
+
+    void HttpHandler::reset_response()
+    {
+        response.version = "HTTP/1.1";
+        response.status = 0;
+        response.reason.clear();
+        response.headers.clear();
+        response.body.clear();
+        response.file.reset();
+        response.shared_body.reset();
+        response.header_block.reset();
+        response.ranges.clear();
+        response.constant.reset();
+    }
+
+    HandlerState HttpHandler::finish_response(HandlerState routed)
     {
-        if (!http_request) // There is new data to parse.
+        // A route can close the connection, but only the client, and the
+        // number of requests already served on it, can keep it open.
+        bool closing = routed == HandlerState::FINISHED_NO_WAIT || (routed == HandlerState::FINISHED_WAIT && !keep_alive);
+        if (closing || !keep_alive)
         {
-            if (state_manager.set_state(HandlerState::H_HANDLING) == HandlerState::HANDLER_ERROR)
+            response.headers.set(KnownHeader::CONNECTION, "close");
+        }
+        else if (announce_keep_alive)
+        {
+            response.headers.set(KnownHeader::CONNECTION, "keep-alive");
+        }
+
+        return closing ? HandlerState::FINISHED_NO_WAIT : routed;
+    }
+
+    HandlerState HttpHandler::send_constant(HandlerState routed, OutputQueue& sink)
+    {
+        const auto& constant = *response.constant;
+        bool closing = routed == HandlerState::FINISHED_NO_WAIT || !keep_alive;
+
+        // Only the headers depending on the connection and the time are
+        // added, the rest is copied as it was serialized. A body too long to
+        // be worth copying is shared instead.
+        sink.append(constant.head());
+        if (closing) sink << "connection: close\r\n";
+        else if (announce_keep_alive) sink << "connection: keep-alive\r\n";
+        if (constant.dated()) sink.append(date_header());
+        if (constant.tail().size() < OutputQueue::COPY_BELOW) sink.append(constant.tail());
+        else sink.append(constant.bytes(), constant.head_size());
+
+        return closing ? HandlerState::FINISHED_NO_WAIT : routed;
+    }
+
+    // Compressed bodies are written here and swapped with the response's,
+    // so that each thread reuses the same few buffers.
+    static std::string& compression_buffer()
+    {
+        thread_local std::string buffer{};
+        buffer.clear();
+        return buffer;
+    }
+
+    // Appends `data` to `out` as one chunk of a chunked body.
+    static void append_chunk(std::string_view data, std::string& out)
+    {
+        char size[24];
+        auto length = std::snprintf(size, sizeof(size), "%zx\r\n", data.size());
+        out.append(size, length);
+        out.append(data);
+        out.append("\r\n");
+    }
+
+    void HttpHandler::compress_response(HandlerState routed)
+    {
+        static const std::vector<EncodedVariant> gzip_only{ { "gzip", {} } };
+
+        stream_compressor.reset();
+
+        // Only a body built in memory, one the route has not encoded or
+        // measured itself.
+        if (response.file || response.shared_body || response.header_block || !response.ranges.empty()) return;
+        if (response.status < 200 || response.status == 204 || response.status == 206 || response.status == 304) return;
+        if (response.headers.contains(KnownHeader::CONTENT_ENCODING)
+            || response.headers.contains(KnownHeader::CONTENT_LENGTH)
+            || response.headers.contains(KnownHeader::TRANSFER_ENCODING)) return;
+
+        auto settings = response_compression();
+        if (settings.level <= 0 || !nimlib::Server::Utils::gzip_available()) return;
+
+        auto content_type = response.headers.get(KnownHeader::CONTENT_TYPE);
+        if (!content_type || !nimlib::Server::Utils::compressible_type(*content_type)) return;
+
+        // A streamed body goes out in chunks, which HTTP/1.0 clients do not
+        // read.
+        bool streaming = routed == HandlerState::RECALL;
+        if (streaming ? http_request->version != "HTTP/1.1" : response.body.size() < settings.min_size) return;
+
+        // Caches keep a response per coding the client accepts.
+        response.headers.set(KnownHeader::VARY, "accept-encoding");
+        if (!choose_variant(*http_request, gzip_only)) return;
+
+        auto& compressed = compression_buffer();
+        if (streaming)
+        {
+            stream_compressor = std::make_unique<nimlib::Server::Utils::GzipStream>(settings.level);
+            if (!stream_compressor->write(response.body, compressed, true))
             {
+                stream_compressor.reset();
                 return;
             }
 
-            auto& tls_source = streams.source();
-            http_request = parse_request(tls_source);
-
-            if (http_request) // HTTP request parsed successfully.
+            response.body.clear();
+            if (!compressed.empty()) append_chunk(compressed, response.body);
+            response.headers.set(KnownHeader::TRANSFER_ENCODING, "chunked");
+        }
+        else
+        {
+            // A deflate stream takes a few hundred kilobytes, one per thread
+            // is shared by all its connections.
+            thread_local std::unique_ptr<nimlib::Server::Utils::GzipStream> compressor{};
+            if (!compressor || compressor->level() != settings.level)
             {
-                Response http_response;
-                std::optional<HandlerState> routing_result = router.route(http_request.value(), http_response);
+                compressor = std::make_unique<nimlib::Server::Utils::GzipStream>(settings.level);
+            }
+
+            if (!compressor->finish(response.body, compressed)) return;
+            std::swap(response.body, compressed);
+        }
+
+        response.headers.set(KnownHeader::CONTENT_ENCODING, "gzip");
+    }
+
+    bool HttpHandler::compress_chunk(bool last)
+    {
+        auto& compressed = compression_buffer();
+        bool written = last
+            ? stream_compressor->finish(response.body, compressed)
+            : stream_compressor->write(response.body, compressed, true);
+
+        response.body.clear();
+        if (!compressed.empty()) append_chunk(compressed, response.body);
+        if (last && written) response.body.append("0\r\n\r\n");
+        if (last || !written) stream_compressor.reset();
+
+        return written;
+    }
+
+    static std::string_view trim(std::string_view s)
+    {
+        auto begin = s.find_first_not_of(" \t");
+        if (begin == std::string_view::npos) return {};
+        return s.substr(begin, s.find_last_not_of(" \t") + 1 - begin);
+    }
 
-                if (routing_result && routing_result.value() != HandlerState::INCOMPLETE_INPUT)
+    // Compares a header value token with a lower case one, without regard to
+    // case.
+    static bool same_token(std::string_view token, std::string_view lower)
+    {
+        return std::equal(token.begin(), token.end(), lower.begin(), lower.end(),
+            [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; });
+    }
+
+    // Whether a Connection header value lists `option`.
+    static bool has_connection_option(std::string_view options, std::string_view option)
+    {
+        while (!options.empty())
+        {
+            auto comma = options.find(',');
+            if (same_token(trim(options.substr(0, comma)), option)) return true;
+            options = comma == std::string_view::npos ? std::string_view{} : options.substr(comma + 1);
+        }
+
+        return false;
+    }
+
+    // A request with a Transfer-Encoding header is only understood if its
+    // body is chunked last (RFC 9112, section 6.3).
+    static bool chunked_last(std::string_view codings)
+    {
+        auto comma = codings.rfind(',');
+        return same_token(trim(comma == std::string_view::npos ? codings : codings.substr(comma + 1)), "chunked");
+    }
+
+    bool HttpHandler::client_keeps_alive() const
+    {
+        // HTTP/1.1 connections are persistent unless the client says
+        // otherwise, HTTP/1.0 ones only if it asks for it.
+        auto connection = parser.header("connection");
+        if (connection && has_connection_option(*connection, "close")) return false;
+        if (connection && has_connection_option(*connection, "keep-alive")) return true;
+
+        return parser.version() == "HTTP/1.1";
+    }
+
+    RequestParser::Result HttpHandler::read_request(ByteBuffer& source)
+    {
+        // The request is parsed in place, in the bytes not read yet.
+        auto input = source.readable();
+
+        if (!receiving)
+        {
+            auto result = parser.parse(input);
+            if (result == RequestParser::Result::INCOMPLETE) return result;
+
+            if (result == RequestParser::Result::COMPLETE)
+            {
+                if (auto codings = parser.header("transfer-encoding"))
                 {
-                    auto response_opt = parse_response(http_response);
-                    if (response_opt)
-                    {
-                        auto& tls_sink = streams.sink();
-                        tls_sink << response_opt.value();
-                        state_manager.set_state(routing_result.value());
-                    }
+                    if (chunked_last(*codings)) body_reader.expect_chunked();
+                    else result = RequestParser::Result::INVALID;
+                }
+                else if (auto content_length = parser.header("content-length"))
+                {
+                    size_t length{};
+                    auto [end, error] = std::from_chars(content_length->data(), content_length->data() + content_length->size(), length);
+                    if (error == std::errc{} && end == content_length->data() + content_length->size()) body_reader.expect_length(length);
+                    else result = RequestParser::Result::INVALID;
                 }
                 else
                 {
-                    // Create and send a bad request response.
-                    state_manager.set_state(HandlerState::FINISHED_NO_WAIT);
+                    body_reader.expect_length(0);
                 }
             }
-            else
+
+            if (result == RequestParser::Result::COMPLETE)
             {
-                // Create and send a bad request response.
-                state_manager.set_state(HandlerState::FINISHED_NO_WAIT);
+                // The head is copied out before the bytes it was parsed from
+                // are passed over, the body is read from right after it.
+                receiving = parser.request({}, &arena);
+                served_requests++;
+                keep_alive = client_keeps_alive() && served_requests < MAX_KEEP_ALIVE_REQUESTS;
+                announce_keep_alive = keep_alive && parser.version() == "HTTP/1.0";
+
+                source.consume(parser.head_size());
+                input.remove_prefix(parser.head_size());
+                body.clear();
+                // A route that takes its body as it arrives is handed each
+                // piece from here, as the body reader decodes it.
+                if (!body_reader.complete()) body.set_sink(router->body_sink(*receiving));
             }
+
+            parser.reset();
+            if (result != RequestParser::Result::COMPLETE) return result;
         }
-        else // This is an existing request for further processing.
-        {
-            // This branch should only be taken after the handler state has
-            // transitioned to INCOMPLETE_INPUT or RECALL. This means, there
-            // should be a parsed HTTP request already available.
-            auto state = state_manager.get_state();
-            // assert(state == HandlerState::RECALL || state == HandlerState::INCOMPLETE_INPUT);
-            assert(http_request);
 
-            Response http_response;
-            std::optional<HandlerState> routing_result = router.route(http_request.value(), http_response);
+        // Body bytes are taken off the buffer as they arrive, so the
+        // connection does not need to hold on to them. Requests pipelined
+        // after this one stay in the buffer.
+        size_t consumed{};
+        auto body_result = body_reader.read(input, consumed, body);
+        source.consume(consumed);
 
-            if (routing_result && routing_result.value() != HandlerState::HANDLER_ERROR)
-            {
-                auto& tls_sink = streams.sink();
-                tls_sink << http_response.body;
-                state_manager.set_state(routing_result.value());
-            }
-        }
+        if (body_result == BodyReader::Result::INCOMPLETE) return RequestParser::Result::INCOMPLETE;
 
-        auto state = state_manager.get_state();
-        if (state == HandlerState::FINISHED_NO_WAIT
-            || state == HandlerState::FINISHED_WAIT
-            || state == HandlerState::HANDLER_ERROR)
+        http_request = std::move(receiving);
+        receiving = std::nullopt;
+        if (body_result == BodyReader::Result::INVALID || body_result == BodyReader::Result::TOO_LARGE)
         {
+            body_too_large = body_result == BodyReader::Result::TOO_LARGE;
             http_request = std::nullopt;
+            return RequestParser::Result::INVALID;
         }
 
-        handler.notify(*this, connection, streams);
+        if (body.in_memory()) http_request->body = body.view();
+        http_request->content = &body;
+        return RequestParser::Result::COMPLETE;
     }
 
     bool HttpHandler::wants_more_bytes()
@@ -1,7 +1,11 @@
 #pragma once
 
 #include "parser.h"
+#include "body_reader.h"
 #include "router.h"
+#include "route_table.h"
+#include "../utils/arena.h"
+#include "../utils/compression.h"
 #include "../utils/state_manager.h"
 #include "../common/types.h"
 
@@ -9,6 +13,8 @@ using nimlib::Server::Constants::HandlerState;
 using nimlib::Server::Utils::StateManager;
 using nimlib::Server::Types::Connection;
 using nimlib::Server::Types::StreamsProvider;
+using nimlib::Server::Utils::ByteBuffer;
+using nimlib::Server::Utils::OutputQueue;
 
 namespace nimlib::Server::Handlers::Http
 {
@@ -16,10 +22,52 @@ namespace nimlib::Server::Handlers::Http
     using nimlib::Server::Constants::HandlerState;
     class Request;
 
+    // The routes the server starts with. Built once, the first time it is
+    // asked for, then shared read only by every handler on every thread.
+    std::shared_ptr<const Router> default_router();
+
+    // Handlers route configurations can refer to by name, see load_router.
+    const named_handlers& builtin_handlers();
+
+    // The table handlers pick their routes from. It starts out with the
+    // default routes, publishing to it changes the routes new requests are
+    // served with, without restarting the server.
+    RouteTable& route_table();
+
+    // Request bodies longer than this are written to a temporary file as
+    // they arrive, see RequestBody. Applies to handlers created afterwards.
+    void set_body_memory_limit(size_t bytes);
+    size_t body_memory_limit();
+
+    // Requests with a longer body are answered with 413 Content Too Large,
+    // without being routed, and their connection is closed. Applies to
+    // handlers created afterwards.
+    void set_max_body_size(size_t bytes);
+    size_t max_body_size();
+
+    // How response bodies built in memory are compressed for clients that
+    // accept gzip. Files are not, they are sent from their precompressed
+    // copies, see Router::serve_static.
+    struct CompressionSettings
+    {
+        // From 1, fastest, to 9, smallest, 0 turns compression off.
+        int level{ 6 };
+        // Shorter bodies are sent as they are, compressing them saves less
+        // than it costs. Does not apply to bodies streamed with RECALL,
+        // their length is not known.
+        size_t min_size{ 1024 };
+    };
+
+    // Applies to responses started afterwards.
+    void set_response_compression(CompressionSettings settings);
+    CompressionSettings response_compression();
+
     class HttpHandler : public Handler
     {
     public:
         HttpHandler();
+        explicit HttpHandler(RouteTable& routes);
+        explicit HttpHandler(std::shared_ptr<const Router> router);
         ~HttpHandler() = default;
 
         void notify(Connection& connection, StreamsProvider& streams) override;
@@ -31,9 +79,55 @@ namespace nimlib::Server::Handlers::Http
 
         HandlerState get_state() override;
 
+        // Requests answered with a single write at most, when a client
+        // pipelines more, the rest wait for the next round.
+        static constexpr int MAX_PIPELINED_REQUESTS = 64;
+        // Requests served on one connection before it is closed, the response
+        // to the last one tells the client with `Connection: close`.
+        static constexpr int MAX_KEEP_ALIVE_REQUESTS = 1000;
+
+    private:
+        void handle(StreamsProvider& streams);
+        bool start_request();
+        void recycle_arena();
+        void reset_response();
+        HandlerState finish_response(HandlerState routed);
+        HandlerState send_constant(HandlerState routed, OutputQueue& sink);
+        void compress_response(HandlerState routed);
+        bool compress_chunk(bool last);
+        bool client_keeps_alive() const;
+        void refresh_router();
+        RequestParser::Result read_request(ByteBuffer& source);
+
     private:
+        // Requests, responses and whatever their handlers allocate, from
+        // one request to the next, see recycle_arena().
+        nimlib::Server::Utils::Arena arena{};
+        // What routing a RECALL chunk needs, given back before the next one.
+        // The request stays on `arena` until the last chunk, a stream of any
+        // length would grow it otherwise.
+        nimlib::Server::Utils::Arena recall_arena{};
         std::optional<Request> http_request{ std::nullopt };
-        std::optional<Response> htt_response{ std::nullopt };
-        Router router{};
+        // A request whose head has been parsed while its body is arriving.
+        std::optional<Request> receiving{ std::nullopt };
+        BodyReader body_reader{ max_body_size() };
+        // Set when the request being read was refused for its body, it is
+        // answered with 413 rather than routed.
+        bool body_too_large{ false };
+        RequestBody body{ body_memory_limit() };
+        // Reused by every request on the connection, built again on the
+        // arena each time it is reset.
+        Response response{ &arena };
+        RequestParser parser{};
+        // Compresses the body of a response streamed with RECALL, from its
+        // first chunk to its last.
+        std::unique_ptr<nimlib::Server::Utils::GzipStream> stream_compressor{};
+        int served_requests{};
+        bool keep_alive{ true };
+        // HTTP/1.0 clients are told when their connection is kept open.
+        bool announce_keep_alive{ false };
+        std::shared_ptr<const Router> router;
+        const RouteTable* routes{ nullptr };
+        uint64_t router_version{};
     };
 };
@@ -1,24 +1,30 @@
 #include "parser.h"
 
 #include "../utils/helpers.h"
+#include "../utils/scan.h"
 
+#include <charconv>
+#include <functional>
+#include <iterator>
 #include "iostream"
 
 namespace nimlib::Server::Handlers::Http
 {
+    using header_validator = const std::function<bool(const std::string& value, const Headers& headers)>;
+
     header_validator content_length_validator =
-        [](const std::string& value, const std::unordered_map<std::string, std::vector<std::string>>& headers) -> bool
+        [](const std::string& value, const Headers& headers) -> bool
         {
             // A sender MUST NOT send a Content-Length header field in any message
             // that contains a Transfer-Encoding header field.
-            if (auto it = headers.find("transfer-encoding"); it != headers.end()) return false;
+            if (headers.contains(KnownHeader::TRANSFER_ENCODING)) return false;
 
             // If a message is received without Transfer-Encoding and with
             // either multiple Content-Length header fields having differing
             // field-values or a single Content-Length header field having an
             // invalid value, then the message framing is invalid and the
             // recipient MUST treat it as an unrecoverable error.
-            if (auto it = headers.find("content-length"); it != headers.end()) return false;
+            if (headers.contains(KnownHeader::CONTENT_LENGTH)) return false;
 
             // Content-Length must be an integer and only an integer.
             std::stringstream content_length_s{ value };
@@ -28,12 +34,11 @@ namespace nimlib::Server::Handlers::Http
         };
 
     header_validator transfer_encoding_validator =
-        [](const std::string& value, const std::unordered_map<std::string, std::vector<std::string>>& headers) -> bool
+        [](const std::string& value, const Headers& headers) -> bool
         {
             // A sender MUST NOT send a Content-Length header field in any message
             // that contains a Transfer-Encoding header field.
-            if (auto it = headers.find("content-length"); it != headers.end()) return false;
-            return true;
+            return !headers.contains(KnownHeader::CONTENT_LENGTH);
         };
 
     const std::unordered_map<std::string, header_validator> header_validators
@@ -43,25 +48,237 @@ namespace nimlib::Server::Handlers::Http
     };
 
     Request::Request(
-        std::string method,
-        std::string target,
-        std::string version,
-        headers_t headers,
-        std::string body
+        std::string_view method,
+        std::string_view target,
+        std::string_view version,
+        Headers headers,
+        std::string_view body
     ) :
-        method{ std::move(method) },
-        target{ std::move(target) },
-        version{ std::move(version) },
+        method{ method, headers.get_allocator() },
+        target{ target, headers.get_allocator() },
+        version{ version, headers.get_allocator() },
         headers{ std::move(headers) },
-        body{ std::move(body) }
+        body{ body, this->headers.get_allocator() }
+    {}
+
+    Request::Request(allocator_type allocator) :
+        method{ allocator },
+        target{ allocator },
+        version{ allocator },
+        headers{ allocator },
+        body{ allocator }
     {}
 
+    Request::allocator_type Request::get_allocator() const { return headers.get_allocator(); }
+
+    Response::Response(allocator_type allocator) :
+        version{ "HTTP/1.1", allocator },
+        reason{ allocator },
+        headers{ allocator },
+        ranges{ allocator }
+    {}
+
+    // Compares a header name as received with a lower case name.
+    static bool same_header_name(std::string_view name, std::string_view lower_case_name)
+    {
+        if (name.size() != lower_case_name.size()) return false;
+
+        for (size_t i = 0; i < name.size(); i++)
+        {
+            if (std::tolower(static_cast<unsigned char>(name[i])) != lower_case_name[i]) return false;
+        }
+
+        return true;
+    }
+
+    static std::string_view trim_white_space(std::string_view value)
+    {
+        while (!value.empty() && white_space(value.front())) value.remove_prefix(1);
+        while (!value.empty() && white_space(value.back())) value.remove_suffix(1);
+        return value;
+    }
+
+    RequestParser::Result RequestParser::parse(std::string_view input)
+    {
+        if (stage == Stage::FAILED) return Result::INVALID;
+
+        rebase(input);
+        if (stage == Stage::DONE) return Result::COMPLETE;
+
+        while (true)
+        {
+            size_t line_end = Utils::Scan::find_line_end(input, scanned);
+
+            bool line_arrived = line_end != std::string_view::npos
+                && (line_end + 1 < input.size() || input[line_end] == '\n');
+
+            if (!line_arrived)
+            {
+                // The line has not fully arrived, the next call carries on
+                // scanning from where this one stopped.
+                scanned = line_end == std::string_view::npos ? input.size() : line_end;
+                if (input.size() - line_begin > MAX_HEAD_SIZE) break;
+                return Result::INCOMPLETE;
+            }
+
+            // Lines end with CRLF, a CR or LF on its own is not accepted.
+            if (input[line_end] != '\r' || input[line_end + 1] != '\n') break;
+
+            auto line = input.substr(line_begin, line_end - line_begin);
+            line_begin = scanned = line_end + 2;
+            if (line_begin > MAX_HEAD_SIZE) break;
+
+            if (stage == Stage::REQUEST_LINE)
+            {
+                if (!parse_request_line(line)) break;
+                stage = Stage::HEADERS;
+            }
+            else if (line.empty())
+            {
+                stage = Stage::DONE;
+                return Result::COMPLETE;
+            }
+            else if (!parse_header(line))
+            {
+                break;
+            }
+        }
+
+        stage = Stage::FAILED;
+        return Result::INVALID;
+    }
+
+    void RequestParser::reset()
+    {
+        stage = Stage::REQUEST_LINE;
+        base = nullptr;
+        line_begin = 0;
+        scanned = 0;
+        request_method = {};
+        request_target = {};
+        request_version = {};
+        header_count = 0;
+        has_content_length = false;
+        has_transfer_encoding = false;
+    }
+
+    std::string_view RequestParser::method() const { return request_method; }
+
+    std::string_view RequestParser::target() const { return request_target; }
+
+    std::string_view RequestParser::version() const { return request_version; }
+
+    std::span<const HeaderView> RequestParser::headers() const { return { header_views.data(), header_count }; }
+
+    std::optional<std::string_view> RequestParser::header(std::string_view name) const
+    {
+        for (const auto& header : headers())
+        {
+            if (same_header_name(header.name, name)) return header.value;
+        }
+
+        return {};
+    }
+
+    size_t RequestParser::head_size() const { return stage == Stage::DONE ? line_begin : 0; }
+
+    Request RequestParser::request(std::string_view body, Request::allocator_type allocator) const
+    {
+        Headers request_headers{ allocator };
+        for (const auto& header : headers()) request_headers.add(header.name, header.value);
+
+        return Request(request_method, request_target, request_version, std::move(request_headers), body);
+    }
+
+    void RequestParser::rebase(std::string_view input)
+    {
+        // The buffer has moved since the last call, views into it are made
+        // again where the same bytes are now. Nothing is worked out from
+        // pointers into the old buffer, which is gone.
+        if (base && base != input.data())
+        {
+            request_method = input.substr(request_line_at[0], request_method.size());
+            request_target = input.substr(request_line_at[1], request_target.size());
+            request_version = input.substr(request_line_at[2], request_version.size());
+            for (size_t i = 0; i < header_count; i++)
+            {
+                auto& header = header_views[i];
+                header.name = input.substr(header_at[i].first, header.name.size());
+                header.value = input.substr(header_at[i].second, header.value.size());
+            }
+        }
+
+        base = input.data();
+    }
+
+    size_t RequestParser::offset_of(std::string_view view) const
+    {
+        // An empty view may not point into the buffer at all, it is made
+        // again empty wherever it is.
+        return view.empty() ? 0 : view.data() - base;
+    }
+
+    bool RequestParser::parse_request_line(std::string_view line)
+    {
+        auto method_end = line.find(' ');
+        if (method_end == std::string_view::npos) return false;
+
+        auto target_end = line.find(' ', method_end + 1);
+        if (target_end == std::string_view::npos) return false;
+
+        request_method = line.substr(0, method_end);
+        request_target = line.substr(method_end + 1, target_end - method_end - 1);
+        request_version = line.substr(target_end + 1);
+        request_line_at = { offset_of(request_method), offset_of(request_target), offset_of(request_version) };
+
+        return !request_target.empty()
+            && validate_method(request_method)
+            && validate_target(request_target)
+            && validate_version(request_version);
+    }
+
+    bool RequestParser::parse_header(std::string_view line)
+    {
+        if (header_count == MAX_HEADERS) return false;
+
+        auto colon_pos = Utils::Scan::find_char(line, ':');
+        if (colon_pos == std::string_view::npos) return false;
+
+        // Header names are tokens, there is no white space in them, which
+        // also rejects a header line starting with white space.
+        auto name = line.substr(0, colon_pos);
+        if (!Utils::Scan::is_token(name)) return false;
+
+        auto value = trim_white_space(line.substr(colon_pos + 1));
+
+        // The same framing rules the header validators apply to parsed
+        // requests, see content_length_validator.
+        if (same_header_name(name, "content-length"))
+        {
+            if (has_content_length || has_transfer_encoding || value.empty()) return false;
+            for (auto c : value)
+            {
+                if (c < '0' || c > '9') return false;
+            }
+            has_content_length = true;
+        }
+        else if (same_header_name(name, "transfer-encoding"))
+        {
+            if (has_content_length) return false;
+            has_transfer_encoding = true;
+        }
+
+        header_at[header_count] = { offset_of(name), offset_of(value) };
+        header_views[header_count++] = { name, value };
+        return true;
+    }
+
     std::optional<Request> parse_request(std::stringstream& input_stream)
     {
         std::string method;
         std::string target;
         std::string version;
-        headers_t headers;
+        Headers headers;
         std::string body;
         std::string line;
 
@@ -102,14 +319,7 @@ namespace nimlib::Server::Handlers::Http
                     if (!it->second(value, headers)) return false;
                 }
 
-                std::vector<std::string_view> values{};
-                split(value, ",", values);
-                for (auto v : values)
-                {
-                    std::string value_string{ v };
-                    headers[header].push_back(value_string);
-                }
-
+                headers.add(header, value);
                 return true;
             };
 
@@ -149,7 +359,13 @@ namespace nimlib::Server::Handlers::Http
         if (empty_line_found)
         {
             // Read message body only if headers indicate the existence of it.
-            if (body_length(headers) > 0) std::getline(input_stream, body, '\0');
+            auto length = body_length(headers);
+            if (length < 0) return {};
+            if (length > 0)
+            {
+                body.resize(length);
+                if (!input_stream.read(body.data(), length)) return {};
+            }
             return std::move(Request(std::move(method), std::move(target), std::move(version), std::move(headers), std::move(body)));
         }
         else
@@ -159,43 +375,9 @@ namespace nimlib::Server::Handlers::Http
         }
     }
 
-    std::optional<std::string> parse_response(const Response& http_response)
-    {
-        std::stringstream response{};
-
-        response << http_response.version << " " << http_response.status << " " << http_response.reason << "\r\n";
-
-        for (const auto& it : http_response.headers)
-        {
-            response << it.first << ": ";
-            for (const auto& value : it.second)
-            {
-                response << value << ", ";
-            }
-
-            // Remove the last ', ' from value
-            response << "\r\n";
-        }
-
-        // auto content_length_header = http_response.headers.find("content-length");
-        // if (content_length_header == http_response.headers.end() && !http_response.body.empty())
-        // {
-        //     response << "content-length: " << http_response.body.size() << "\r\n";
-        // }
-
-        response << "\r\n";
-
-        if (!http_response.body.empty())
-        {
-            response << http_response.body;
-        }
-
-        return response.str();
-    }
-
     bool white_space(char c) { return c == ' ' || c == '\t'; }
 
-    bool validate_method(const std::string& method)
+    bool validate_method(std::string_view method)
     {
         return method == "GET"
             || method == "POST"
@@ -208,9 +390,20 @@ namespace nimlib::Server::Handlers::Http
             || method == "CONNECT";
     }
 
-    bool validate_target(const std::string& target) { return true; /* TODO */ }
+    bool validate_target(std::string_view target) { return true; /* TODO */ }
 
-    bool validate_version(const std::string& version) { return version == "HTTP/1.1"; }
+    bool validate_version(std::string_view version) { return version == "HTTP/1.1" || version == "HTTP/1.0"; }
 
-    int body_length(const headers_t& headers) { return 1; }
+    long body_length(const Headers& headers)
+    {
+        auto values = headers.list(KnownHeader::CONTENT_LENGTH);
+        auto first = values.begin();
+        if (first == values.end()) return 0;
+        if (std::next(first) != values.end()) return -1;
+
+        auto value = *first;
+        long length{};
+        auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), length);
+        return error == std::errc{} && end == value.data() + value.size() && length >= 0 ? length : -1;
+    }
 }
@@ -1,23 +1,41 @@
 #pragma once
 
 #include "../common/types.h"
+#include "headers.h"
 
+#include <array>
+#include <cstdint>
+#include <memory_resource>
 #include <unordered_map>
 #include <vector>
 #include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
 
 namespace nimlib::Server::Handlers::Http
 {
+    class RequestBody;
+    class ConstantResponse;
+
+    // A request and everything it holds are allocated with one allocator,
+    // the connection's arena when it is being served, see HttpHandler.
+    // Handlers can take their own scratch space from it too, with
+    // get_allocator(), it is given back once the response is written.
     struct Request
     {
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        // Allocated like the headers are.
         Request(
-            const std::string method,
-            const std::string target,
-            const std::string version,
-            const headers_t headers,
-            const std::string body
+            std::string_view method,
+            std::string_view target,
+            std::string_view version,
+            Headers headers,
+            std::string_view body
         );
         Request() = default;
+        explicit Request(allocator_type allocator);
         ~Request() = default;
 
         Request(const Request&) = delete;
@@ -25,16 +43,36 @@ namespace nimlib::Server::Handlers::Http
         Request(Request&& other) noexcept = default;
         Request& operator=(Request&&) noexcept = default;
 
-        std::string method;
-        std::string target;
-        std::string version;
-        headers_t headers;
-        std::string body;
+        allocator_type get_allocator() const;
+
+        std::pmr::string method;
+        std::pmr::string target;
+        std::pmr::string version;
+        Headers headers;
+        std::pmr::string body;
+        // The body as received by the handler, valid while the request is
+        // being answered. Bodies too long to be kept in memory, which `body`
+        // is left empty for, are read from here a piece at a time.
+        const RequestBody* content{ nullptr };
+    };
+
+    // Part of the body of a response, `size` bytes of its file or shared
+    // body from `offset`, sent after `head`.
+    struct BodyRange
+    {
+        std::string head;
+        size_t offset;
+        size_t size;
     };
 
+    // Allocated like a request, except for what is handed over to the
+    // connection to be written, which outlives the arena.
     struct Response
     {
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
         Response() = default;
+        explicit Response(allocator_type allocator);
         ~Response() = default;
 
         Response(const Response&) = delete;
@@ -42,18 +80,101 @@ namespace nimlib::Server::Handlers::Http
         Response(Response&& other) noexcept = default;
         Response& operator=(Response&&) noexcept = default;
 
-        std::string version{ "HTTP/1.1" };
+        std::pmr::string version{ "HTTP/1.1" };
         short status;
-        std::string reason;
-        headers_t headers;
+        std::pmr::string reason;
+        Headers headers;
         std::string body;
+        // Sent as the body instead of `body`, straight from the file.
+        std::shared_ptr<const nimlib::Server::Utils::OpenFile> file{};
+        // Sent as the body instead of `body` without being copied, eg. a
+        // file kept in memory.
+        std::shared_ptr<const std::string> shared_body{};
+        // Header lines built ahead of time, written after `headers`. They
+        // carry the length of the body.
+        std::shared_ptr<const std::string> header_block{};
+        // When not empty, only these parts of `file` or `shared_body` are
+        // sent, followed by `body`.
+        std::pmr::vector<BodyRange> ranges{};
+        // Sent instead of everything else, status line and headers included,
+        // see ConstantResponse.
+        std::shared_ptr<const ConstantResponse> constant{};
+    };
+
+    // Parses the request line and headers of a request in place, over the
+    // bytes received so far. Nothing is copied, method, target, version and
+    // headers are views into the buffer last passed to parse(), which must
+    // outlive them.
+    //
+    // When the head of the request has not fully arrived, parse() returns
+    // INCOMPLETE and is called again once there are more bytes. Bytes already
+    // looked at are not looked at again, the buffer passed on the next call
+    // must start with the same bytes but may have been moved, eg. by growing.
+    class RequestParser
+    {
+    public:
+        enum class Result { COMPLETE, INCOMPLETE, INVALID };
+
+        static constexpr size_t MAX_HEADERS = 64;
+        static constexpr size_t MAX_HEAD_SIZE = 64 * 1024;
+
+        RequestParser() = default;
+        ~RequestParser() = default;
+
+        RequestParser(const RequestParser&) = delete;
+        RequestParser& operator=(const RequestParser&) = delete;
+        RequestParser(RequestParser&&) noexcept = delete;
+        RequestParser& operator=(RequestParser&&) noexcept = delete;
+
+        Result parse(std::string_view input);
+        void reset();
+
+        std::string_view method() const;
+        std::string_view target() const;
+        std::string_view version() const;
+        std::span<const HeaderView> headers() const;
+        // The value of the first header with the given lower case name.
+        std::optional<std::string_view> header(std::string_view name) const;
+        // Length of the request line and headers, including the empty line
+        // ending them. The body, if any, starts right after.
+        size_t head_size() const;
+
+        // Copies the parsed request out of the buffer, for handlers that
+        // need it after the buffer is gone.
+        Request request(std::string_view body, Request::allocator_type allocator = {}) const;
+
+    private:
+        enum class Stage { REQUEST_LINE, HEADERS, DONE, FAILED };
+
+        void rebase(std::string_view input);
+        size_t offset_of(std::string_view view) const;
+        bool parse_request_line(std::string_view line);
+        bool parse_header(std::string_view line);
+
+    private:
+        Stage stage{ Stage::REQUEST_LINE };
+        const char* base{ nullptr };
+        size_t line_begin{};
+        size_t scanned{};
+        std::string_view request_method;
+        std::string_view request_target;
+        std::string_view request_version;
+        std::array<HeaderView, MAX_HEADERS> header_views{};
+        size_t header_count{};
+        // Where the views above start in the buffer, they are made again
+        // from these once it has moved.
+        std::array<size_t, 3> request_line_at{};
+        std::array<std::pair<size_t, size_t>, MAX_HEADERS> header_at{};
+        bool has_content_length{ false };
+        bool has_transfer_encoding{ false };
     };
 
     std::optional<Request> parse_request(std::stringstream& input_stream);
-    std::optional<std::string> parse_response(const Response& http_response);
     bool white_space(char c);
-    bool validate_method(const std::string& method);
-    bool validate_target(const std::string& target);
-    bool validate_version(const std::string& version);
-    int body_length(const headers_t& headers);
+    bool validate_method(std::string_view method);
+    bool validate_target(std::string_view target);
+    bool validate_version(std::string_view version);
+    // The Content-Length of a request, 0 if it has none, -1 if it is not a
+    // valid length.
+    long body_length(const Headers& headers);
 };
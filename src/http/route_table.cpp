@@ -0,0 +1,101 @@
+#include "route_table.h"
+
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+namespace nimlib::Server::Handlers::Http
+{
+    static bool add_route(Router& router, const std::string& line, const named_handlers& handlers)
+    {
+        std::istringstream words{ line };
+        std::string kind, first, second, rest;
+        words >> kind >> first >> second >> rest;
+
+        if (kind.empty() || kind.starts_with('#')) return true;
+        if (!rest.empty()) return false;
+
+        if (kind == "fallback")
+        {
+            auto it = handlers.find(first);
+            if (it == handlers.end() || !second.empty()) return false;
+
+            router.fallback(it->second);
+            return true;
+        }
+
+        if (first.empty() || second.empty()) return false;
+
+        if (kind == "static") return router.serve_static(first, second);
+        if (kind == "static_big") return router.serve_static_big(first, second);
+
+        auto it = handlers.find(second);
+        if (it == handlers.end()) return false;
+
+        if (kind == "get") return router.get(first, it->second);
+        if (kind == "post") return router.post(first, it->second);
+
+        return false;
+    }
+
+    std::optional<Router> load_router(std::istream& config, const named_handlers& handlers)
+    {
+        Router router{};
+        std::string line;
+
+        while (std::getline(config, line))
+        {
+            if (!add_route(router, line, handlers)) return {};
+        }
+
+        return router;
+    }
+
+    std::optional<Router> load_router(const std::string& config_file, const named_handlers& handlers)
+    {
+        std::ifstream config{ config_file };
+        if (!config) return {};
+
+        return load_router(config, handlers);
+    }
+
+    RouteTable::RouteTable(std::shared_ptr<const Router> router) : current{ std::move(router) } {}
+
+    void RouteTable::publish(std::shared_ptr<const Router> router)
+    {
+        // The previous snapshot is released outside the lock, if this was the
+        // last reference to it, tearing it down does not hold up readers.
+        std::shared_ptr<const Router> previous;
+        {
+            std::lock_guard<std::mutex> lock{ publish_mutex };
+            previous = std::exchange(current, std::move(router));
+            current_version.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    std::shared_ptr<const Router> RouteTable::snapshot() const
+    {
+        std::lock_guard<std::mutex> lock{ publish_mutex };
+        return current;
+    }
+
+    uint64_t RouteTable::version() const
+    {
+        return current_version.load(std::memory_order_acquire);
+    }
+
+    bool RouteTable::refresh(std::shared_ptr<const Router>& router, uint64_t& router_version) const
+    {
+        if (router_version == version()) return false;
+
+        std::shared_ptr<const Router> latest;
+        {
+            std::lock_guard<std::mutex> lock{ publish_mutex };
+            latest = current;
+            router_version = current_version.load(std::memory_order_relaxed);
+        }
+        router.swap(latest);
+
+        return true;
+    }
+}
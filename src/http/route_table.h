@@ -0,0 +1,66 @@
+#pragma once
+
+#include "router.h"
+
+#include <atomic>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace nimlib::Server::Handlers::Http
+{
+    using named_handlers = std::unordered_map<std::string, route_handler>;
+
+    // Builds a router from a route configuration, one route per line:
+    //
+    //     get <target> <handler>
+    //     post <target> <handler>
+    //     static <target> <absolute path to file>
+    //     static_big <target> <absolute path to file>
+    //     fallback <handler>
+    //
+    // Handlers are looked up by name in `handlers`. Empty lines and lines
+    // starting with # are skipped. Nothing is returned if any line can not
+    // be turned into a route.
+    std::optional<Router> load_router(std::istream& config, const named_handlers& handlers);
+    std::optional<Router> load_router(const std::string& config_file, const named_handlers& handlers);
+
+    // Holds the router new requests are served with. A router is never
+    // changed once published, a new configuration is published as a whole
+    // new snapshot instead. Readers keep their own reference to the snapshot
+    // they are using, so a request being served when a new one is published
+    // finishes on the old routes, and the old routes go away with the last
+    // reader holding them.
+    //
+    // Checking for a new snapshot only reads an atomic version number, the
+    // lock is taken when publishing and by a reader picking up a snapshot
+    // it has not seen yet.
+    class RouteTable
+    {
+    public:
+        explicit RouteTable(std::shared_ptr<const Router> router);
+        ~RouteTable() = default;
+
+        RouteTable(const RouteTable&) = delete;
+        RouteTable& operator=(const RouteTable&) = delete;
+        RouteTable(RouteTable&&) noexcept = delete;
+        RouteTable& operator=(RouteTable&&) noexcept = delete;
+
+        void publish(std::shared_ptr<const Router> router);
+        std::shared_ptr<const Router> snapshot() const;
+        uint64_t version() const;
+
+        // Replaces `router` with the latest snapshot if `router_version`
+        // says it is out of date. Returns whether it was replaced.
+        bool refresh(std::shared_ptr<const Router>& router, uint64_t& router_version) const;
+
+    private:
+        mutable std::mutex publish_mutex{};
+        std::shared_ptr<const Router> current;
+        std::atomic<uint64_t> current_version{ 1 };
+    };
+};
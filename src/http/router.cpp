@@ -1,11 +1,11 @@
 #include "router.h"
 
+#include "static_file_cache.h"
+#include "static_response.h"
 #include "../utils/helpers.h"
 
 #include <filesystem>
-#include <fstream>
 #include <functional>
-#include <iomanip>
 
 namespace nimlib::Server::Handlers::Http
 {
@@ -14,64 +14,128 @@ namespace nimlib::Server::Handlers::Http
 
     bool Router::post(std::string target, route_handler handler) { return add("POST", target, handler); }
 
+    bool Router::post(std::string target, route_handler handler, body_handler on_body)
+    {
+        return on_body && add("POST", target, handler, on_body);
+    }
+
+    // Answers with the file open, the connection sends it, or the ranges
+    // of it asked for, from there.
+    static std::optional<HandlerState> send_from_disk(const std::string& file, const std::string& content_type, const Request& request, Response& response)
+    {
+        auto opened = OpenFile::open(file);
+        if (!opened)
+        {
+            response.status = 404;
+            response.reason = "Not found";
+            return HandlerState::FINISHED_WAIT;
+        }
+
+        auto etag = entity_tag(opened->size(), opened->modified());
+        auto last_modified = http_date(opened->modified().tv_sec);
+        if (answer_conditionally(request, response, { etag, last_modified, opened->modified().tv_sec }, opened->size(), content_type))
+        {
+            if (!response.ranges.empty()) response.file = std::move(opened);
+            return HandlerState::FINISHED_WAIT;
+        }
+
+        response.status = 200;
+        response.reason = "OK";
+        response.headers.add(KnownHeader::CONTENT_TYPE, content_type);
+        response.headers.add(KnownHeader::ETAG, etag);
+        response.headers.add(KnownHeader::LAST_MODIFIED, last_modified);
+        response.headers.add(KnownHeader::ACCEPT_RANGES, "bytes");
+        response.file = std::move(opened);
+
+        return HandlerState::FINISHED_WAIT;
+    }
+
+    // A file small enough is served from the cache, bytes and headers
+    // alike, the others are sent from disk.
+    static std::optional<HandlerState> send_file(const std::string& file, const std::string& content_type, const Request& request, Response& response)
+    {
+        auto cached = static_file_cache().get(file, content_type);
+        if (!cached) return send_from_disk(file, content_type, request, response);
+
+        Validators validators{ cached->etag, cached->last_modified, cached->modified };
+        if (answer_conditionally(request, response, validators, cached->bytes->size(), content_type))
+        {
+            if (!response.ranges.empty()) response.shared_body = cached->bytes;
+            return HandlerState::FINISHED_WAIT;
+        }
+
+        response.status = 200;
+        response.reason = "OK";
+        response.shared_body = cached->bytes;
+        response.header_block = cached->headers;
+
+        return HandlerState::FINISHED_WAIT;
+    }
+
     bool Router::serve_static(std::string target, std::string file)
     {
-        auto static_handler = [this](const Request& request, Response& response, params_t&) -> std::optional<HandlerState>
+        if (!valid_static_file(file)) return false;
+
+        // Everything known about the file is captured when the route is
+        // added, serving it does not look anything up in the router. That
+        // includes its precompressed copies, a client accepting one of them
+        // is sent that instead, no compression happens while serving.
+        auto content_type = get_content_type(file);
+        auto variants = encoded_variants(file, content_type);
+        auto static_handler = [file, content_type, variants](const Request& request, Response& response, params_t&) -> std::optional<HandlerState>
             {
-                auto file = this->target_to_file[request.target];
-                auto content_type = this->target_to_mime_type[request.target];
-
-                std::string contents;
-                std::ifstream in(file, std::ios::in | std::ios::binary);
-                if (in)
+                auto variant = choose_variant(request, variants);
+                auto state = send_file(variant ? variant->path : file, content_type, request, response);
+                if (variant && response.status == 404)
                 {
-                    in.seekg(0, std::ios::end);
-                    contents.resize(in.tellg());
-                    in.seekg(0, std::ios::beg);
-                    in.read(&contents[0], contents.size());
-                    in.close();
+                    // The copy is gone, the file itself may still be there.
+                    variant = nullptr;
+                    response.status = 0;
+                    response.reason.clear();
+                    state = send_file(file, content_type, request, response);
                 }
 
-                response.status = 200;
-                response.reason = "OK";
-                response.headers["content-type"].push_back(content_type);
-                response.body = contents;
+                if (variants.empty()) return state;
 
-                return HandlerState::FINISHED_NO_WAIT;
-            };
+                // Caches keep a response per coding the client accepts.
+                response.headers.set(KnownHeader::VARY, "accept-encoding");
+                if (variant && (response.status == 200 || response.status == 206))
+                {
+                    response.headers.set(KnownHeader::CONTENT_ENCODING, variant->encoding);
+                }
 
-        if (valid_static_file(file) && add("GET", target, static_handler))
-        {
-            target_to_file[target] = file;
-            target_to_mime_type[target] = get_content_type(file);
+                return state;
+            };
 
-            return true;
-        }
-        else
-        {
-            return false;
-        }
+        return add("GET", target, static_handler);
     }
 
     bool Router::serve_static_big(std::string target, std::string file)
     {
-        auto a = [this](const Request& request, Response& response, params_t& params)-> std::optional<HandlerState>
+        // A big file is not worth the memory, it is written to the socket
+        // from disk as the socket takes it.
+        auto static_handler = [file, content_type = get_content_type(file)](const Request& request, Response& response, params_t&) -> std::optional<HandlerState>
             {
-                return this->static_file_handler_big(request, response, params);
+                return send_from_disk(file, content_type, request, response);
             };
 
+        return valid_static_file(file) && add("GET", target, static_handler);
+    }
 
-        if (valid_static_file(file) && add("GET", target, a))
-        {
-            target_to_file[target] = file;
-            target_to_mime_type[target] = get_content_type(file);
+    route_handler constant_handler(ConstantResponse response)
+    {
+        auto shared = std::make_shared<const ConstantResponse>(std::move(response));
+        return [shared](const Request&, Response& response, params_t&) -> std::optional<HandlerState>
+            {
+                response.status = shared->status();
+                response.constant = shared;
+                return HandlerState::FINISHED_WAIT;
+            };
+    }
 
-            return true;
-        }
-        else
-        {
-            return false;
-        }
+    bool Router::constant(std::string target, ConstantResponse response)
+    {
+        return add("GET", target, constant_handler(std::move(response)));
     }
 
     void Router::sub_route(std::string target_prefix, Router sub_router)
@@ -98,15 +162,20 @@ namespace nimlib::Server::Handlers::Http
 
     void Router::fallback(route_handler handler) { fallback_handler = handler; }
 
-    std::optional<HandlerState> Router::route(const Request& request, Response& response)
+    std::optional<HandlerState> Router::route(const Request& request, Response& response) const
     {
-        if (auto it = handlers.find(request.method); it != handlers.end())
+        return route(request, response, request.get_allocator().resource());
+    }
+
+    std::optional<HandlerState> Router::route(const Request& request, Response& response, std::pmr::memory_resource* params_memory) const
+    {
+        if (auto it = handlers.find(std::string_view{ request.method }); it != handlers.end())
         {
-            params_t params;
-            auto handler = it->second.find(request.target, params);
-            if (handler && handler.value())
+            params_t params{ params_memory };
+            auto node = it->second.find(request.target, params);
+            if (node && *node->handler)
             {
-                return handler.value()(request, response, params);
+                return (*node->handler)(request, response, params);
             }
             else if (fallback_handler)
             {
@@ -123,19 +192,36 @@ namespace nimlib::Server::Handlers::Http
         }
     }
 
-    bool Router::add(std::string method, std::string target, route_handler handler)
+    RequestBody::Sink Router::body_sink(const Request& head) const
+    {
+        auto it = handlers.find(std::string_view{ head.method });
+        if (it == handlers.end()) return {};
+
+        // The parameters are found once, with the head, and handed to every
+        // piece of the body.
+        params_t params{ head.get_allocator().resource() };
+        auto node = it->second.find(head.target, params);
+        if (!node || !node->on_body) return {};
+
+        return [&head, &on_body = node->on_body, params = std::move(params)](std::string_view bytes) mutable
+            {
+                return on_body(head, params, bytes);
+            };
+    }
+
+    bool Router::add(std::string method, std::string target, route_handler handler, body_handler on_body)
     {
         // TODO: also check if method is valid?
         if (target.empty()) return false;
 
         if (auto it = handlers.find(method); it != handlers.end())
         {
-            it->second.add(target, handler);
+            it->second.add(target, handler, on_body);
         }
         else
         {
             Node node;
-            node.add(target, handler);
+            node.add(target, handler, on_body);
             handlers[method] = std::move(node);
         }
 
@@ -156,59 +242,6 @@ namespace nimlib::Server::Handlers::Http
         }
     }
 
-    std::optional<HandlerState> Router::static_file_handler_big(const Request& request, Response& response, params_t& params)
-    {
-        auto file = target_to_file[request.target];
-        std::ifstream file_stream{ file, std::ios::in | std::ios::binary };
-
-        std::stringstream body;
-        std::string buffer;
-        long chunk_size = 1024 * 300;
-        long file_size = std::filesystem::file_size(std::filesystem::path(file));
-        long expected_chunk_count = file_size / chunk_size + (file_size % chunk_size == 0 ? 0 : 1);
-        int chunk_number = 0;
-        bool has_chunk;
-
-        if (auto it = last_served_chunk.find(file); it != last_served_chunk.end())
-        {
-            chunk_number = it->second;
-        }
-
-        while (true)
-        {
-            has_chunk = read_chunk(file_stream, buffer, file_size, chunk_size, chunk_number);
-            if (has_chunk)
-            {
-                body << std::hex << buffer.size() << "\r\n" << buffer << "\r\n";
-                chunk_number++;
-            }
-
-            if (!has_chunk || (chunk_number % 2 == 0))
-            {
-                break;
-            }
-        }
-
-        response.status = 200;
-        response.reason = "OK";
-        response.headers["content-type"].push_back(target_to_mime_type[request.target]);
-        response.headers["transfer-encoding"].push_back("chunked");
-
-        if (chunk_number == expected_chunk_count)
-        {
-            body << "0\r\n\r\n";
-            response.body = body.str();
-            last_served_chunk.erase(file);
-            return HandlerState::FINISHED_NO_WAIT;
-        }
-        else
-        {
-            response.body = body.str();
-            last_served_chunk[file] = chunk_number;
-            return HandlerState::RECALL;
-        }
-    }
-
     bool Router::valid_static_file(std::string file)
     {
         auto path = std::filesystem::path(file);
@@ -218,13 +251,14 @@ namespace nimlib::Server::Handlers::Http
             && !get_content_type(file).empty();
     }
 
-    Router::Node::Node(std::string target, route_handler h) { add(target, h); }
+    Router::Node::Node(std::string target, route_handler h, body_handler b) { add(target, h, b); }
 
-    void Router::Node::add(std::string target, route_handler h)
+    void Router::Node::add(std::string target, route_handler h, body_handler b)
     {
         if (target.empty())
         {
             handler = h;
+            on_body = b;
         }
         else
         {
@@ -240,11 +274,11 @@ namespace nimlib::Server::Handlers::Http
 
             if (auto it = next.find(target_segment); it != next.end())
             {
-                it->second.add(target_rest, h);
+                it->second.add(target_rest, h, b);
             }
             else
             {
-                next[target_segment] = std::move(Node(target_rest, h));
+                next[target_segment] = std::move(Node(target_rest, h, b));
             }
         }
     }
@@ -280,27 +314,27 @@ namespace nimlib::Server::Handlers::Http
         }
     }
 
-    std::optional<route_handler> Router::Node::find(std::string_view target, params_t& params)
+    const Router::Node* Router::Node::find(std::string_view target, params_t& params) const
     {
-        if (target.empty()) return handler;
+        if (target.empty()) return handler ? this : nullptr;
 
         size_t pos = target.find('/');
         std::string_view target_segment = target.substr(0, pos);
 
         if (!parameter.empty())
         {
-            params[parameter] = target_segment;
+            params.insert_or_assign(std::pmr::string{ parameter, params.get_allocator() }, target_segment);
             target_segment = parameter;
         }
 
-        if (auto it = next.find(std::string(target_segment)); it != next.end())
+        if (auto it = next.find(target_segment); it != next.end())
         {
             std::string_view rest_segment = (pos == std::string::npos) ? "" : target.substr(pos + 1);
             return it->second.find(rest_segment, params);
         }
         else
         {
-            return {};
+            return nullptr;
         }
     }
 }
@@ -1,19 +1,40 @@
 #pragma once
 
 #include "parser.h"
+#include "body_reader.h"
+#include "constant_response.h"
 #include "../utils/state_manager.h"
 
+#include <memory_resource>
 #include <unordered_map>
 
 namespace nimlib::Server::Handlers::Http
 {
     using nimlib::Server::Constants::HandlerState;
-    using params_t = std::unordered_map<std::string, std::string>;
+    using nimlib::Server::Utils::OpenFile;
+    // Allocated like the request they were found in, see Request.
+    using params_t = std::pmr::unordered_map<std::pmr::string, std::pmr::string>;
     using route_handler = std::function<std::optional<HandlerState>(const Request&, Response&, params_t&)>;
+    // Takes the body of a request a piece at a time, as it is decoded, given
+    // the request's head. Returning false refuses the request.
+    using body_handler = std::function<bool(const Request&, params_t&, std::string_view)>;
+
+    // A route handler answering every request with the same response, which
+    // is serialized once here rather than on every request.
+    route_handler constant_handler(ConstantResponse response);
+
+    // Lets the route maps be searched with a string_view, without building
+    // a string to look for.
+    struct TargetHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+    };
 
     class Router
     {
         class Node;
+        using node_map = std::unordered_map<std::string, Node, TargetHash, std::equal_to<>>;
 
     public:
         Router() = default;
@@ -26,35 +47,48 @@ namespace nimlib::Server::Handlers::Http
 
         bool get(std::string target, route_handler handler);
         bool post(std::string target, route_handler handler);
+        // The body is passed to `on_body` as it arrives instead of being
+        // kept, `handler` is called once all of it has been.
+        bool post(std::string target, route_handler handler, body_handler on_body);
         bool serve_static(std::string target, std::string file);
         bool serve_static_big(std::string target, std::string file);
+        bool constant(std::string target, ConstantResponse response);
         void sub_route(std::string target_prefix, Router sub_router);
         void fallback(route_handler fallback_handler);
-        std::optional<HandlerState> route(const Request&, Response&);
+        std::optional<HandlerState> route(const Request&, Response&) const;
+        // Takes the parameters found in the target from `params_memory`
+        // rather than from the request's allocator.
+        std::optional<HandlerState> route(const Request&, Response&, std::pmr::memory_resource* params_memory) const;
+        // Where the body of the request with head `head` goes as it arrives,
+        // nowhere unless its route has a body handler. The sink refers to
+        // the head and to this router, both have to outlive it.
+        RequestBody::Sink body_sink(const Request& head) const;
 
     private:
-        bool add(std::string method, std::string target, route_handler handler);
-        std::string get_content_type(std::string file);
-        std::optional<HandlerState> static_file_handler_big(const Request&, Response&, params_t&);
-        bool valid_static_file(std::string file);
+        bool add(std::string method, std::string target, route_handler handler, body_handler on_body = {});
+        static std::string get_content_type(std::string file);
+        static bool valid_static_file(std::string file);
 
     private:
         route_handler fallback_handler{};
-        std::unordered_map<std::string, Node> handlers{};
-        std::unordered_map<std::string, std::string> target_to_file{};
-        std::unordered_map<std::string, std::string> target_to_mime_type{};
-        std::unordered_map<std::string, int> last_served_chunk{};
+        node_map handlers{};
         inline static const std::unordered_map<std::string, std::string> ext_to_mime_type
         {
             {".jpg", "image/jpeg"},
             {".jpeg", "image/jpeg"},
-            {".mp4", "video/mp4"}
+            {".mp4", "video/mp4"},
+            {".html", "text/html"},
+            {".css", "text/css"},
+            {".js", "application/javascript"},
+            {".json", "application/json"},
+            {".svg", "image/svg+xml"},
+            {".txt", "text/plain"}
         };
 
     private:
         struct Node
         {
-            Node(std::string target, route_handler h);
+            Node(std::string target, route_handler h, body_handler b = {});
             Node() = default;
             ~Node() = default;
 
@@ -63,12 +97,14 @@ namespace nimlib::Server::Handlers::Http
             Node(Node&&) noexcept = default;
             Node& operator=(Node&&) noexcept = default;
 
-            void add(std::string target, route_handler h);
+            void add(std::string target, route_handler h, body_handler b = {});
             void add(std::string target, Node node);
-            std::optional<route_handler> find(std::string_view target, params_t& params);
+            // The node with a handler for `target`, if any.
+            const Node* find(std::string_view target, params_t& params) const;
 
-            std::unordered_map<std::string, Node> next{};
+            node_map next{};
             std::optional<route_handler> handler{};
+            body_handler on_body{};
             std::string parameter{};
         };
     };
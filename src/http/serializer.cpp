@@ -0,0 +1,152 @@
+#include "serializer.h"
+
+#include "constant_response.h"
+#include "headers.h"
+
+#include <array>
+#include <charconv>
+
+namespace nimlib::Server::Handlers::Http
+{
+    struct StatusLine
+    {
+        short status;
+        std::string_view line;
+    };
+
+    static constexpr std::array<StatusLine, 30> status_lines
+    {{
+        { 100, "HTTP/1.1 100 Continue\r\n" },
+        { 101, "HTTP/1.1 101 Switching Protocols\r\n" },
+        { 200, "HTTP/1.1 200 OK\r\n" },
+        { 201, "HTTP/1.1 201 Created\r\n" },
+        { 202, "HTTP/1.1 202 Accepted\r\n" },
+        { 204, "HTTP/1.1 204 No Content\r\n" },
+        { 206, "HTTP/1.1 206 Partial Content\r\n" },
+        { 301, "HTTP/1.1 301 Moved Permanently\r\n" },
+        { 302, "HTTP/1.1 302 Found\r\n" },
+        { 303, "HTTP/1.1 303 See Other\r\n" },
+        { 304, "HTTP/1.1 304 Not Modified\r\n" },
+        { 307, "HTTP/1.1 307 Temporary Redirect\r\n" },
+        { 308, "HTTP/1.1 308 Permanent Redirect\r\n" },
+        { 400, "HTTP/1.1 400 Bad Request\r\n" },
+        { 401, "HTTP/1.1 401 Unauthorized\r\n" },
+        { 403, "HTTP/1.1 403 Forbidden\r\n" },
+        { 404, "HTTP/1.1 404 Not Found\r\n" },
+        { 405, "HTTP/1.1 405 Method Not Allowed\r\n" },
+        { 408, "HTTP/1.1 408 Request Timeout\r\n" },
+        { 409, "HTTP/1.1 409 Conflict\r\n" },
+        { 411, "HTTP/1.1 411 Length Required\r\n" },
+        { 413, "HTTP/1.1 413 Content Too Large\r\n" },
+        { 414, "HTTP/1.1 414 URI Too Long\r\n" },
+        { 416, "HTTP/1.1 416 Range Not Satisfiable\r\n" },
+        { 429, "HTTP/1.1 429 Too Many Requests\r\n" },
+        { 500, "HTTP/1.1 500 Internal Server Error\r\n" },
+        { 501, "HTTP/1.1 501 Not Implemented\r\n" },
+        { 502, "HTTP/1.1 502 Bad Gateway\r\n" },
+        { 503, "HTTP/1.1 503 Service Unavailable\r\n" },
+        { 504, "HTTP/1.1 504 Gateway Timeout\r\n" },
+    }};
+
+    std::string_view status_line(short status)
+    {
+        for (const auto& known : status_lines)
+        {
+            if (known.status == status) return known.line;
+        }
+
+        return {};
+    }
+
+    std::string_view reason_phrase(short status)
+    {
+        // Between "HTTP/1.1 200 " and the line end.
+        auto line = status_line(status);
+        return line.empty() ? line : line.substr(13, line.size() - 15);
+    }
+
+    size_t body_size(const Response& response)
+    {
+        if (!response.ranges.empty())
+        {
+            size_t size = response.body.size();
+            for (const auto& range : response.ranges) size += range.head.size() + range.size;
+            return size;
+        }
+
+        if (response.file) return response.file->size();
+        if (response.shared_body) return response.shared_body->size();
+        return response.body.size();
+    }
+
+    // Responses to be written to a string or straight to an output queue,
+    // both take string views.
+    template <typename Out>
+    static void write_head(const Response& response, Out& out)
+    {
+        auto known_line = response.version == "HTTP/1.1" ? status_line(response.status) : std::string_view{};
+        if (!known_line.empty() && (response.reason.empty() || response.reason == reason_phrase(response.status)))
+        {
+            out.append(known_line);
+        }
+        else
+        {
+            char status[8];
+            auto [status_end, _] = std::to_chars(status, status + sizeof(status), response.status);
+            out.append(std::string_view{ response.version });
+            out.append(std::string_view{ " " });
+            out.append(std::string_view{ status, static_cast<size_t>(status_end - status) });
+            out.append(std::string_view{ " " });
+            out.append(response.reason.empty() ? reason_phrase(response.status) : std::string_view{ response.reason });
+            out.append(std::string_view{ "\r\n" });
+        }
+
+        for (const auto& [name, value] : response.headers)
+        {
+            out.append(name);
+            out.append(std::string_view{ ": " });
+            out.append(value);
+            out.append(std::string_view{ "\r\n" });
+        }
+
+        if (response.header_block) out.append(std::string_view{ *response.header_block });
+
+        // Without a length the client could only find where the body ends by
+        // the connection closing. A 304 has no body, and the length it could
+        // give would be that of the file the client already has.
+        bool bodiless = (response.status >= 100 && response.status < 200) || response.status == 204 || response.status == 304;
+        if (!response.headers.contains(KnownHeader::CONTENT_LENGTH)
+            && !response.headers.contains(KnownHeader::TRANSFER_ENCODING)
+            && !bodiless && !response.header_block)
+        {
+            char length[24];
+            auto [length_end, _] = std::to_chars(length, length + sizeof(length), body_size(response));
+            out.append(header_name(KnownHeader::CONTENT_LENGTH));
+            out.append(std::string_view{ ": " });
+            out.append(std::string_view{ length, static_cast<size_t>(length_end - length) });
+            out.append(std::string_view{ "\r\n" });
+        }
+
+        if (!response.headers.contains(KnownHeader::DATE)) out.append(date_header());
+
+        out.append(std::string_view{ "\r\n" });
+    }
+
+    void write_response_head(const Response& response, nimlib::Server::Utils::OutputQueue& out) { write_head(response, out); }
+
+    void write_response_head(const Response& response, std::string& out) { write_head(response, out); }
+
+    std::string response_head(const Response& http_response)
+    {
+        std::string head{};
+        write_head(http_response, head);
+        return head;
+    }
+
+    std::optional<std::string> parse_response(const Response& http_response)
+    {
+        std::string response{ response_head(http_response) };
+        response += http_response.shared_body ? *http_response.shared_body : http_response.body;
+        return response;
+    }
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "parser.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace nimlib::Server::Handlers::Http
+{
+    // "HTTP/1.1 200 OK\r\n" and the like, for the common status codes, with
+    // their standard reason. Empty for the others.
+    std::string_view status_line(short status);
+
+    // The standard reason for a common status code, empty for the others.
+    std::string_view reason_phrase(short status);
+
+    // How many bytes the body of a response takes, whatever it is sent from.
+    size_t body_size(const Response& response);
+
+    // Writes the status line and headers of a response, up to and including
+    // the empty line before its body, straight to `out`. Nothing is built
+    // on the way, the queue's storage is written to as it is.
+    //
+    // A response without a reason is given the standard one. Content-Length
+    // is added when the response does not give it, nor a transfer coding or
+    // a header block, unless it is one that can not have a body, and Date
+    // when it does not give one.
+    void write_response_head(const Response& response, nimlib::Server::Utils::OutputQueue& out);
+    void write_response_head(const Response& response, std::string& out);
+
+    // The status line and headers of a response, see write_response_head().
+    std::string response_head(const Response& http_response);
+    // The whole of a response whose body is in memory.
+    std::optional<std::string> parse_response(const Response& http_response);
+};
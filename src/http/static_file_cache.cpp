@@ -0,0 +1,263 @@
+#include "static_file_cache.h"
+#include "static_response.h"
+
+#include <sys/stat.h>
+
+namespace nimlib::Server::Handlers::Http
+{
+    using nimlib::Server::Utils::OpenFile;
+
+    namespace
+    {
+        // Reads the cache's counters when a report is generated, nothing is
+        // received into it.
+        class CacheMetric : public nimlib::Server::Metrics::Metric<long>
+        {
+        public:
+            explicit CacheMetric(const StaticFileCache& cache) : cache{ cache } {}
+
+            CacheMetric& register_aggregator(aggregator_ptr) override { return *this; }
+            bool receive(long) override { return false; }
+            const std::string& get_name() const override { return name; }
+
+            void get_report(report_data_t& aggregations) const override
+            {
+                long hits = cache.hits();
+                long misses = cache.misses();
+                long lookups = hits + misses;
+
+                aggregations.emplace_back("hits", std::vector<long>{ hits });
+                aggregations.emplace_back("misses", std::vector<long>{ misses });
+                aggregations.emplace_back("hit_ratio_percent", std::vector<long>{ lookups > 0 ? hits * 100 / lookups : 0 });
+                aggregations.emplace_back("bytes", std::vector<long>{ static_cast<long>(cache.size()) });
+                aggregations.emplace_back("files", std::vector<long>{ static_cast<long>(cache.file_count()) });
+            }
+
+        private:
+            const StaticFileCache& cache;
+            const std::string name{ "static_file_cache" };
+        };
+
+        const timespec& modification_time(const struct stat& status)
+        {
+#ifdef __APPLE__
+            return status.st_mtimespec;
+#else
+            return status.st_mtim;
+#endif
+        }
+
+        bool same_time(const timespec& a, const timespec& b)
+        {
+            return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+        }
+
+        // The files a thread was served from a cache lately, looked at
+        // before the cache is locked.
+        struct Front
+        {
+            struct Shortcut
+            {
+                std::shared_ptr<const CachedFile> file;
+                std::shared_ptr<std::atomic<bool>> used;
+                std::chrono::steady_clock::time_point checked;
+            };
+
+            size_t cache{ 0 };
+            size_t generation{ 0 };
+            std::unordered_map<std::string, Shortcut> files{};
+        };
+
+        // Servers look in a single cache, a thread only keeps the front of
+        // the one it looked in last.
+        thread_local Front front{};
+
+        std::atomic<size_t> next_cache_id{ 1 };
+        std::atomic<size_t> next_hit_counter{ 0 };
+        thread_local const size_t hit_counter{ next_hit_counter++ };
+
+        // The calling thread's front of `cache`, emptied if it was made for
+        // another cache or before the last eviction.
+        Front& front_of(size_t cache, size_t generation)
+        {
+            if (front.cache != cache || front.generation != generation)
+            {
+                front.files.clear();
+                front.cache = cache;
+                front.generation = generation;
+            }
+
+            return front;
+        }
+    };
+
+    StaticFileCache::StaticFileCache(size_t byte_budget, size_t max_file_size, std::chrono::milliseconds revalidate_after)
+        : byte_budget{ byte_budget },
+          max_file_size{ max_file_size },
+          revalidate_after{ revalidate_after },
+          id{ next_cache_id++ },
+          report{ std::make_shared<CacheMetric>(*this) }
+    {}
+
+    std::shared_ptr<const CachedFile> StaticFileCache::get(const std::string& path, std::string_view content_type)
+    {
+        auto now = std::chrono::steady_clock::now();
+
+        auto& mine = front_of(id, generation.load(std::memory_order_acquire));
+        if (auto it = mine.files.find(path); it != mine.files.end() && now - it->second.checked < revalidate_after)
+        {
+            // Only written once, later hits leave the flag's line shared.
+            if (!it->second.used->load(std::memory_order_relaxed)) it->second.used->store(true, std::memory_order_relaxed);
+            count_hit();
+            return it->second.file;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard{ lock };
+            if (auto it = index.find(path); it != index.end() && now - it->second->checked < revalidate_after)
+            {
+                entries.splice(entries.begin(), entries, it->second);
+                count_hit();
+                remember(*it->second);
+                return it->second->file;
+            }
+        }
+
+        // The file is looked at again, once in a while for a cached one.
+        struct stat status;
+        bool exists = ::stat(path.c_str(), &status) == 0 && S_ISREG(status.st_mode);
+
+        {
+            std::lock_guard<std::mutex> guard{ lock };
+            if (auto it = index.find(path); it != index.end())
+            {
+                auto entry = it->second;
+                if (exists && entry->file_size == static_cast<size_t>(status.st_size) && same_time(entry->modified, modification_time(status)))
+                {
+                    entry->checked = now;
+                    entries.splice(entries.begin(), entries, entry);
+                    count_hit();
+                    remember(*entry);
+                    return entry->file;
+                }
+
+                evict(entry);
+            }
+        }
+
+        if (!exists) return nullptr;
+
+        size_t file_size = status.st_size;
+        if (file_size > max_file_size || file_size > byte_budget) return nullptr;
+
+        // Read without the lock, hits on other files do not wait for it.
+        auto file = OpenFile::open(path);
+        auto cached = file ? load(*file, content_type) : nullptr;
+        if (!cached) return nullptr;
+
+        std::lock_guard<std::mutex> guard{ lock };
+        miss_count++;
+
+        // Another thread may have read it meanwhile.
+        if (auto it = index.find(path); it != index.end()) evict(it->second);
+
+        entries.push_front(Entry{ path, cached, file->modified(), file->size(), now, std::make_shared<std::atomic<bool>>(false) });
+        index.emplace(entries.front().path, entries.begin());
+        bytes += entry_size(entries.front());
+
+        // Entries hit from a front since they were last passed over are put
+        // back at the front of the list instead, once.
+        while (bytes > byte_budget && !entries.empty())
+        {
+            auto last = std::prev(entries.end());
+            if (last->used->exchange(false, std::memory_order_relaxed)) entries.splice(entries.begin(), entries, last);
+            else evict(last);
+        }
+
+        if (auto it = index.find(path); it != index.end()) remember(*it->second);
+
+        return cached;
+    }
+
+    std::shared_ptr<const CachedFile> StaticFileCache::load(const OpenFile& file, std::string_view content_type)
+    {
+        auto contents = std::make_shared<std::string>(file.size(), '\0');
+        for (size_t at = 0; at < contents->size();)
+        {
+            auto copied = file.read(at, contents->data() + at, contents->size() - at);
+            if (copied == 0) return nullptr;
+            at += copied;
+        }
+
+        auto cached = std::make_shared<CachedFile>();
+        cached->etag = entity_tag(file.size(), file.modified());
+        cached->last_modified = http_date(file.modified().tv_sec);
+        cached->modified = file.modified().tv_sec;
+
+        auto headers = std::make_shared<std::string>();
+        *headers += "content-type: ";
+        *headers += content_type;
+        *headers += "\r\ncontent-length: " + std::to_string(file.size());
+        *headers += "\r\netag: " + cached->etag;
+        *headers += "\r\nlast-modified: " + cached->last_modified;
+        *headers += "\r\naccept-ranges: bytes\r\n";
+
+        cached->bytes = std::move(contents);
+        cached->headers = std::move(headers);
+        return cached;
+    }
+
+    size_t StaticFileCache::entry_size(const Entry& entry)
+    {
+        return entry.path.size() + entry.file->bytes->size() + entry.file->headers->size();
+    }
+
+    void StaticFileCache::evict(std::list<Entry>::iterator entry)
+    {
+        // Responses still holding the file keep it until they are written.
+        bytes -= entry_size(*entry);
+        index.erase(entry->path);
+        entries.erase(entry);
+        generation.fetch_add(1, std::memory_order_release);
+    }
+
+    void StaticFileCache::remember(const Entry& entry)
+    {
+        auto& mine = front_of(id, generation.load(std::memory_order_relaxed));
+        mine.files.insert_or_assign(entry.path, Front::Shortcut{ entry.file, entry.used, entry.checked });
+    }
+
+    void StaticFileCache::count_hit()
+    {
+        hit_counts[hit_counter % HIT_COUNTERS].count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t StaticFileCache::hits() const
+    {
+        size_t count = 0;
+        for (const auto& counter : hit_counts) count += counter.count.load(std::memory_order_relaxed);
+        return count;
+    }
+
+    size_t StaticFileCache::misses() const { return miss_count; }
+
+    size_t StaticFileCache::size() const
+    {
+        std::lock_guard<std::mutex> guard{ lock };
+        return bytes;
+    }
+
+    size_t StaticFileCache::file_count() const
+    {
+        std::lock_guard<std::mutex> guard{ lock };
+        return entries.size();
+    }
+
+    std::shared_ptr<nimlib::Server::Metrics::Metric<long>> StaticFileCache::metric() { return report; }
+
+    StaticFileCache& static_file_cache()
+    {
+        static StaticFileCache cache{};
+        return cache;
+    }
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "../metrics/metric.h"
+#include "../utils/open_file.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace nimlib::Server::Handlers::Http
+{
+    // A static file as it is sent, kept in memory by the cache.
+    struct CachedFile
+    {
+        std::shared_ptr<const std::string> bytes;
+        // The header lines sent with the whole file, content type, length,
+        // ETag, Last-Modified and Accept-Ranges, each ending with CRLF.
+        std::shared_ptr<const std::string> headers;
+        std::string etag;
+        std::string last_modified;
+        time_t modified;
+    };
+
+    // Keeps small static files in memory, keyed by path, so that serving one
+    // neither reads it nor builds its headers again.
+    //
+    // An entry is checked against the file's modification time and size at
+    // most once every `revalidate_after`, a changed file is read again and a
+    // removed one dropped. Files are evicted least recently used first once
+    // the cache holds more than its byte budget, and files too big for it
+    // are left to be sent from disk.
+    //
+    // Each thread keeps a front of the files it was served, a hit found
+    // there takes no lock and does not allocate. The front is dropped as a
+    // whole once any file is evicted, and its entries expire with the
+    // revalidation, so it never serves a file the cache no longer would.
+    // Front hits do not reorder the list, they mark the entry as used and
+    // eviction gives marked entries a second chance, which keeps the least
+    // recently used order close enough.
+    class StaticFileCache
+    {
+    public:
+        static constexpr size_t DEFAULT_BYTE_BUDGET = 64 * 1024 * 1024;
+        static constexpr size_t DEFAULT_MAX_FILE_SIZE = 1024 * 1024;
+        static constexpr std::chrono::milliseconds DEFAULT_REVALIDATE_AFTER{ 1'000 };
+
+        explicit StaticFileCache(
+            size_t byte_budget = DEFAULT_BYTE_BUDGET,
+            size_t max_file_size = DEFAULT_MAX_FILE_SIZE,
+            std::chrono::milliseconds revalidate_after = DEFAULT_REVALIDATE_AFTER
+        );
+        ~StaticFileCache() = default;
+
+        StaticFileCache(const StaticFileCache&) = delete;
+        StaticFileCache& operator=(const StaticFileCache&) = delete;
+        StaticFileCache(StaticFileCache&&) noexcept = delete;
+        StaticFileCache& operator=(StaticFileCache&&) noexcept = delete;
+
+        // The file at `path`, read if it is not cached yet. Null when it can
+        // not be read or is too big to be cached.
+        std::shared_ptr<const CachedFile> get(const std::string& path, std::string_view content_type);
+
+        size_t hits() const;
+        size_t misses() const;
+        // Bytes held for the cached files and their headers.
+        size_t size() const;
+        size_t file_count() const;
+
+        // Reports hits, misses, hit ratio and memory use. Metrics stores are
+        // kept per thread, the same metric can be registered with each.
+        std::shared_ptr<nimlib::Server::Metrics::Metric<long>> metric();
+
+    private:
+        struct Entry
+        {
+            std::string path;
+            std::shared_ptr<const CachedFile> file;
+            timespec modified;
+            size_t file_size;
+            std::chrono::steady_clock::time_point checked;
+            // Set by hits from a thread's front, shared with it.
+            std::shared_ptr<std::atomic<bool>> used;
+        };
+
+        // Hits are counted apart per thread, counting one does not touch
+        // what other threads count on.
+        struct alignas(64) HitCounter
+        {
+            std::atomic<size_t> count{ 0 };
+        };
+        static constexpr size_t HIT_COUNTERS = 16;
+
+        static std::shared_ptr<const CachedFile> load(const nimlib::Server::Utils::OpenFile& file, std::string_view content_type);
+        static size_t entry_size(const Entry& entry);
+        void evict(std::list<Entry>::iterator entry);
+        // Adds the entry to the calling thread's front, with the lock held.
+        void remember(const Entry& entry);
+        void count_hit();
+
+    private:
+        const size_t byte_budget;
+        const size_t max_file_size;
+        const std::chrono::milliseconds revalidate_after;
+
+        // Tells the threads' fronts apart, an address may be reused.
+        const size_t id;
+
+        mutable std::mutex lock{};
+        // Most recently used first.
+        std::list<Entry> entries{};
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index{};
+        size_t bytes{ 0 };
+        // Moves on with every eviction, fronts made before are dropped.
+        std::atomic<size_t> generation{ 0 };
+        std::array<HitCounter, HIT_COUNTERS> hit_counts{};
+        std::atomic<size_t> miss_count{ 0 };
+        std::shared_ptr<nimlib::Server::Metrics::Metric<long>> report{};
+    };
+
+    // The cache static routes are served from.
+    StaticFileCache& static_file_cache();
+};
@@ -0,0 +1,351 @@
+#include "static_response.h"
+
+#include "../utils/compression.h"
+#include "../utils/helpers.h"
+#include "../utils/open_file.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <unistd.h>
+
+namespace nimlib::Server::Handlers::Http
+{
+    using nimlib::Server::Utils::compressible_type;
+    using nimlib::Server::Utils::gzip_available;
+    using nimlib::Server::Utils::gzip_file;
+    using nimlib::Server::Utils::OpenFile;
+
+    static std::string_view trim(std::string_view s)
+    {
+        auto begin = s.find_first_not_of(" \t");
+        if (begin == std::string_view::npos) return {};
+        return s.substr(begin, s.find_last_not_of(" \t") + 1 - begin);
+    }
+
+    static std::string_view without_weak_prefix(std::string_view etag)
+    {
+        return etag.starts_with("W/") ? etag.substr(2) : etag;
+    }
+
+    // Whether an If-None-Match list names `etag`, weak tags matching too.
+    static bool etag_listed(const Headers::ValueList& tags, std::string_view etag)
+    {
+        for (auto tag : tags)
+        {
+            if (tag == "*" || without_weak_prefix(tag) == without_weak_prefix(etag)) return true;
+        }
+
+        return false;
+    }
+
+    // Whether the file the client has part of is still the same, so the
+    // rest of it can be sent as a range. Only a strong match will do.
+    static bool if_range_matches(std::string_view value, const Validators& validators)
+    {
+        value = trim(value);
+        if (value.starts_with("W/")) return false;
+        if (value.starts_with("\"")) return value == validators.etag;
+
+        auto date = parse_http_date(value);
+        return date && *date == validators.modified;
+    }
+
+    static bool parse_number(std::string_view digits, size_t& number)
+    {
+        if (digits.empty()) return false;
+        auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), number);
+        return error == std::errc{} && end == digits.data() + digits.size();
+    }
+
+    // Files shorter than this gain too little from being compressed.
+    static constexpr size_t MIN_COMPRESSED_SIZE = 256;
+
+    static bool worth_compressing(std::string_view content_type, size_t size)
+    {
+        return size >= MIN_COMPRESSED_SIZE && compressible_type(content_type);
+    }
+
+    static bool not_older(const timespec& a, const timespec& b)
+    {
+        return a.tv_sec > b.tv_sec || (a.tv_sec == b.tv_sec && a.tv_nsec >= b.tv_nsec);
+    }
+
+    static bool same_name(std::string_view a, std::string_view b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+            [](char x, char y) { return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y)); });
+    }
+
+    // A qvalue, "q=0.5" in thousandths, 1000 when there is none and 0 when
+    // it can not be read.
+    static int quality(std::string_view parameters)
+    {
+        auto at = parameters.find("q=");
+        if (at == std::string_view::npos) at = parameters.find("Q=");
+        if (at == std::string_view::npos) return 1000;
+
+        auto value = trim(parameters.substr(at + 2));
+        if (value.empty() || (value[0] != '0' && value[0] != '1')) return 0;
+
+        int thousandths = (value[0] - '0') * 1000;
+        if (value.size() > 1)
+        {
+            if (value[1] != '.' || value.size() > 5) return 0;
+            int scale = 100;
+            for (char digit : value.substr(2))
+            {
+                if (!std::isdigit(static_cast<unsigned char>(digit))) return 0;
+                thousandths += (digit - '0') * scale;
+                scale /= 10;
+            }
+        }
+
+        return std::min(thousandths, 1000);
+    }
+
+    // How much the client wants `encoding`, from the codings listed in its
+    // Accept-Encoding header.
+    static int accepted(const Headers::ValueList& codings, std::string_view encoding)
+    {
+        int exact = -1;
+        int any = -1;
+
+        for (std::string_view coding : codings)
+        {
+            auto semicolon = coding.find(';');
+            auto name = trim(coding.substr(0, semicolon));
+            auto q = quality(semicolon == std::string_view::npos ? std::string_view{} : coding.substr(semicolon + 1));
+
+            if (same_name(name, encoding) || (encoding == "gzip" && same_name(name, "x-gzip"))) exact = q;
+            else if (name == "*") any = q;
+        }
+
+        return exact >= 0 ? exact : std::max(any, 0);
+    }
+
+    std::vector<EncodedVariant> encoded_variants(const std::string& file, std::string_view content_type)
+    {
+        static const std::pair<const char*, const char*> encodings[]{ { "br", ".br" }, { "zstd", ".zst" }, { "gzip", ".gz" } };
+
+        auto original = OpenFile::open(file);
+        if (!original) return {};
+
+        // A copy older than the file was made from an earlier version of it.
+        auto current = [&original](const std::string& path)
+            {
+                auto copy = OpenFile::open(path);
+                return copy && not_older(copy->modified(), original->modified());
+            };
+
+        auto gzipped = file + ".gz";
+        if (gzip_available() && worth_compressing(content_type, original->size()) && !current(gzipped))
+        {
+            // Kept only if it is actually smaller.
+            auto written = gzip_file(file, gzipped) ? OpenFile::open(gzipped) : nullptr;
+            if (written && written->size() >= original->size()) unlink(gzipped.c_str());
+        }
+
+        std::vector<EncodedVariant> variants{};
+        for (auto [encoding, suffix] : encodings)
+        {
+            if (current(file + suffix)) variants.push_back({ encoding, file + suffix });
+        }
+
+        return variants;
+    }
+
+    const EncodedVariant* choose_variant(const Request& request, const std::vector<EncodedVariant>& variants)
+    {
+        if (variants.empty()) return nullptr;
+
+        auto codings = request.headers.list(KnownHeader::ACCEPT_ENCODING);
+        if (codings.empty()) return nullptr;
+
+        // The first of the best liked, the variants are in the order the
+        // server prefers them.
+        const EncodedVariant* chosen = nullptr;
+        int best = 0;
+        for (const auto& variant : variants)
+        {
+            auto q = accepted(codings, variant.encoding);
+            if (q > best)
+            {
+                chosen = &variant;
+                best = q;
+            }
+        }
+
+        return chosen;
+    }
+
+    std::string entity_tag(size_t size, const timespec& modified)
+    {
+        char etag[64];
+        std::snprintf(etag, sizeof(etag), "\"%lx.%lx-%zx\"",
+            static_cast<unsigned long>(modified.tv_sec), static_cast<unsigned long>(modified.tv_nsec), size);
+        return etag;
+    }
+
+    std::string http_date(time_t time)
+    {
+        tm fields{};
+        char date[64];
+        gmtime_r(&time, &fields);
+        auto length = std::strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &fields);
+        return { date, length };
+    }
+
+    std::optional<time_t> parse_http_date(std::string_view date)
+    {
+        // The preferred format, then the obsolete RFC 850 and asctime ones.
+        static const char* formats[]{ "%a, %d %b %Y %H:%M:%S GMT", "%A, %d-%b-%y %H:%M:%S GMT", "%a %b %e %H:%M:%S %Y" };
+
+        char terminated[64];
+        if (date.size() >= sizeof(terminated)) return {};
+        std::memcpy(terminated, date.data(), date.size());
+        terminated[date.size()] = '\0';
+
+        for (auto format : formats)
+        {
+            tm fields{};
+            auto end = strptime(terminated, format, &fields);
+            if (end && *end == '\0') return timegm(&fields);
+        }
+
+        return {};
+    }
+
+    std::optional<std::vector<ByteRange>> parse_ranges(std::string_view value, size_t size)
+    {
+        value = trim(value);
+        if (!value.starts_with("bytes=")) return {};
+
+        std::vector<std::string_view> specs{};
+        split(value.substr(6), ",", specs);
+        if (specs.empty() || specs.size() > MAX_RANGES) return {};
+
+        std::vector<ByteRange> ranges{};
+        for (auto spec : specs)
+        {
+            spec = trim(spec);
+            if (spec.empty()) continue;
+
+            auto dash = spec.find('-');
+            if (dash == std::string_view::npos) return {};
+
+            size_t first{};
+            size_t last{};
+            if (dash == 0)
+            {
+                // The last `last` bytes.
+                if (!parse_number(spec.substr(1), last)) return {};
+                if (last == 0 || size == 0) continue;
+                ranges.push_back({ size - std::min(last, size), size - 1 });
+                continue;
+            }
+
+            if (!parse_number(spec.substr(0, dash), first)) return {};
+            if (dash + 1 == spec.size()) last = size - 1;
+            else if (!parse_number(spec.substr(dash + 1), last) || last < first) return {};
+
+            if (first >= size) continue;
+            ranges.push_back({ first, std::min(last, size - 1) });
+        }
+
+        return ranges;
+    }
+
+    bool answer_conditionally(
+        const Request& request,
+        Response& response,
+        const Validators& validators,
+        size_t size,
+        std::string_view content_type
+    )
+    {
+        // If-Modified-Since only counts when there is no If-None-Match
+        // (RFC 9110, section 13.2.2).
+        bool current = false;
+        if (request.headers.contains(KnownHeader::IF_NONE_MATCH))
+        {
+            current = etag_listed(request.headers.list(KnownHeader::IF_NONE_MATCH), validators.etag);
+        }
+        else if (auto since = request.headers.get(KnownHeader::IF_MODIFIED_SINCE))
+        {
+            auto date = parse_http_date(*since);
+            current = date && validators.modified <= *date;
+        }
+
+        if (current)
+        {
+            response.status = 304;
+            response.reason = "Not Modified";
+            response.headers.set(KnownHeader::ETAG, validators.etag);
+            response.headers.set(KnownHeader::LAST_MODIFIED, validators.last_modified);
+            return true;
+        }
+
+        auto range = request.headers.get(KnownHeader::RANGE);
+        if (!range) return false;
+
+        auto if_range = request.headers.get(KnownHeader::IF_RANGE);
+        if (if_range && !if_range_matches(*if_range, validators)) return false;
+
+        auto ranges = parse_ranges(*range, size);
+        if (!ranges) return false;
+
+        if (ranges->empty())
+        {
+            response.status = 416;
+            response.reason = "Range Not Satisfiable";
+            response.headers.set(KnownHeader::CONTENT_RANGE, "bytes */" + std::to_string(size));
+            return true;
+        }
+
+        response.status = 206;
+        response.reason = "Partial Content";
+        response.headers.set(KnownHeader::ETAG, validators.etag);
+        response.headers.set(KnownHeader::LAST_MODIFIED, validators.last_modified);
+
+        auto content_range = [size](const ByteRange& range)
+            {
+                return "bytes " + std::to_string(range.first) + "-" + std::to_string(range.last) + "/" + std::to_string(size);
+            };
+
+        if (ranges->size() == 1)
+        {
+            const auto& only = ranges->front();
+            response.headers.set(KnownHeader::CONTENT_TYPE, content_type);
+            response.headers.set(KnownHeader::CONTENT_RANGE, content_range(only));
+            response.ranges.push_back({ {}, only.first, only.last - only.first + 1 });
+            return true;
+        }
+
+        // Parts are told apart by a boundary that changes with every
+        // response, rather than one the file could happen to contain. Each
+        // reactor counts its own responses, the file's ETag keeps the
+        // boundaries of different files apart.
+        thread_local uint64_t responses{ 0 };
+        char boundary[32];
+        std::snprintf(boundary, sizeof(boundary), "nimlib%016llx",
+            static_cast<unsigned long long>(std::hash<std::string_view>{}(validators.etag) ^ (++responses * 0x9e3779b97f4a7c15ull)));
+
+        response.headers.set(KnownHeader::CONTENT_TYPE, std::string("multipart/byteranges; boundary=") + boundary);
+        for (const auto& part : *ranges)
+        {
+            std::string head{ "\r\n--" };
+            head += boundary;
+            head += "\r\ncontent-type: ";
+            head += content_type;
+            head += "\r\ncontent-range: " + content_range(part) + "\r\n\r\n";
+            response.ranges.push_back({ std::move(head), part.first, part.last - part.first + 1 });
+        }
+        response.body = std::string{ "\r\n--" } + boundary + "--\r\n";
+
+        return true;
+    }
+};
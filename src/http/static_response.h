@@ -0,0 +1,79 @@
+#pragma once
+
+#include "parser.h"
+
+#include <ctime>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nimlib::Server::Handlers::Http
+{
+    // What a client can tell its copy of a file apart from the current one
+    // with.
+    struct Validators
+    {
+        std::string_view etag;
+        std::string_view last_modified;
+        time_t modified;
+    };
+
+    // First and last byte of a range, both included.
+    struct ByteRange
+    {
+        size_t first;
+        size_t last;
+    };
+
+    // A copy of a static file in some content coding, kept next to it.
+    struct EncodedVariant
+    {
+        std::string encoding;
+        std::string path;
+    };
+
+    // More ranges than this in one request are not worth answering one by
+    // one, the whole file is sent instead.
+    constexpr size_t MAX_RANGES = 16;
+
+    // An entity tag changing whenever the file is written to, made from its
+    // size and modification time rather than from its contents.
+    std::string entity_tag(size_t size, const timespec& modified);
+
+    // Formats a time as an HTTP date, eg. "Sun, 06 Nov 1994 08:49:37 GMT".
+    std::string http_date(time_t time);
+
+    // Parses an HTTP date in any of the three formats clients may send.
+    std::optional<time_t> parse_http_date(std::string_view date);
+
+    // Parses a Range header value for a body of `size` bytes. Nothing is
+    // returned when the header is not understood, it is then ignored, and an
+    // empty list when none of the ranges can be satisfied.
+    std::optional<std::vector<ByteRange>> parse_ranges(std::string_view value, size_t size);
+
+    // The precompressed copies of `file` at least as recent as it, file.br,
+    // file.zst and file.gz, in the order they are preferred. When the server
+    // can compress with gzip, a missing or outdated file.gz is written first
+    // for content types worth compressing.
+    std::vector<EncodedVariant> encoded_variants(const std::string& file, std::string_view content_type);
+
+    // The variant the request's Accept-Encoding header prefers, null when
+    // it accepts none of them and the file is sent as it is.
+    const EncodedVariant* choose_variant(const Request& request, const std::vector<EncodedVariant>& variants);
+
+    // Answers a GET for a static file of `size` bytes from its validators
+    // and the request's conditional and Range headers: 304 when the client's
+    // copy is current, 206 with the requested ranges, one or several as
+    // multipart/byteranges, or 416 when none can be sent. The ranges refer
+    // to the response's file or shared body, which the caller sets when
+    // there are any. Returns false when the whole file is to be sent with a
+    // 200.
+    bool answer_conditionally(
+        const Request& request,
+        Response& response,
+        const Validators& validators,
+        size_t size,
+        std::string_view content_type
+    );
+};
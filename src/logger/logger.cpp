@@ -39,7 +39,7 @@ namespace nimlib::Server::Logging
 
     Logger& Logger::get_instance()
     {
-        static Logger logger{};
+        thread_local static Logger logger{};
         return logger;
     }
 }
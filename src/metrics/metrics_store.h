@@ -82,7 +82,11 @@ namespace nimlib::Server::Metrics
     template <typename T>
     MetricsStore<T>& MetricsStore<T>::get_instance()
     {
-        static MetricsStore aggregator_instance{};
+        // One shard per thread: metrics recorded by an event loop never touch
+        // another loop's aggregators. A report only covers the shard of the
+        // thread asking for it, the shards are not merged as their
+        // aggregators are only ever used by their own thread.
+        thread_local static MetricsStore aggregator_instance{};
         return aggregator_instance;
     }
 }
@@ -0,0 +1,28 @@
+#include <thread>
+#include <vector>
+
+#include "multi_reactor_server.h"
+
+namespace nimlib::Server
+{
+	MultiReactorServer::MultiReactorServer(int reactor_count, server_factory factory)
+		: reactor_count{ reactor_count > 0 ? reactor_count : 1 },
+		factory{ std::move(factory) }
+	{}
+
+	void MultiReactorServer::run()
+	{
+		std::vector<std::jthread> reactors;
+		reactors.reserve(reactor_count);
+
+		for (int i = 0; i < reactor_count; i++)
+		{
+			reactors.emplace_back([this]() {
+				auto server = factory();
+				if (server) server->run();
+				});
+		}
+
+		// The reactor threads are joined when they go out of scope.
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include "common/types.h"
+
+namespace nimlib::Server
+{
+    using nimlib::Server::Types::Server;
+
+    using server_factory = std::function<std::unique_ptr<Server>()>;
+
+    // Runs one event loop per thread. The factory is invoked on each loop's
+    // own thread, so everything it sets up (the listening socket, the
+    // connection pool and the metrics shard) belongs to that thread alone.
+    // The servers it creates are expected to listen with SO_REUSEPORT so the
+    // kernel balances new connections between the loops.
+    class MultiReactorServer : public Server
+    {
+    public:
+        MultiReactorServer(int reactor_count, server_factory factory);
+        ~MultiReactorServer() = default;
+
+        MultiReactorServer(const MultiReactorServer&) = delete;
+        MultiReactorServer& operator=(const MultiReactorServer&) = delete;
+        MultiReactorServer(MultiReactorServer&&) noexcept = delete;
+        MultiReactorServer& operator=(MultiReactorServer&&) noexcept = delete;
+
+        void run() override;
+
+    private:
+        int reactor_count;
+        server_factory factory;
+    };
+};
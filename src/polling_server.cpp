@@ -14,14 +14,14 @@ using nimlib::Server::Sockets::TcpSocket;
 
 namespace nimlib::Server
 {
-	PollingServer::PollingServer(const std::string& port)
+	PollingServer::PollingServer(const std::string& port, bool reuse_port)
 		: port{ port },
-		server_socket{ nimlib::Server::Decorators::decorate(std::make_unique<TcpSocket>(port)) },
+		server_socket{ nimlib::Server::Decorators::decorate(std::make_unique<TcpSocket>(port, reuse_port)) },
 		connection_pool{ nimlib::Server::TcpConnectionPool::get_pool() }
 	{
 		server_socket->tcp_bind();
 		server_socket->tcp_listen();
-		create_pollfds_entry(server_socket->get_tcp_socket_descriptor(), server_fd);
+		create_pollfds_entry(server_socket->get_tcp_socket_descriptor(), POLLIN, server_fd);
 	}
 
 	PollingServer::~PollingServer()
@@ -36,32 +36,51 @@ namespace nimlib::Server
 
 		while (true)
 		{
-			setup_fds(sockets);
-			poll_result = poll(sockets.data(), sockets.size(), 10); // TODO: timeout for polling
+			bool scheduled = setup_fds(sockets);
+			// Connections that can make progress without the kernel must not
+			// wait, they are picked up by clean_up() below. Otherwise poll()
+			// sleeps until the next connection deadline.
+			int timeout = scheduled ? 0 : connection_pool.next_time_out();
+			poll_result = poll(sockets.data(), sockets.size(), timeout);
+			connection_pool.time_out_connections();
 			accept_new_connection(sockets);
 			handle_connections(sockets);
 			connection_pool.clean_up();
 		}
 	}
 
-	void PollingServer::setup_fds(std::vector<pollfd>& sockets)
+	bool PollingServer::setup_fds(std::vector<pollfd>& sockets)
 	{
+		bool scheduled = false;
 		sockets.clear();
 		sockets.push_back(server_fd);
 
 		for (const auto& connection : connection_pool.get_all())
 		{
-			if (connection->get_state() != ConnectionState::INACTIVE)
+			auto state = connection->get_state();
+			if (state == ConnectionState::INACTIVE) continue;
+
+			// Only connections waiting on their socket are handed to the
+			// kernel, and only for the one event they are waiting on. An idle
+			// socket is nearly always writable, polling it for output would
+			// make poll() return immediately on every iteration.
+			short events = interest(state);
+			if (events)
 			{
 				assert(connection->get_id() > 0);
 				pollfd fds{};
-				create_pollfds_entry(connection->get_id(), fds);
+				create_pollfds_entry(connection->get_id(), events, fds);
 				sockets.push_back(fds);
 			}
+			else
+			{
+				scheduled = true;
+			}
 		}
 
 		// Server socket must always be the first socket in the vector.
 		assert(sockets[0].fd == server_socket->get_tcp_socket_descriptor());
+		return scheduled;
 	}
 
 	void PollingServer::accept_new_connection(std::vector<pollfd>& sockets)
@@ -78,7 +97,7 @@ namespace nimlib::Server
 		std::for_each(sockets.begin() + 1, sockets.end(), [&](const auto& socket) {
 			auto connection = connection_pool.find(socket.fd);
 			auto state = connection->get_state();
-			if (socket.revents & POLLIN)
+			if (socket.revents & (POLLIN | POLLHUP | POLLERR))
 			{
 				if (allowed_to_read(state)) connection->notify(ServerDirective::READ_SOCKET);
 			}
@@ -93,13 +112,20 @@ namespace nimlib::Server
 			});
 	}
 
-	void PollingServer::create_pollfds_entry(int socket, pollfd& fds)
+	void PollingServer::create_pollfds_entry(int socket, short events, pollfd& fds)
 	{
 		fds.fd = socket;
-		fds.events = POLLIN | POLLOUT;
+		fds.events = events;
 		fds.revents = 0;
 	}
 
+	short PollingServer::interest(ConnectionState state)
+	{
+		if (allowed_to_read(state)) return POLLIN;
+		if (allowed_to_write(state)) return POLLOUT;
+		return 0;
+	}
+
 	bool PollingServer::allowed_to_read(ConnectionState state)
 	{
 		return (state == ConnectionState::READY_TO_READ);
@@ -17,7 +17,7 @@ namespace nimlib::Server
     class PollingServer : public Server
     {
     public:
-        PollingServer(const std::string& port);
+        PollingServer(const std::string& port, bool reuse_port = false);
         ~PollingServer();
 
         PollingServer(const PollingServer&) = delete;
@@ -28,11 +28,12 @@ namespace nimlib::Server
         void run() override;
 
     private:
-        void setup_fds(std::vector<pollfd>&);
+        bool setup_fds(std::vector<pollfd>&);
         void accept_new_connection(std::vector<pollfd>&);
         void handle_connections(std::vector<pollfd>&);
 
-        static void create_pollfds_entry(int, pollfd&);
+        static void create_pollfds_entry(int, short, pollfd&);
+        static short interest(ConnectionState state);
         static bool allowed_to_read(ConnectionState state);
         static bool allowed_to_write(ConnectionState state);
 
@@ -1,5 +1,7 @@
 #include "tcp_connection.h"
 
+#include <array>
+#include <cerrno>
 #include <memory>
 #include <cassert>
 #include <utility>
@@ -38,6 +40,8 @@ namespace nimlib::Server
         {ConnectionState::DONE, 1'000'000'000},
     };
 
+    const std::unordered_map<ConnectionState, long> TcpConnection::no_time_outs{};
+
     TcpConnection::TcpConnection(std::unique_ptr<Socket> s, connection_id id, size_t buffer_size)
         : id{ id },
         buffer_size{ buffer_size },
@@ -60,10 +64,19 @@ namespace nimlib::Server
         connection_state.set_state(ConnectionState::INACTIVE);
     }
 
+    TcpConnection::TcpConnection(connection_id id, TimingWheel& timers, size_t buffer_size)
+        : TcpConnection(id, buffer_size)
+    {
+        this->timers = &timers;
+    }
+
     void TcpConnection::accept_socket(std::unique_ptr<Socket> s)
     {
+        // Connections are recycled by the pool, each accepted socket gives
+        // the connection its new id.
+        if (s) id = s->get_tcp_socket_descriptor();
         socket = std::move(s);
-        connection_state.set_state(ConnectionState::READY_TO_READ);
+        set_state(ConnectionState::READY_TO_READ);
     }
 
     void TcpConnection::notify(ServerDirective directive)
@@ -85,27 +98,21 @@ namespace nimlib::Server
 
     void TcpConnection::notify(Handler& notifying_handler)
     {
-        // No assumption is made about how the streams will be used by the
-        // application layer. The clear() method is being called in case
-        // the application puts the streams in an error state.
-        input_stream.clear();
-        output_stream.clear();
-
         if (notifying_handler.wants_to_write())
         {
-            connection_state.set_state(ConnectionState::READY_TO_WRITE);
+            set_state(ConnectionState::READY_TO_WRITE);
         }
         else if (notifying_handler.wants_to_live())
         {
-            connection_state.set_state(ConnectionState::READY_TO_WRITE);
+            set_state(ConnectionState::READY_TO_WRITE);
         }
         else if (notifying_handler.wants_more_bytes())
         {
-            connection_state.set_state(ConnectionState::READY_TO_READ);
+            set_state(ConnectionState::READY_TO_READ);
         }
         else if (notifying_handler.wants_to_be_calledback())
         {
-            connection_state.set_state(ConnectionState::READY_TO_WRITE);
+            set_state(ConnectionState::READY_TO_WRITE);
         }
         else
         {
@@ -129,9 +136,10 @@ namespace nimlib::Server
             response_timer.end();
         }
 
-        connection_state.set_state(ConnectionState::INACTIVE);
-        input_stream.str("");
-        output_stream.str("");
+        keep_alive = false;
+        set_state(ConnectionState::INACTIVE);
+        input_buffer.clear();
+        output_queue.clear();
 
         if (socket)
         {
@@ -139,100 +147,156 @@ namespace nimlib::Server
         }
     }
 
+    void TcpConnection::time_out() { set_state(ConnectionState::CONNECTION_ERROR); }
+
     ConnectionState TcpConnection::get_state() { return connection_state.get_state(); }
 
     const int TcpConnection::get_id() const { return id; }
 
-    std::stringstream& TcpConnection::source() { return input_stream; }
+    ByteBuffer& TcpConnection::source() { return input_buffer; }
 
-    std::stringstream& TcpConnection::sink() { return output_stream; }
+    OutputQueue& TcpConnection::sink() { return output_queue; }
 
     ConnectionState TcpConnection::read()
     {
-        if (connection_state.set_state(ConnectionState::READING) == ConnectionState::CONNECTION_ERROR)
+        if (set_state(ConnectionState::READING) == ConnectionState::CONNECTION_ERROR)
         {
             return ConnectionState::CONNECTION_ERROR;
         }
 
-        std::vector<uint8_t> buff(buffer_size, 0);
-        int bytes_count = socket->tcp_read(buff, MSG_DONTWAIT);
+        // The socket is read straight into the input buffer until it has
+        // nothing more to give, or until enough has been read for one turn.
+        // A read filling less than the space it was given means the socket
+        // is drained, there is no need for one more read to find that out.
+        size_t bytes_count = 0;
+        while (bytes_count < MAX_READ_PER_NOTIFY)
+        {
+            auto space = input_buffer.writable(buffer_size);
+            int count = socket->tcp_read(space, MSG_DONTWAIT);
+            if (count <= 0) break;
+
+            input_buffer.commit(count);
+            bytes_count += count;
+            if (count < space.size()) break;
+        }
 
         if (bytes_count > 0)
         {
-            for (int i = 0; i < bytes_count && i < buffer_size; i++)
-            {
-                input_stream << buff[i];
-            }
+            keep_alive = false;
 
             // Handler must not be null.
             assert(handler);
 
-            connection_state.set_state(ConnectionState::HANDLING);
+            set_state(ConnectionState::HANDLING);
             handler->notify(*this, *this);
             return connection_state.get_state();
         }
         else
         {
             // TODO: we might need some error handling here.
-            return connection_state.set_state(ConnectionState::CONNECTION_ERROR);
+            return set_state(ConnectionState::CONNECTION_ERROR);
         }
     }
 
     ConnectionState TcpConnection::write()
     {
-        if (connection_state.set_state(ConnectionState::WRITING) == ConnectionState::CONNECTION_ERROR)
+        if (set_state(ConnectionState::WRITING) == ConnectionState::CONNECTION_ERROR)
         {
             return ConnectionState::CONNECTION_ERROR;
         }
 
-        std::string response_str{ std::move(output_stream.str()) };
-        std::string_view response{ response_str };
-        size_t bytes_to_send = response_str.size();
-        size_t bytes_sent = 0;
+        // The queued slices go out straight from where they are, files
+        // included, a write the socket only takes part of just moves the
+        // start of the queue.
+        std::array<iovec, MAX_SLICES_PER_WRITE> buffers;
+        size_t written = 0;
 
-        while (bytes_sent < bytes_to_send)
+        while (!output_queue.empty() && written < MAX_WRITE_PER_NOTIFY)
         {
-            auto sent = socket->tcp_send(response.substr(bytes_sent));
+            int sent;
+            if (auto file = output_queue.front_file())
+            {
+                sent = socket->tcp_send_file(file->file->descriptor(), file->offset, file->size);
+            }
+            else
+            {
+                // A response head followed by a file is held back to go out
+                // with its start, rather than in a packet of its own that
+                // would wait on the client acknowledging it.
+                auto count = output_queue.gather(buffers);
+                size_t gathered = 0;
+                for (size_t i = 0; i < count; i++) gathered += buffers[i].iov_len;
+                sent = socket->tcp_send(std::span<const iovec>{ buffers.data(), count }, gathered < output_queue.size());
+            }
 
-            if (sent < 0)
+            // A full socket is written to again once it has room, any other
+            // failure, or a file that ends early, ends the connection.
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
             {
                 break;
             }
+            else if (sent <= 0)
+            {
+                return set_state(ConnectionState::CONNECTION_ERROR);
+            }
             else
             {
-                bytes_sent += sent;
+                output_queue.consume(sent);
+                written += sent;
             }
         }
 
-        if (bytes_sent == bytes_to_send)
+        if (output_queue.empty())
         {
-            output_stream.str("");
-
             if (handler->wants_to_be_calledback())
             {
-                return connection_state.set_state(ConnectionState::HANDLING);
+                return set_state(ConnectionState::HANDLING);
             }
             else if (handler->wants_to_live())
             {
-                input_stream.str("");
-                output_stream.str("");
                 response_timer.end();
-                return connection_state.set_state(ConnectionState::READY_TO_READ);
+
+                // Requests the client pipelined behind the ones just answered
+                // may have been read already, they are handled right away
+                // rather than waiting for the socket to have more.
+                if (!input_buffer.empty()) return set_state(ConnectionState::HANDLING);
+
+                keep_alive = true;
+                return set_state(ConnectionState::READY_TO_READ);
             }
             else
             {
-                return connection_state.set_state(ConnectionState::DONE);
+                return set_state(ConnectionState::DONE);
             }
         }
-        else if (bytes_sent < bytes_to_send)
+        else
         {
-            std::string remainder{ response.substr(bytes_sent) };
-            output_stream.str(remainder);
-            return connection_state.set_state(ConnectionState::READY_TO_WRITE);
+            return set_state(ConnectionState::READY_TO_WRITE);
         }
-        else
+    }
+
+    ConnectionState TcpConnection::set_state(ConnectionState state)
+    {
+        state = connection_state.set_state(state);
+
+        // Every state change restarts the time the connection is given in its
+        // new state, like the state manager would do for its own timeouts.
+        if (timers)
         {
-            assert(false);
+            if (keep_alive && state == ConnectionState::READY_TO_READ)
+            {
+                timers->schedule(id, KEEP_ALIVE_TIME_OUT);
+            }
+            else if (auto it = state_time_outs.find(state); it != state_time_outs.end())
+            {
+                timers->schedule(id, std::chrono::milliseconds(it->second));
+            }
+            else
+            {
+                timers->cancel(id);
+            }
         }
+
+        return state;
     }
 }
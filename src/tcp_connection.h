@@ -1,10 +1,10 @@
 #pragma once
 
-#include <sstream>
 #include <chrono>
 
 #include "common/types.h"
 #include "utils/state_manager.h"
+#include "utils/timing_wheel.h"
 #include "metrics/measure.h"
 
 namespace nimlib::Server
@@ -16,12 +16,16 @@ namespace nimlib::Server
     using nimlib::Server::Constants::ServerDirective;
     using nimlib::Server::Constants::ConnectionState;
     using nimlib::Server::Utils::StateManager;
+    using nimlib::Server::Utils::TimingWheel;
+    using nimlib::Server::Utils::ByteBuffer;
+    using nimlib::Server::Utils::OutputQueue;
 
     class TcpConnection : public Connection, public StreamsProvider
     {
     public:
         TcpConnection(std::unique_ptr<Socket>, connection_id, size_t buffer_size = 10240);
         explicit TcpConnection(connection_id id, size_t buffer_size = 10240);
+        TcpConnection(connection_id id, TimingWheel& timers, size_t buffer_size = 10240);
         ~TcpConnection() = default;
 
         TcpConnection(const TcpConnection&) = delete;
@@ -34,35 +38,56 @@ namespace nimlib::Server
         void notify(Handler& notifying_handler) override;
         void set_handler(std::shared_ptr<Handler>) override;
         void halt() override;
+        void time_out() override;
         ConnectionState get_state() override;
         const int get_id() const override;
 
-        std::stringstream& source() override;
-        std::stringstream& sink() override;
+        ByteBuffer& source() override;
+        OutputQueue& sink() override;
+
+        // How long a kept alive connection may wait for the client to start
+        // its next request before it is closed.
+        static constexpr std::chrono::milliseconds KEEP_ALIVE_TIME_OUT{ 5'000 };
 
     private:
         ConnectionState read();
         ConnectionState write();
+        ConnectionState set_state(ConnectionState state);
 
     private:
-        const connection_id id;
+        connection_id id;
         size_t buffer_size;
+        // Set between a kept alive response and the next request, while
+        // READY_TO_READ is bounded by KEEP_ALIVE_TIME_OUT.
         bool keep_alive{ false };
         StateManager<ConnectionState> connection_state{
             ConnectionState::READY_TO_READ,
             ConnectionState::CONNECTION_ERROR,
             states_transition_map,
             max_reset_counts,
-            state_time_outs
+            no_time_outs
         };
-        std::stringstream input_stream{};
-        std::stringstream output_stream{};
+        ByteBuffer input_buffer{};
+        OutputQueue output_queue{};
         std::unique_ptr<Socket> socket;
         std::shared_ptr<Handler> handler;
         nimlib::Server::Metrics::Measurements::Duration<long> response_timer;
+        // Deadlines are kept by the loop owning the connection rather than
+        // checked against the clock on every state access.
+        TimingWheel* timers{ nullptr };
+
+        // Most a connection reads from its socket before its handler is
+        // called, so one client sending a lot does not hold up the others.
+        static constexpr size_t MAX_READ_PER_NOTIFY = 64 * 1024;
+        // Most a connection writes to its socket before the loop moves on to
+        // the others, the rest goes out once the socket is ready again.
+        static constexpr size_t MAX_WRITE_PER_NOTIFY = 1024 * 1024;
+        // Most slices of the output queue handed to one writev(2) call.
+        static constexpr size_t MAX_SLICES_PER_WRITE = 64;
 
         static const std::unordered_map<ConnectionState, std::vector<ConnectionState>> states_transition_map;
         static const std::unordered_map<ConnectionState, int> max_reset_counts;
         static const std::unordered_map<ConnectionState, long> state_time_outs;
+        static const std::unordered_map<ConnectionState, long> no_time_outs;
     };
 };
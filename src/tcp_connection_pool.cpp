@@ -15,59 +15,133 @@ using nimlib::Server::Handlers::TlsLayer;
 
 namespace nimlib::Server
 {
-    TcpConnectionPool::TcpConnectionPool()
-    {
-        connections.resize(CONNECTIONS);
-        for (int i = 0; i < connections.size(); i++)
-        {
-            connections[i] = std::move(std::make_shared<TcpConnection>(i));
-        }
-    }
+    TcpConnectionPool::TcpConnectionPool() = default;
 
     TcpConnectionPool::~TcpConnectionPool() = default;
 
     void TcpConnectionPool::record_connection(socket_ptr s)
     {
-        assert(connections[s->get_tcp_socket_descriptor()] != nullptr);
+        if (!s) return;
+
+        connection_id id = s->get_tcp_socket_descriptor();
+        assert(id >= 0);
+
+        // The table grows with the highest descriptor seen so far.
+        if (id >= positions.size()) positions.resize(id + 1, -1);
+        assert(positions[id] < 0);
 
-        auto& connection = dynamic_cast<TcpConnection&>(*connections[s->get_tcp_socket_descriptor()]);
+        auto& connection = acquire();
         connection.accept_socket(std::move(s));
         auto http_handler = std::make_shared<HttpHandler>();
         // auto tls_handler = std::make_shared<TlsLayer>(http_handler);
         // handlers.push_back(http_handler);
         connection.set_handler(http_handler);
+
+        positions[id] = active.size();
+        active.push_back(&connection);
     }
 
-    connection_ptr TcpConnectionPool::find(connection_id id) const
+    Connection* TcpConnectionPool::find(connection_id id) const
     {
-        return connections[id];
+        if (id < 0 || id >= positions.size() || positions[id] < 0) return nullptr;
+        return active[positions[id]];
     }
 
-    const std::vector<connection_ptr>& TcpConnectionPool::get_all() const
+    const std::vector<Connection*>& TcpConnectionPool::get_all() const
     {
-        return connections;
+        return active;
     }
 
+    size_t TcpConnectionPool::size() const { return active.size(); }
+
     void TcpConnectionPool::clean_up()
     {
-        for (auto& connection : connections)
+        // Walking backwards, a connection released on the way swaps in one
+        // that has already been visited.
+        for (int i = active.size() - 1; i >= 0; i--)
+        {
+            clean_up(*active[i]);
+        }
+    }
+
+    ConnectionState TcpConnectionPool::clean_up(connection_id id)
+    {
+        auto connection = find(id);
+        if (!connection) return ConnectionState::INACTIVE;
+        return clean_up(*connection);
+    }
+
+    int TcpConnectionPool::next_time_out() const
+    {
+        return timers.next_time_out();
+    }
+
+    void TcpConnectionPool::refresh_clock()
+    {
+        timers.refresh(TimingWheel::clock::now());
+    }
+
+    const std::vector<connection_id>& TcpConnectionPool::time_out_connections()
+    {
+        // Only connections whose deadline has passed are visited, no matter
+        // how many connections the pool holds.
+        const auto& expired = timers.advance(TimingWheel::clock::now());
+        for (auto id : expired)
         {
-            assert(connection != nullptr);
-            auto connection_state = connection->get_state();
-            if (connection_state == ConnectionState::HANDLING)
-            {
-                connection->notify(ServerDirective::CONTINUE_HANDLING);
-            }
-            else if (connection_state == ConnectionState::CONNECTION_ERROR || connection_state == ConnectionState::DONE)
-            {
-                connection->halt();
-            }
+            find(id)->time_out();
         }
+
+        return expired;
+    }
+
+    ConnectionState TcpConnectionPool::clean_up(Connection& connection)
+    {
+        auto connection_state = connection.get_state();
+        if (connection_state == ConnectionState::HANDLING)
+        {
+            connection.notify(ServerDirective::CONTINUE_HANDLING);
+        }
+        else if (connection_state == ConnectionState::CONNECTION_ERROR || connection_state == ConnectionState::DONE)
+        {
+            connection.halt();
+            release(connection.get_id());
+        }
+
+        return connection.get_state();
+    }
+
+    TcpConnection& TcpConnectionPool::acquire()
+    {
+        if (free_connections.empty())
+        {
+            return slab.emplace_back(-1, timers);
+        }
+
+        auto connection = free_connections.back();
+        free_connections.pop_back();
+        return *connection;
+    }
+
+    void TcpConnectionPool::release(connection_id id)
+    {
+        int position = positions[id];
+        assert(position >= 0);
+
+        // The last active connection fills the gap to keep the array dense.
+        auto connection = active[position];
+        active[position] = active.back();
+        positions[active[position]->get_id()] = position;
+        active.pop_back();
+        positions[id] = -1;
+
+        free_connections.push_back(static_cast<TcpConnection*>(connection));
     }
 
     TcpConnectionPool& TcpConnectionPool::get_pool()
     {
-        static TcpConnectionPool connection_pool{};
+        // Every event loop thread owns its own pool, so connections are never
+        // shared between threads.
+        thread_local static TcpConnectionPool connection_pool{};
         return connection_pool;
     };
 }
@@ -1,11 +1,23 @@
 #pragma once
 
 #include "common/types.h"
+#include "tcp_connection.h"
+#include "utils/timing_wheel.h"
 
+#include <deque>
 #include <vector>
 
 namespace nimlib::Server
 {
+    using nimlib::Server::Types::Connection;
+    using nimlib::Server::Constants::ConnectionState;
+    using nimlib::Server::Utils::TimingWheel;
+
+    // Connections are looked up by socket descriptor. The connection objects
+    // live in a slab that grows block by block as connections are accepted,
+    // halted ones go to a free list and are handed out again, so a server
+    // stops allocating connections once it has seen its peak load. Live
+    // connections are also kept in a dense array for the loops to walk.
     class TcpConnectionPool
     {
     private:
@@ -21,14 +33,34 @@ namespace nimlib::Server
         TcpConnectionPool& operator=(TcpConnectionPool&&) = delete;
 
         void record_connection(socket_ptr s);
-        connection_ptr find(connection_id id) const;
-        const std::vector<connection_ptr>& get_all() const;
+        Connection* find(connection_id id) const;
+        const std::vector<Connection*>& get_all() const;
+        size_t size() const;
         void clean_up();
+        ConnectionState clean_up(connection_id id);
+        int next_time_out() const;
+        // Brings the time connection deadlines are set from up to date, see
+        // TimingWheel::refresh().
+        void refresh_clock();
+        const std::vector<connection_id>& time_out_connections();
 
         static TcpConnectionPool& get_pool();
 
     private:
-        std::vector<connection_ptr> connections{};
-        const int CONNECTIONS = 65;
+        ConnectionState clean_up(Connection& connection);
+        TcpConnection& acquire();
+        void release(connection_id id);
+
+    private:
+        // Deadlines of every connection in the pool, the pool belongs to a
+        // single loop so this is the loop's timing wheel.
+        TimingWheel timers{};
+        // A deque never moves its elements, so it doubles as the slab.
+        std::deque<TcpConnection> slab{};
+        std::vector<TcpConnection*> free_connections{};
+        std::vector<Connection*> active{};
+        // Position in the active array of the connection for each socket
+        // descriptor, -1 for descriptors without one.
+        std::vector<int> positions{};
     };
 };
@@ -1,18 +1,34 @@
+#include <algorithm>
+#include <csignal>
 #include <cstring>
 #include <span>
 #include <string_view>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 #include "tcp_socket.h"
 
 namespace nimlib::Server::Sockets
 {
+    // Sends never wait for room in the socket, a full one fails with EAGAIN
+    // and the connection writes the rest once it is told the socket has
+    // room. A peer that is gone fails the send rather than raising SIGPIPE.
+#ifdef MSG_NOSIGNAL
+    static constexpr int SEND_FLAGS = MSG_DONTWAIT | MSG_NOSIGNAL;
+#else
+    static constexpr int SEND_FLAGS = MSG_DONTWAIT;
+#endif
+
     TcpSocket::TcpSocket(int tcp_socket, const std::string& port) :
         Socket{ port, tcp_socket }
     {
@@ -21,7 +37,7 @@ namespace nimlib::Server::Sockets
         // setsockopt(tcp_socket, SOL_SOCKET, SO_NOSIGPIPE, (void*)&set, sizeof(int));
     }
 
-    TcpSocket::TcpSocket(const std::string& port) : Socket{ port, 0 }
+    TcpSocket::TcpSocket(const std::string& port, bool reuse_port) : Socket{ port, 0 }
     {
         addrinfo hints;
         memset(&hints, 0, sizeof(hints));
@@ -41,6 +57,13 @@ namespace nimlib::Server::Sockets
         {
             // log_agent->error(std::format("failed to create socket to bind to port {}", port));
         }
+        else if (reuse_port)
+        {
+            // Lets several listening sockets, one per event loop, bind to the
+            // same port. The kernel spreads incoming connections among them.
+            int set = 1;
+            setsockopt(tcp_socket_descriptor, SOL_SOCKET, SO_REUSEPORT, &set, sizeof(set));
+        }
         else
         {
             // log_agent->info(std::format("socket {} created to bind to port {}", tcp_socket_descriptor, port));
@@ -107,6 +130,10 @@ namespace nimlib::Server::Sockets
 
     int TcpSocket::tcp_listen()
     {
+        // sendfile(2) takes no flags, a peer gone in the middle of a file
+        // would end the process with SIGPIPE. A server has no use for it.
+        std::signal(SIGPIPE, SIG_IGN);
+
         return listen(tcp_socket_descriptor, MAX_CONNECTIONS);
     }
 
@@ -114,11 +141,23 @@ namespace nimlib::Server::Sockets
     {
         sockaddr_storage client_address{};
         socklen_t client_len = sizeof(client_address);
+        // Accepted sockets never block, a send or sendfile the socket has no
+        // room for fails with EAGAIN and is done again once it has.
+#ifdef __linux__
+        int socket_client = accept4(
+            tcp_socket_descriptor,
+            (sockaddr*)&client_address,
+            &client_len,
+            SOCK_NONBLOCK
+        );
+#else
         int socket_client = accept(
             tcp_socket_descriptor,
             (sockaddr*)&client_address,
             &client_len
         );
+        if (socket_client >= 0) fcntl(socket_client, F_SETFL, fcntl(socket_client, F_GETFL) | O_NONBLOCK);
+#endif
 
         if (socket_client < 0)
         {
@@ -155,12 +194,43 @@ namespace nimlib::Server::Sockets
 
     int TcpSocket::tcp_send(std::span<uint8_t> buffer)
     {
-        return send(tcp_socket_descriptor, buffer.data(), buffer.size(), 0);
+        return send(tcp_socket_descriptor, buffer.data(), buffer.size(), SEND_FLAGS);
     }
 
     int TcpSocket::tcp_send(std::string_view buffer)
     {
-        return send(tcp_socket_descriptor, buffer.data(), buffer.size(), 0);
+        return send(tcp_socket_descriptor, buffer.data(), buffer.size(), SEND_FLAGS);
+    }
+
+    int TcpSocket::tcp_send(std::span<const iovec> buffers, bool more)
+    {
+        msghdr message{};
+        message.msg_iov = const_cast<iovec*>(buffers.data());
+        message.msg_iovlen = buffers.size();
+
+#ifdef MSG_MORE
+        return sendmsg(tcp_socket_descriptor, &message, SEND_FLAGS | (more ? MSG_MORE : 0));
+#else
+        return sendmsg(tcp_socket_descriptor, &message, SEND_FLAGS);
+#endif
+    }
+
+    int TcpSocket::tcp_send_file(int file_descriptor, size_t offset, size_t count)
+    {
+        // One call sends a bounded part of the file, the rest goes out on
+        // later turns of the loop.
+        count = std::min<size_t>(count, MAX_SEND_FILE);
+
+#ifdef __linux__
+        off_t file_offset = offset;
+        return sendfile(tcp_socket_descriptor, file_descriptor, &file_offset, count);
+#else
+        // Without sendfile(2) the bytes go through a buffer on the stack.
+        char buffer[64 * 1024];
+        auto copied = pread(file_descriptor, buffer, std::min(count, sizeof(buffer)), offset);
+        if (copied <= 0) return -1;
+        return send(tcp_socket_descriptor, buffer, copied, SEND_FLAGS);
+#endif
     }
 
     void TcpSocket::tcp_close() { close(tcp_socket_descriptor); }
@@ -2,6 +2,7 @@
 
 #include <span>
 #include <netdb.h>
+#include <sys/socket.h>
 
 #include "common/types.h"
 
@@ -12,7 +13,7 @@ namespace nimlib::Server::Sockets
     struct TcpSocket : public Socket
     {
         TcpSocket(int tcp_socket, const std::string& port = "");
-        TcpSocket(const std::string& port);
+        TcpSocket(const std::string& port, bool reuse_port = false);
         ~TcpSocket();
 
         TcpSocket(const TcpSocket&) = delete;
@@ -28,6 +29,8 @@ namespace nimlib::Server::Sockets
         int tcp_read(std::span<uint8_t> buffer, int flags) override;
         int tcp_send(std::span<uint8_t> buffer) override;
         int tcp_send(std::string_view buffer) override;
+        int tcp_send(std::span<const iovec> buffers, bool more) override;
+        int tcp_send_file(int file_descriptor, size_t offset, size_t count) override;
         void tcp_close() override;  // TODO: may never be used
         const int get_tcp_socket_descriptor() const override;
         const std::string& get_port() const override;
@@ -48,6 +51,11 @@ namespace nimlib::Server::Sockets
         // TODO: try to avoid the raw pointer here
         addrinfo* bind_address;
         // TODO: this will eventually come from config
-        static const int MAX_CONNECTIONS{ 10 };
+        // Length of the queue of connections waiting to be accepted, a short
+        // queue drops connection attempts whenever many arrive at once.
+        static const int MAX_CONNECTIONS{ SOMAXCONN };
+        // Most bytes of a file one sendfile(2) call is asked for, so a client
+        // that reads quickly does not keep the loop on its connection.
+        static const int MAX_SEND_FILE{ 1 << 20 };
     };
 };
@@ -18,24 +18,14 @@ namespace nimlib::Server::Handlers::BotanSpec
 
 	void Callbacks::tls_emit_data(std::span<const uint8_t> data)
 	{
-		std::stringstream& encrypted_output{ encrypted_streams.sink() };
-
-		for (auto c : data)
-		{
-			encrypted_output << c;
-		}
+		encrypted_streams.sink().append(std::string_view{ reinterpret_cast<const char*>(data.data()), data.size() });
 
 		connection.notify(tls_layer);
 	}
 
 	void Callbacks::tls_record_received(uint64_t seq_no, std::span<const uint8_t> data)
 	{
-		std::stringstream& decrypted_input{ decrypted_streams.source() };
-
-		for (auto c : data)
-		{
-			decrypted_input << c;
-		}
+		decrypted_streams.source().append({ reinterpret_cast<const char*>(data.data()), data.size() });
 
 		next->notify(tls_layer, connection, decrypted_streams);
 	}
@@ -1,6 +1,8 @@
 #include "tls_layer.h"
 #include "botan/botan_tls_server.h"
 
+#include <algorithm>
+
 namespace nimlib::Server::Handlers
 {
 	TlsLayer::TlsLayer(std::shared_ptr<Handler> next) : next{ next } {}
@@ -14,16 +16,27 @@ namespace nimlib::Server::Handlers
 				tls_server = nimlib::Server::Handlers::BotanSpec::get_tls_server(connection, *this, next, streams, *this);
 			}
 
-			std::stringstream& encrypted_input{ streams.source() };
-			std::string in_string{ encrypted_input.str() };
-			if (in_string.size() > 0)
+			encrypted_output = &streams.sink();
+
+			ByteBuffer& encrypted_input{ streams.source() };
+			if (!encrypted_input.empty())
 			{
-				encrypted_input.str("");
-				auto in_string_ptr = reinterpret_cast<uint8_t*>(in_string.data());
-				auto bytes_needed = tls_server->received_data(in_string_ptr, in_string.size());
+				// Botan keeps what it can not decrypt yet, the whole input is
+				// handed over and dropped from the buffer.
+				auto in_bytes = encrypted_input.readable();
+				auto bytes_needed = tls_server->received_data(reinterpret_cast<const uint8_t*>(in_bytes.data()), in_bytes.size());
+				encrypted_input.consume(in_bytes.size());
 				tls_continue = bytes_needed > 0;
 				connection.notify(*this);
 			}
+			else if (!decrypted_output.empty())
+			{
+				// The connection has written what was encrypted so far, the
+				// response it is part of goes on from where it stopped.
+				encrypt_pending();
+				close_when_done();
+				connection.notify(*this);
+			}
 			else
 			{
 				next->notify(*this, connection, *this);
@@ -40,10 +53,57 @@ namespace nimlib::Server::Handlers
 	{
 		if (handler.wants_to_write() || handler.wants_to_live() || handler.wants_to_be_calledback())
 		{
-			tls_server->send(streams.sink().str());
+			encrypt_pending();
 		}
 
-		tls_server->close();
+		close_when_done();
+	}
+
+	void TlsLayer::close_when_done()
+	{
+		// A kept-alive connection goes on with its next request in the same
+		// session, only one the handler is done with gets its close_notify.
+		if (decrypted_output.empty() && !next->wants_to_live()) tls_server->close();
+	}
+
+	void TlsLayer::encrypt_pending()
+	{
+		// Each slice becomes its own record, none is copied to join them.
+		// Files have to be encrypted, they are read a record at a time and
+		// only while the connection has little left to write. The rest of the
+		// file waits for the connection to call back once it has written that,
+		// so however big the file, a connection holds no more than its high
+		// watermark of it.
+		auto& output = decrypted_output;
+		std::array<iovec, 16> buffers;
+		while (!output.empty())
+		{
+			size_t sent = 0;
+			if (auto file = output.front_file())
+			{
+				if (encrypted_output && encrypted_output->over_high_watermark()) return;
+
+				std::array<uint8_t, 16 * 1024> record;
+				sent = file->file->read(file->offset, reinterpret_cast<char*>(record.data()), std::min(file->size, record.size()));
+				if (sent == 0)
+				{
+					// The file can not be read, the response is cut short.
+					output.clear();
+					break;
+				}
+				tls_server->send(std::span<const uint8_t>{ record.data(), sent });
+			}
+			else
+			{
+				auto count = output.gather(buffers);
+				for (size_t i = 0; i < count; i++)
+				{
+					tls_server->send(std::span<const uint8_t>{ static_cast<const uint8_t*>(buffers[i].iov_base), buffers[i].iov_len });
+					sent += buffers[i].iov_len;
+				}
+			}
+			output.consume(sent);
+		}
 	}
 
 	bool TlsLayer::wants_more_bytes() { return tls_continue || next->wants_more_bytes(); }
@@ -52,11 +112,11 @@ namespace nimlib::Server::Handlers
 
 	bool TlsLayer::wants_to_live() { return tls_continue || next->wants_to_live(); }
 
-	bool TlsLayer::wants_to_be_calledback() { return next->wants_to_be_calledback(); }
+	bool TlsLayer::wants_to_be_calledback() { return !decrypted_output.empty() || next->wants_to_be_calledback(); }
 
 	HandlerState TlsLayer::get_state() { return state_manager.get_state(); }
 
-	std::stringstream& TlsLayer::source() { return decrypted_input; }
+	ByteBuffer& TlsLayer::source() { return decrypted_input; }
 
-	std::stringstream& TlsLayer::sink() { return decrypted_output; }
+	OutputQueue& TlsLayer::sink() { return decrypted_output; }
 }
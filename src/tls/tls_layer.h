@@ -1,6 +1,6 @@
 #pragma once
 
-#include <sstream>
+#include <array>
 #include <memory>
 
 #include <botan/tls_server.h>
@@ -8,6 +8,8 @@
 #include "../common/types.h"
 
 using nimlib::Server::Types::StreamsProvider;
+using nimlib::Server::Utils::ByteBuffer;
+using nimlib::Server::Utils::OutputQueue;
 using nimlib::Server::Types::Handler;
 using nimlib::Server::Types::Connection;
 using nimlib::Server::Constants::HandlerState;
@@ -29,13 +31,22 @@ namespace nimlib::Server::Handlers
 
 		HandlerState get_state() override;
 
-		std::stringstream& source() override;
-		std::stringstream& sink() override;
+		ByteBuffer& source() override;
+		OutputQueue& sink() override;
+
+	private:
+		void encrypt_pending();
+		// Ends the session once the response is out, unless the connection
+		// is kept alive for another request.
+		void close_when_done();
 
 	private:
 		bool tls_continue{ true };
-		std::stringstream decrypted_input{};
-		std::stringstream decrypted_output{};
+		ByteBuffer decrypted_input{};
+		OutputQueue decrypted_output{};
+		// Where the connection takes the records to write, its fill decides
+		// how much more of a file is encrypted.
+		OutputQueue* encrypted_output{ nullptr };
 		std::unique_ptr<Botan::TLS::Server> tls_server;
 		std::shared_ptr<Handler> next;
 	};
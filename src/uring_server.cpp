@@ -0,0 +1,572 @@
+#include <algorithm>
+#include <string>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <netdb.h>
+#include <unistd.h>
+
+#include "uring_server.h"
+#include "tcp_socket.h"
+
+#ifdef NO_TESTING
+#include "common/decorators.h"
+#else
+#include "../tests/support/decorators.h"
+#endif
+
+using nimlib::Server::Sockets::TcpSocket;
+using nimlib::Server::Sockets::UringSocket;
+
+namespace nimlib::Server
+{
+	UringServer::UringServer(const std::string& port, bool reuse_port)
+		: port{ port },
+		server_socket{ nimlib::Server::Decorators::decorate(std::make_unique<TcpSocket>(port, reuse_port)) },
+		connection_pool{ nimlib::Server::TcpConnectionPool::get_pool() },
+		buffer_memory(BUFFER_COUNT * BUFFER_SIZE),
+		completions(RING_ENTRIES)
+	{
+		server_socket->tcp_bind();
+		server_socket->tcp_listen();
+
+		setup_result = io_uring_queue_init(RING_ENTRIES, &ring, 0);
+		ring_ready = setup_result == 0;
+		if (!ring_ready) return;
+
+		// All receives draw from one kernel-provided buffer ring, so no
+		// per-connection receive buffer needs to be posted in advance.
+		buffer_ring = io_uring_setup_buf_ring(&ring, BUFFER_COUNT, BUFFER_GROUP, 0, &setup_result);
+		if (!buffer_ring) return;
+
+		for (unsigned i = 0; i < BUFFER_COUNT; i++)
+		{
+			io_uring_buf_ring_add(
+				buffer_ring,
+				buffer_memory.data() + i * BUFFER_SIZE,
+				BUFFER_SIZE,
+				i,
+				io_uring_buf_ring_mask(BUFFER_COUNT),
+				i
+			);
+		}
+		io_uring_buf_ring_advance(buffer_ring, BUFFER_COUNT);
+	}
+
+	UringServer::~UringServer()
+	{
+		if (buffer_ring) io_uring_free_buf_ring(&ring, buffer_ring, BUFFER_COUNT, BUFFER_GROUP);
+		if (ring_ready) io_uring_queue_exit(&ring);
+		server_socket->tcp_close();
+	}
+
+	bool UringServer::ready() const { return ring_ready && buffer_ring; }
+
+	int UringServer::setup_error() const { return ready() ? 0 : -setup_result; }
+
+	void UringServer::run()
+	{
+		if (!ready()) return;
+
+		arm_accept();
+
+		while (true)
+		{
+			flush_sends();
+
+			// The wait ends with the first completion or at the next connection
+			// deadline, without a deadline it only ends with a completion.
+			// Connections still handling have nothing to complete, so the wait
+			// only collects what is there already while any are pending.
+			int msec_time_out = pending.empty() ? connection_pool.next_time_out() : 0;
+			__kernel_timespec timeout{ .tv_sec = msec_time_out / 1000, .tv_nsec = (msec_time_out % 1000) * 1'000'000L };
+			io_uring_cqe* cqe{};
+			io_uring_submit_and_wait_timeout(&ring, &cqe, 1, msec_time_out < 0 ? nullptr : &timeout, nullptr);
+			// Deadlines set while the completions are handled start from
+			// here, not from before the wait.
+			connection_pool.refresh_clock();
+
+			unsigned count = io_uring_peek_batch_cqe(&ring, completions.data(), completions.size());
+			for (unsigned i = 0; i < count; i++)
+			{
+				const io_uring_cqe& completion = *completions[i];
+				auto data = io_uring_cqe_get_data64(&completion);
+				auto operation = static_cast<Operation>(data >> 32);
+				int socket = static_cast<int>(data & 0xffffffff);
+
+				if (operation == Operation::ACCEPT) on_accept(completion);
+				else if (operation == Operation::RECV) on_recv(socket, completion);
+				else if (operation == Operation::SEND) on_send(socket, completion);
+			}
+			io_uring_cq_advance(&ring, count);
+
+			// Driving a timed out connection halts it, which releases its socket.
+			for (auto socket : connection_pool.time_out_connections())
+			{
+				drive(socket);
+			}
+
+			drive_pending();
+		}
+	}
+
+	void UringServer::drive_pending()
+	{
+		// drive() may push the same connection back onto the pending list,
+		// so the list being iterated is swapped out first.
+		pending_swap.clear();
+		std::swap(pending, pending_swap);
+
+		for (auto socket : pending_swap)
+		{
+			peer(socket).pending = false;
+			drive(socket);
+		}
+	}
+
+	int UringServer::receive(int socket, std::span<uint8_t> buffer)
+	{
+		auto& p = peer(socket);
+		size_t available = p.inbound.size() - p.inbound_offset;
+
+		// Bytes kept from earlier receives go before the ones just received.
+		if (available > 0)
+		{
+			size_t count = std::min(available, buffer.size());
+			std::memcpy(buffer.data(), p.inbound.data() + p.inbound_offset, count);
+			p.inbound_offset += count;
+
+			if (p.inbound_offset == p.inbound.size())
+			{
+				p.inbound.clear();
+				p.inbound_offset = 0;
+			}
+
+			return count;
+		}
+
+		if (!p.arrived.empty())
+		{
+			size_t count = std::min(p.arrived.size(), buffer.size());
+			std::memcpy(buffer.data(), p.arrived.data(), count);
+			p.arrived = p.arrived.subspan(count);
+			return count;
+		}
+
+		if (p.end_of_stream) return 0;
+		errno = EAGAIN;
+		return -1;
+	}
+
+	int UringServer::queue_send(int socket, std::string_view buffer)
+	{
+		auto& p = peer(socket);
+		if (p.closing)
+		{
+			errno = EPIPE;
+			return -1;
+		}
+
+		p.outbound.emplace_back(buffer);
+		p.outbound_bytes += buffer.size();
+
+		if (!p.flush_queued)
+		{
+			p.flush_queued = true;
+			sockets_to_flush.push_back(socket);
+		}
+
+		return buffer.size();
+	}
+
+	size_t UringServer::send_room(int socket)
+	{
+		auto& p = peer(socket);
+		return p.outbound_bytes < OUTBOUND_HIGH_WATERMARK ? OUTBOUND_HIGH_WATERMARK - p.outbound_bytes : 0;
+	}
+
+	void UringServer::release(int socket)
+	{
+		auto& p = peer(socket);
+		if (p.closing) return;
+
+		p.closing = true;
+		p.inbound.clear();
+		p.inbound_offset = 0;
+		p.arrived = {};
+
+		if (p.recv_armed)
+		{
+			auto sqe = get_sqe();
+			io_uring_prep_cancel64(sqe, tag(Operation::RECV, socket), 0);
+			io_uring_sqe_set_data64(sqe, tag(Operation::CANCEL, socket));
+		}
+
+		close_if_drained(socket);
+	}
+
+	io_uring_sqe* UringServer::get_sqe()
+	{
+		auto sqe = io_uring_get_sqe(&ring);
+		if (!sqe)
+		{
+			io_uring_submit(&ring);
+			sqe = io_uring_get_sqe(&ring);
+		}
+
+		assert(sqe);
+		return sqe;
+	}
+
+	void UringServer::arm_accept()
+	{
+		auto sqe = get_sqe();
+		io_uring_prep_multishot_accept(sqe, server_socket->get_tcp_socket_descriptor(), nullptr, nullptr, 0);
+		io_uring_sqe_set_data64(sqe, tag(Operation::ACCEPT, 0));
+	}
+
+	void UringServer::arm_recv(int socket)
+	{
+		auto sqe = get_sqe();
+		io_uring_prep_recv_multishot(sqe, socket, nullptr, 0, 0);
+		io_uring_sqe_set_flags(sqe, IOSQE_BUFFER_SELECT);
+		sqe->buf_group = BUFFER_GROUP;
+		io_uring_sqe_set_data64(sqe, tag(Operation::RECV, socket));
+		peer(socket).recv_armed = true;
+	}
+
+	void UringServer::flush_sends()
+	{
+		for (auto socket : sockets_to_flush)
+		{
+			peer(socket).flush_queued = false;
+			flush_sends(socket);
+		}
+
+		sockets_to_flush.clear();
+	}
+
+	void UringServer::flush_sends(int socket)
+	{
+		auto& p = peer(socket);
+
+		// Only one chain per peer is in flight at any time. The next chain is
+		// submitted once every send of the current one has completed.
+		if (p.sends_in_flight > 0 || p.outbound.empty()) return;
+
+		// Linked submissions must be contiguous in the submission queue, so
+		// make room for the whole chain before preparing it.
+		unsigned chain_length = std::min<size_t>(p.outbound.size(), MAX_CHAIN_LENGTH);
+		if (io_uring_sq_space_left(&ring) < chain_length) io_uring_submit(&ring);
+
+		for (unsigned i = 0; i < chain_length; i++)
+		{
+			const auto& buffer = p.outbound[i];
+			size_t offset = (i == 0) ? p.outbound_offset : 0;
+
+			auto sqe = get_sqe();
+			io_uring_prep_send(sqe, socket, buffer.data() + offset, buffer.size() - offset, MSG_NOSIGNAL | MSG_WAITALL);
+			io_uring_sqe_set_data64(sqe, tag(Operation::SEND, socket));
+			if (i + 1 < chain_length) io_uring_sqe_set_flags(sqe, IOSQE_IO_LINK);
+
+			p.sends_in_flight++;
+		}
+	}
+
+	void UringServer::close_if_drained(int socket)
+	{
+		auto& p = peer(socket);
+
+		if (!p.closing || p.recv_armed || p.sends_in_flight > 0) return;
+
+		if (!p.outbound.empty())
+		{
+			flush_sends(socket);
+		}
+		else
+		{
+			close(socket);
+			p = Peer{};
+		}
+	}
+
+	void UringServer::on_accept(const io_uring_cqe& cqe)
+	{
+		if (!(cqe.flags & IORING_CQE_F_MORE)) arm_accept();
+		if (cqe.res < 0) return;
+
+		int socket = cqe.res;
+		peer(socket) = Peer{};
+
+		auto accepted_socket = nimlib::Server::Decorators::decorate(std::make_unique<UringSocket>(socket, *this, port));
+		connection_pool.record_connection(std::move(accepted_socket));
+		arm_recv(socket);
+	}
+
+	void UringServer::on_recv(int socket, const io_uring_cqe& cqe)
+	{
+		auto& p = peer(socket);
+		if (!(cqe.flags & IORING_CQE_F_MORE)) p.recv_armed = false;
+
+		uint8_t* buffer{ nullptr };
+		unsigned short buffer_id{};
+		if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER))
+		{
+			buffer_id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+			buffer = buffer_memory.data() + buffer_id * BUFFER_SIZE;
+			if (!p.closing) p.arrived = { buffer, static_cast<size_t>(cqe.res) };
+		}
+		else if (cqe.res == 0 || (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED))
+		{
+			p.end_of_stream = true;
+		}
+
+		if (p.closing)
+		{
+			if (buffer) recycle_buffer(buffer, buffer_id);
+			close_if_drained(socket);
+			return;
+		}
+
+		// Multishot receives stop when, for example, the buffer ring runs dry.
+		if (!p.recv_armed && !p.end_of_stream) arm_recv(socket);
+
+		drive(socket);
+
+		// The connection reads the buffer in place. Whatever it has not read
+		// yet is copied out, the buffer goes back to the kernel either way so
+		// a connection that is held back does not keep the ring from others.
+		auto& driven = peer(socket);
+		if (!driven.arrived.empty())
+		{
+			driven.inbound.append(reinterpret_cast<const char*>(driven.arrived.data()), driven.arrived.size());
+			driven.arrived = {};
+		}
+		if (buffer) recycle_buffer(buffer, buffer_id);
+	}
+
+	void UringServer::recycle_buffer(uint8_t* buffer, unsigned short buffer_id)
+	{
+		io_uring_buf_ring_add(buffer_ring, buffer, BUFFER_SIZE, buffer_id, io_uring_buf_ring_mask(BUFFER_COUNT), 0);
+		io_uring_buf_ring_advance(buffer_ring, 1);
+	}
+
+	void UringServer::on_send(int socket, const io_uring_cqe& cqe)
+	{
+		auto& p = peer(socket);
+		p.sends_in_flight--;
+
+		if (cqe.res >= 0 && !p.outbound.empty())
+		{
+			size_t remaining = p.outbound.front().size() - p.outbound_offset;
+			if (static_cast<size_t>(cqe.res) >= remaining)
+			{
+				p.outbound_bytes -= remaining;
+				p.outbound.pop_front();
+				p.outbound_offset = 0;
+			}
+			else
+			{
+				// A short send breaks the chain and the rest of it completes
+				// with -ECANCELED. It is resubmitted from this offset.
+				p.outbound_bytes -= cqe.res;
+				p.outbound_offset += cqe.res;
+			}
+		}
+		else if (cqe.res < 0 && cqe.res != -ECANCELED)
+		{
+			// The peer is gone, there is no point in sending the rest.
+			p.outbound.clear();
+			p.outbound_bytes = 0;
+			p.outbound_offset = 0;
+			p.end_of_stream = true;
+		}
+
+		if (p.sends_in_flight > 0) return;
+
+		if (p.closing)
+		{
+			close_if_drained(socket);
+		}
+		else
+		{
+			flush_sends(socket);
+			drive(socket);
+		}
+	}
+
+	void UringServer::drive(int socket)
+	{
+		auto connection = connection_pool.find(socket);
+		if (!connection) return;
+		auto& p = peer(socket);
+
+		// Writes complete as soon as they are queued, so a connection is driven
+		// through as many states as it can go before the loop waits again.
+		while (!p.closing && p.outbound_bytes < OUTBOUND_HIGH_WATERMARK)
+		{
+			auto state = connection->get_state();
+			auto queued = p.outbound_bytes;
+
+			if (state == ConnectionState::READY_TO_READ && readable(p))
+			{
+				connection->notify(ServerDirective::READ_SOCKET);
+			}
+			else if (state == ConnectionState::READY_TO_WRITE)
+			{
+				connection->notify(ServerDirective::WRITE_SOCKET);
+			}
+			else if (state == ConnectionState::HANDLING
+				|| state == ConnectionState::DONE
+				|| state == ConnectionState::CONNECTION_ERROR)
+			{
+				// A connection that goes on handling, a stream or a body waiting
+				// on its callback, has no completion to be driven from, it is
+				// driven again on the next loop.
+				if (connection_pool.clean_up(socket) == ConnectionState::HANDLING)
+				{
+					if (!p.pending)
+					{
+						p.pending = true;
+						pending.push_back(socket);
+					}
+					break;
+				}
+				continue;
+			}
+			else
+			{
+				break;
+			}
+
+			// A notify that got nowhere is not repeated, the connection is
+			// driven again on its next completion.
+			if (connection->get_state() == state && p.outbound_bytes == queued) break;
+		}
+	}
+
+	UringServer::Peer& UringServer::peer(int socket)
+	{
+		assert(socket >= 0);
+		if (socket >= peers.size()) peers.resize(socket + 1);
+		return peers[socket];
+	}
+
+	bool UringServer::readable(const Peer& p)
+	{
+		return p.inbound.size() > p.inbound_offset || !p.arrived.empty() || p.end_of_stream;
+	}
+
+	uint64_t UringServer::tag(Operation operation, int socket)
+	{
+		return (static_cast<uint64_t>(operation) << 32) | static_cast<uint32_t>(socket);
+	}
+}
+
+namespace nimlib::Server::Sockets
+{
+	UringSocket::UringSocket(int tcp_socket, nimlib::Server::UringServer& server, const std::string& port)
+		: Socket{ port, tcp_socket }, server{ server }
+	{}
+
+	UringSocket::~UringSocket()
+	{
+		if (!released) server.release(tcp_socket_descriptor);
+	}
+
+	int UringSocket::tcp_bind() { return -1; }
+
+	int UringSocket::tcp_listen() { return -1; }
+
+	std::unique_ptr<Socket> UringSocket::tcp_accept() { return {}; }
+
+	void UringSocket::tcp_get_host_name(const sockaddr& socket_address, std::string& host_name)
+	{
+		// Accepting through the ring skips the name lookup, it is only done
+		// when a caller explicitly asks for it.
+		char name_buffer[NI_MAXHOST], service_buffer[NI_MAXSERV];
+		getnameinfo(
+			&socket_address,
+			sizeof(socket_address),
+			name_buffer,
+			sizeof(name_buffer),
+			service_buffer,
+			sizeof(service_buffer),
+			NI_NUMERICHOST | NI_NUMERICSERV
+		);
+		host_name = std::string(name_buffer);
+	}
+
+	int UringSocket::tcp_read(std::span<uint8_t> buffer, int flags)
+	{
+		return server.receive(tcp_socket_descriptor, buffer);
+	}
+
+	int UringSocket::tcp_send(std::span<uint8_t> buffer)
+	{
+		return server.queue_send(tcp_socket_descriptor, { reinterpret_cast<const char*>(buffer.data()), buffer.size() });
+	}
+
+	int UringSocket::tcp_send(std::string_view buffer)
+	{
+		return server.queue_send(tcp_socket_descriptor, buffer);
+	}
+
+	int UringSocket::tcp_send(std::span<const iovec> buffers, bool more)
+	{
+		// Sends are copied into the queue of the peer, the buffers are only
+		// gathered in one call.
+		int total = 0;
+		for (const auto& buffer : buffers)
+		{
+			int sent = server.queue_send(tcp_socket_descriptor, { static_cast<const char*>(buffer.iov_base), buffer.iov_len });
+			if (sent < 0) return total > 0 ? total : sent;
+			total += sent;
+		}
+
+		return total;
+	}
+
+	int UringSocket::tcp_send_file(int file_descriptor, size_t offset, size_t count)
+	{
+		// Sends go through the queue of the peer, so the file is read into
+		// memory a piece at a time, as much of it as the queue has room for.
+		// A full queue is a full socket to the connection, it writes the rest
+		// once the queue has drained.
+		size_t room = std::min(count, server.send_room(tcp_socket_descriptor));
+		if (room == 0)
+		{
+			errno = EAGAIN;
+			return -1;
+		}
+
+		size_t total = 0;
+		char buffer[64 * 1024];
+
+		while (total < room)
+		{
+			// A file that cannot be read, or ends before the part queued, is
+			// an error to the connection, not a socket to wait on.
+			auto copied = pread(file_descriptor, buffer, std::min(room - total, sizeof(buffer)), offset + total);
+			if (copied < 0 && errno == EINTR) continue;
+			if (copied == 0) errno = EIO;
+			if (copied <= 0) return total > 0 ? total : -1;
+
+			int sent = server.queue_send(tcp_socket_descriptor, { buffer, static_cast<size_t>(copied) });
+			if (sent < 0) return total > 0 ? total : sent;
+			total += sent;
+		}
+
+		return total;
+	}
+
+	void UringSocket::tcp_close()
+	{
+		if (!released) server.release(tcp_socket_descriptor);
+		released = true;
+	}
+
+	const int UringSocket::get_tcp_socket_descriptor() const { return tcp_socket_descriptor; }
+
+	const std::string& UringSocket::get_port() const { return port; }
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <liburing.h>
+
+#include "common/types.h"
+#include "tcp_connection_pool.h"
+
+namespace nimlib::Server
+{
+    using nimlib::Server::Types::Server;
+    using nimlib::Server::Types::Connection;
+    using nimlib::Server::Types::Socket;
+    using nimlib::Server::Constants::ServerDirective;
+    using nimlib::Server::Constants::ConnectionState;
+
+    class UringServer : public Server
+    {
+    public:
+        UringServer(const std::string& port, bool reuse_port = false);
+        ~UringServer();
+
+        UringServer(const UringServer&) = delete;
+        UringServer& operator=(const UringServer&) = delete;
+        UringServer(UringServer&&) noexcept = delete;
+        UringServer& operator=(UringServer&&) noexcept = delete;
+
+        // Whether the ring and its buffers could be set up. When they could
+        // not, run() returns straight away and the caller can pick another
+        // backend, setup_error() tells why.
+        bool ready() const;
+        int setup_error() const;
+
+        void run() override;
+
+        // The following are used by the sockets handed out by this server.
+        // A connection reads what the kernel received straight from the
+        // buffer ring while it is driven on the completion, only what it
+        // leaves there is kept per peer, so the buffer can go back to the
+        // kernel. Bytes written by the connection are copied into a queue
+        // until the next submission, as the connection lets go of them as
+        // soon as the call returns.
+        int receive(int socket, std::span<uint8_t> buffer);
+        int queue_send(int socket, std::string_view buffer);
+        // How many more bytes can be queued before the connection is held
+        // back until the peer has taken some of them.
+        size_t send_room(int socket);
+        void release(int socket);
+
+    private:
+        enum Operation : uint64_t { ACCEPT, RECV, SEND, CANCEL };
+
+        struct Peer
+        {
+            std::string inbound{};
+            size_t inbound_offset{};
+            // Bytes of the buffer just received into, read from in place
+            // while the connection is driven on its completion.
+            std::span<const uint8_t> arrived{};
+            std::deque<std::string> outbound{};
+            size_t outbound_offset{};
+            size_t outbound_bytes{};
+            int sends_in_flight{};
+            bool recv_armed{ false };
+            bool end_of_stream{ false };
+            bool closing{ false };
+            bool flush_queued{ false };
+            bool pending{ false };
+        };
+
+        io_uring_sqe* get_sqe();
+        void arm_accept();
+        void arm_recv(int socket);
+        void flush_sends();
+        void flush_sends(int socket);
+        void close_if_drained(int socket);
+
+        void on_accept(const io_uring_cqe&);
+        void on_recv(int socket, const io_uring_cqe&);
+        void on_send(int socket, const io_uring_cqe&);
+        void recycle_buffer(uint8_t* buffer, unsigned short buffer_id);
+
+        void drive(int socket);
+        void drive_pending();
+        Peer& peer(int socket);
+        static bool readable(const Peer& p);
+
+        static uint64_t tag(Operation operation, int socket);
+
+    private:
+        const std::string& port;
+        std::unique_ptr<Socket> server_socket;
+        TcpConnectionPool& connection_pool;
+        io_uring ring{};
+        bool ring_ready{ false };
+        int setup_result{};
+        io_uring_buf_ring* buffer_ring{ nullptr };
+        std::vector<uint8_t> buffer_memory{};
+        std::vector<Peer> peers{};
+        std::vector<int> sockets_to_flush{};
+        // Connections left handling with nothing to wait for, they are driven
+        // again on the next loop.
+        std::vector<int> pending{};
+        std::vector<int> pending_swap{};
+        std::vector<io_uring_cqe*> completions{};
+
+        static const unsigned RING_ENTRIES{ 1024 };
+        static const unsigned BUFFER_COUNT{ 1024 };
+        static const unsigned BUFFER_SIZE{ 4096 };
+        static const int BUFFER_GROUP{ 0 };
+        static const unsigned MAX_CHAIN_LENGTH{ 64 };
+        // A connection is not driven any further while more than this many
+        // bytes are still waiting to be sent to its peer.
+        static const size_t OUTBOUND_HIGH_WATERMARK{ 1024 * 1024 };
+    };
+};
+
+namespace nimlib::Server::Sockets
+{
+    using nimlib::Server::Types::Socket;
+
+    // Accepted socket whose I/O is carried out by an UringServer. Reads are
+    // served from bytes the kernel has already placed into the buffer ring
+    // and sends are queued as linked submissions, so none of the calls below
+    // results in a system call of its own.
+    struct UringSocket : public Socket
+    {
+        UringSocket(int tcp_socket, nimlib::Server::UringServer& server, const std::string& port = "");
+        ~UringSocket();
+
+        UringSocket(const UringSocket&) = delete;
+        UringSocket& operator=(const UringSocket&) = delete;
+        UringSocket(UringSocket&&) noexcept = delete;
+        UringSocket& operator=(UringSocket&&) noexcept = delete;
+
+        int tcp_bind() override;
+        int tcp_listen() override;
+        std::unique_ptr<Socket> tcp_accept() override;
+        void tcp_get_host_name(const sockaddr& socket_address, std::string& host_name) override;
+        int tcp_read(std::span<uint8_t> buffer, int flags) override;
+        int tcp_send(std::span<uint8_t> buffer) override;
+        int tcp_send(std::string_view buffer) override;
+        int tcp_send(std::span<const iovec> buffers, bool more) override;
+        int tcp_send_file(int file_descriptor, size_t offset, size_t count) override;
+        void tcp_close() override;
+        const int get_tcp_socket_descriptor() const override;
+        const std::string& get_port() const override;
+
+    private:
+        nimlib::Server::UringServer& server;
+        bool released{ false };
+    };
+};
@@ -0,0 +1,45 @@
+#include "arena.h"
+
+namespace nimlib::Server::Utils
+{
+    Arena::Arena(size_t block_size) : block_size{ block_size } {}
+
+    void Arena::reset()
+    {
+        if (blocks) blocks->release();
+        used_bytes = 0;
+    }
+
+    size_t Arena::used() const { return used_bytes; }
+
+    size_t Arena::heap_blocks() const { return heap.blocks + (first_block ? 1 : 0); }
+
+    void* Arena::do_allocate(size_t bytes, size_t alignment)
+    {
+        if (!blocks)
+        {
+            first_block = std::make_unique_for_overwrite<std::byte[]>(block_size);
+            blocks.emplace(first_block.get(), block_size, &heap);
+        }
+
+        used_bytes += bytes;
+        return blocks->allocate(bytes, alignment);
+    }
+
+    void Arena::do_deallocate(void*, size_t, size_t) {}
+
+    bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept { return this == &other; }
+
+    void* Arena::Heap::do_allocate(size_t bytes, size_t alignment)
+    {
+        blocks++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void Arena::Heap::do_deallocate(void* p, size_t bytes, size_t alignment)
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool Arena::Heap::do_is_equal(const std::pmr::memory_resource& other) const noexcept { return this == &other; }
+};
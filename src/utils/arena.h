@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+namespace nimlib::Server::Utils
+{
+    // Memory for everything a connection builds while answering one request,
+    // handed out from a block it keeps and given back all at once by reset()
+    // once the response is written. Freeing anything before that does
+    // nothing.
+    //
+    // The block is allocated the first time memory is asked for, a
+    // connection that never gets a request does not take one. When a request
+    // needs more than the block holds, more blocks are taken from the heap
+    // until the next reset(), which gives them back.
+    class Arena : public std::pmr::memory_resource
+    {
+    public:
+        static constexpr size_t DEFAULT_BLOCK_SIZE = 4 * 1024;
+
+        explicit Arena(size_t block_size = DEFAULT_BLOCK_SIZE);
+        ~Arena() override = default;
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+        Arena(Arena&&) noexcept = delete;
+        Arena& operator=(Arena&&) noexcept = delete;
+
+        // Frees everything allocated since the last reset, keeping the first
+        // block for what comes next.
+        void reset();
+
+        // Bytes handed out since the last reset.
+        size_t used() const;
+        // Blocks taken from the heap since the arena was created, the first
+        // one included.
+        size_t heap_blocks() const;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        // Where blocks past the first one come from, counting them.
+        class Heap : public std::pmr::memory_resource
+        {
+        public:
+            size_t blocks{};
+
+        private:
+            void* do_allocate(size_t bytes, size_t alignment) override;
+            void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+        };
+
+    private:
+        size_t block_size;
+        size_t used_bytes{};
+        Heap heap{};
+        std::unique_ptr<std::byte[]> first_block{};
+        std::optional<std::pmr::monotonic_buffer_resource> blocks{};
+    };
+};
@@ -0,0 +1,72 @@
+#include "byte_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace nimlib::Server::Utils
+{
+    ByteBuffer::ByteBuffer(size_t initial_capacity)
+    {
+        if (initial_capacity > 0)
+        {
+            storage = std::make_unique_for_overwrite<uint8_t[]>(initial_capacity);
+            storage_size = initial_capacity;
+        }
+    }
+
+    std::string_view ByteBuffer::readable() const
+    {
+        return { reinterpret_cast<const char*>(storage.get()) + begin, end - begin };
+    }
+
+    size_t ByteBuffer::size() const { return end - begin; }
+
+    bool ByteBuffer::empty() const { return begin == end; }
+
+    void ByteBuffer::consume(size_t count)
+    {
+        begin += std::min(count, size());
+
+        // Once everything has been read the next bytes go to the front, no
+        // bytes need to be moved for it.
+        if (begin == end) begin = end = 0;
+    }
+
+    std::span<uint8_t> ByteBuffer::writable(size_t min_size)
+    {
+        if (storage_size - end >= min_size) return { storage.get() + end, storage_size - end };
+
+        size_t unread = size();
+        if (unread + min_size <= storage_size)
+        {
+            std::memmove(storage.get(), storage.get() + begin, unread);
+        }
+        else
+        {
+            size_t grown = std::max(storage_size * 2, unread + min_size);
+            auto bigger = std::make_unique_for_overwrite<uint8_t[]>(grown);
+            if (unread > 0) std::memcpy(bigger.get(), storage.get() + begin, unread);
+            storage = std::move(bigger);
+            storage_size = grown;
+        }
+
+        begin = 0;
+        end = unread;
+        return { storage.get() + end, storage_size - end };
+    }
+
+    void ByteBuffer::commit(size_t count) { end = std::min(end + count, storage_size); }
+
+    void ByteBuffer::append(std::string_view bytes)
+    {
+        if (bytes.empty()) return;
+
+        auto space = writable(bytes.size());
+        std::memcpy(space.data(), bytes.data(), bytes.size());
+        commit(bytes.size());
+    }
+
+    void ByteBuffer::clear() { begin = end = 0; }
+
+    size_t ByteBuffer::capacity() const { return storage_size; }
+};
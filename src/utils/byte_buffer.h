@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace nimlib::Server::Utils
+{
+    // Bytes received on a connection and not read yet. Sockets read straight
+    // into the free space after them and readers get them as one contiguous
+    // view, which the HTTP parser needs to parse a request head in place.
+    //
+    // Reading only moves the start of the unread bytes. Space is made for
+    // more by moving the unread bytes back to the front of the storage, which
+    // costs nothing once everything has been read, and only when that is not
+    // enough is the storage grown. A connection reading requests of about the
+    // same size allocates once, for its first one.
+    class ByteBuffer
+    {
+    public:
+        explicit ByteBuffer(size_t initial_capacity = 0);
+        ~ByteBuffer() = default;
+
+        ByteBuffer(const ByteBuffer&) = delete;
+        ByteBuffer& operator=(const ByteBuffer&) = delete;
+        ByteBuffer(ByteBuffer&&) noexcept = default;
+        ByteBuffer& operator=(ByteBuffer&&) noexcept = default;
+
+        // The unread bytes. Valid until the buffer is next written to.
+        std::string_view readable() const;
+        size_t size() const;
+        bool empty() const;
+        // Marks the first `count` unread bytes as read.
+        void consume(size_t count);
+
+        // At least `min_size` bytes of free space right after the unread
+        // bytes. Bytes written there become readable with commit().
+        std::span<uint8_t> writable(size_t min_size);
+        void commit(size_t count);
+        void append(std::string_view bytes);
+
+        // Drops every byte, keeping the storage for the next ones.
+        void clear();
+        size_t capacity() const;
+
+    private:
+        std::unique_ptr<uint8_t[]> storage{};
+        size_t storage_size{};
+        size_t begin{};
+        size_t end{};
+    };
+};
@@ -0,0 +1,152 @@
+#include "compression.h"
+
+#include "open_file.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef NIMLIB_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+namespace nimlib::Server::Utils
+{
+    bool compressible_type(std::string_view content_type)
+    {
+        // Parameters such as the charset do not matter.
+        content_type = content_type.substr(0, content_type.find(';'));
+        while (!content_type.empty() && content_type.back() == ' ') content_type.remove_suffix(1);
+
+        return content_type.starts_with("text/")
+            || content_type == "application/javascript"
+            || content_type == "application/json"
+            || content_type == "application/xml"
+            || content_type == "image/svg+xml";
+    }
+
+#ifdef NIMLIB_WITH_ZLIB
+    // Files are compressed once, ahead of serving them, the best ratio is
+    // worth the time.
+    static constexpr int GZIP_LEVEL = 9;
+    // Window bits for a gzip wrapper rather than a zlib one.
+    static constexpr int GZIP_WINDOW_BITS = 15 + 16;
+
+    bool gzip_available() { return true; }
+
+    struct GzipStream::State
+    {
+        z_stream stream{};
+        bool ready{};
+    };
+
+    GzipStream::GzipStream(int level) : state{ std::make_unique<State>() }, compression_level{ level }
+    {
+        state->ready = deflateInit2(&state->stream, level, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+
+    GzipStream::~GzipStream()
+    {
+        if (state->ready) deflateEnd(&state->stream);
+    }
+
+    // Runs deflate over all of `input`, growing `output` for as long as it
+    // fills it.
+    static bool deflate_into(z_stream& stream, std::string_view input, std::string& output, int flush)
+    {
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        stream.avail_in = input.size();
+
+        while (true)
+        {
+            auto used = output.size();
+            size_t room = std::max<size_t>(deflateBound(&stream, stream.avail_in), 64);
+            output.resize(used + room);
+            stream.next_out = reinterpret_cast<Bytef*>(output.data() + used);
+            stream.avail_out = room;
+
+            auto result = deflate(&stream, flush);
+            output.resize(used + room - stream.avail_out);
+
+            if (result == Z_STREAM_END) return true;
+            // Nothing to do, eg. a flush with no input since the last one.
+            if (result == Z_BUF_ERROR && flush != Z_FINISH && stream.avail_in == 0) return true;
+            if (result != Z_OK) return false;
+            // Room left over means deflate had nothing more to write.
+            if (flush != Z_FINISH && stream.avail_in == 0 && stream.avail_out > 0) return true;
+        }
+    }
+
+    bool GzipStream::write(std::string_view input, std::string& output, bool flush)
+    {
+        return state->ready && deflate_into(state->stream, input, output, flush ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+    }
+
+    bool GzipStream::finish(std::string_view input, std::string& output)
+    {
+        // Reset rather than ended, the next stream reuses the memory.
+        return state->ready
+            && deflate_into(state->stream, input, output, Z_FINISH)
+            && deflateReset(&state->stream) == Z_OK;
+    }
+
+    bool gzip_file(const std::string& source, const std::string& destination)
+    {
+        auto file = OpenFile::open(source);
+        if (!file) return false;
+
+        std::string contents(file->size(), '\0');
+        for (size_t at = 0; at < contents.size();)
+        {
+            auto copied = file->read(at, contents.data() + at, contents.size() - at);
+            if (copied == 0) return false;
+            at += copied;
+        }
+
+        std::string compressed{};
+        if (!GzipStream{ GZIP_LEVEL }.finish(contents, compressed)) return false;
+
+        // Written beside the destination and renamed over it, a rename in
+        // the same directory is atomic.
+        std::string temporary{ destination + ".XXXXXX" };
+        int file_descriptor = mkstemp(temporary.data());
+        if (file_descriptor < 0) return false;
+
+        bool written = true;
+        for (size_t at = 0; written && at < compressed.size();)
+        {
+            auto count = ::write(file_descriptor, compressed.data() + at, compressed.size() - at);
+            written = count > 0;
+            if (written) at += count;
+        }
+        fchmod(file_descriptor, 0644);
+        ::close(file_descriptor);
+
+        if (!written || std::rename(temporary.c_str(), destination.c_str()) != 0)
+        {
+            unlink(temporary.c_str());
+            return false;
+        }
+
+        return true;
+    }
+#else
+    bool gzip_available() { return false; }
+
+    struct GzipStream::State {};
+
+    GzipStream::GzipStream(int level) : compression_level{ level } {}
+
+    GzipStream::~GzipStream() = default;
+
+    bool GzipStream::write(std::string_view, std::string&, bool) { return false; }
+
+    bool GzipStream::finish(std::string_view, std::string&) { return false; }
+
+    bool gzip_file(const std::string&, const std::string&) { return false; }
+#endif
+
+    int GzipStream::level() const { return compression_level; }
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace nimlib::Server::Utils
+{
+    // Whether the server was built with zlib, and can compress with gzip.
+    bool gzip_available();
+
+    // Whether content of this type gets smaller compressed, text mostly.
+    // Images, video and archives are compressed already.
+    bool compressible_type(std::string_view content_type);
+
+    // Writes `source` compressed with gzip to `destination`, replacing it
+    // at once rather than leaving a partly written file for a reader to
+    // find. Returns false when it can not, eg. for lack of zlib or of
+    // permission to write next to the source.
+    bool gzip_file(const std::string& source, const std::string& destination);
+
+    // Compresses a body with gzip a piece at a time, as it is produced.
+    // Only usable when gzip_available(), writing fails otherwise.
+    class GzipStream
+    {
+    public:
+        // From 1, fastest, to 9, smallest.
+        explicit GzipStream(int level);
+        ~GzipStream();
+
+        GzipStream(const GzipStream&) = delete;
+        GzipStream& operator=(const GzipStream&) = delete;
+        GzipStream(GzipStream&&) = delete;
+        GzipStream& operator=(GzipStream&&) = delete;
+
+        // Compresses `input`, appending to `output` whatever is ready. With
+        // `flush`, all the input so far can be decompressed from the output,
+        // at some cost to the ratio.
+        bool write(std::string_view input, std::string& output, bool flush = false);
+        // Compresses the last of the input and ends the stream. The next
+        // write starts a new one.
+        bool finish(std::string_view input, std::string& output);
+        int level() const;
+
+    private:
+        struct State;
+        std::unique_ptr<State> state;
+        int compression_level;
+    };
+};
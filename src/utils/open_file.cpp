@@ -0,0 +1,46 @@
+#include "open_file.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nimlib::Server::Utils
+{
+    std::shared_ptr<const OpenFile> OpenFile::open(const std::string& path)
+    {
+        int file_descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file_descriptor < 0) return nullptr;
+
+        struct stat status{};
+        if (fstat(file_descriptor, &status) < 0 || !S_ISREG(status.st_mode))
+        {
+            ::close(file_descriptor);
+            return nullptr;
+        }
+
+#ifdef __APPLE__
+        const timespec& modified = status.st_mtimespec;
+#else
+        const timespec& modified = status.st_mtim;
+#endif
+        return std::shared_ptr<const OpenFile>(new OpenFile(file_descriptor, status.st_size, modified));
+    }
+
+    OpenFile::OpenFile(int file_descriptor, size_t file_size, const timespec& file_modified)
+        : file_descriptor{ file_descriptor }, file_size{ file_size }, file_modified{ file_modified }
+    {}
+
+    OpenFile::~OpenFile() { ::close(file_descriptor); }
+
+    int OpenFile::descriptor() const { return file_descriptor; }
+
+    size_t OpenFile::size() const { return file_size; }
+
+    const timespec& OpenFile::modified() const { return file_modified; }
+
+    size_t OpenFile::read(size_t offset, char* out, size_t count) const
+    {
+        auto copied = ::pread(file_descriptor, out, count, offset);
+        return copied < 0 ? 0 : copied;
+    }
+};
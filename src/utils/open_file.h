@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <ctime>
+
+namespace nimlib::Server::Utils
+{
+    // A regular file open for reading, closed once the last response using
+    // it has been written. Responses hand these to the output queue so the
+    // file goes from disk to the socket without being read by the server.
+    class OpenFile
+    {
+    public:
+        // Null when the file can not be opened or is not a regular file.
+        static std::shared_ptr<const OpenFile> open(const std::string& path);
+        ~OpenFile();
+
+        OpenFile(const OpenFile&) = delete;
+        OpenFile& operator=(const OpenFile&) = delete;
+        OpenFile(OpenFile&&) noexcept = delete;
+        OpenFile& operator=(OpenFile&&) noexcept = delete;
+
+        int descriptor() const;
+        size_t size() const;
+        // When the file was last modified, as it was when opened.
+        const timespec& modified() const;
+        // Copies up to `count` bytes from `offset` into `out`, for when the
+        // bytes have to go through memory after all, eg. to be encrypted.
+        size_t read(size_t offset, char* out, size_t count) const;
+
+    private:
+        OpenFile(int file_descriptor, size_t file_size, const timespec& file_modified);
+
+    private:
+        int file_descriptor;
+        size_t file_size;
+        timespec file_modified;
+    };
+};
@@ -0,0 +1,154 @@
+#include "output_queue.h"
+
+#include <algorithm>
+
+namespace nimlib::Server::Utils
+{
+    OutputQueue::OutputQueue(size_t high_watermark) : high_watermark{ high_watermark } {}
+
+    void OutputQueue::append(std::string_view bytes)
+    {
+        if (bytes.empty()) return;
+
+        // Bytes copied right after the ones of the last slice extend it.
+        if (head < slices.size())
+        {
+            auto& last = slices.back();
+            if (!last.shared && !last.file && last.offset + last.size == storage.size())
+            {
+                storage.append(bytes);
+                last.size += bytes.size();
+                pending += bytes.size();
+                return;
+            }
+        }
+
+        slices.push_back({ nullptr, nullptr, storage.size(), bytes.size() });
+        storage.append(bytes);
+        pending += bytes.size();
+    }
+
+    void OutputQueue::append(std::string&& bytes)
+    {
+        if (bytes.size() < COPY_BELOW) return append(std::string_view{ bytes });
+        append(std::make_shared<const std::string>(std::move(bytes)));
+    }
+
+    void OutputQueue::append(std::shared_ptr<const std::string> bytes, size_t offset, size_t count)
+    {
+        if (!bytes || offset >= bytes->size()) return;
+
+        count = std::min(count, bytes->size() - offset);
+        if (count == 0) return;
+
+        slices.push_back({ std::move(bytes), nullptr, offset, count });
+        pending += count;
+    }
+
+    void OutputQueue::append(std::shared_ptr<const OpenFile> file, size_t offset, size_t count)
+    {
+        if (!file || offset >= file->size()) return;
+
+        count = std::min(count, file->size() - offset);
+        if (count == 0) return;
+
+        slices.push_back({ nullptr, std::move(file), offset, count });
+        pending += count;
+    }
+
+    OutputQueue& OutputQueue::operator<<(std::string_view bytes)
+    {
+        append(bytes);
+        return *this;
+    }
+
+    size_t OutputQueue::size() const { return pending; }
+
+    bool OutputQueue::empty() const { return pending == 0; }
+
+    bool OutputQueue::over_high_watermark() const { return pending > high_watermark; }
+
+    void OutputQueue::set_high_watermark(size_t bytes) { high_watermark = bytes; }
+
+    const char* OutputQueue::data(const Slice& slice) const
+    {
+        return (slice.shared ? slice.shared->data() : storage.data()) + slice.offset;
+    }
+
+    size_t OutputQueue::gather(std::span<iovec> buffers) const
+    {
+        size_t used = 0;
+
+        for (size_t i = head; i < slices.size() && used < buffers.size() && !slices[i].file; i++, used++)
+        {
+            buffers[used].iov_base = const_cast<char*>(data(slices[i]));
+            buffers[used].iov_len = slices[i].size;
+        }
+
+        return used;
+    }
+
+    std::optional<OutputQueue::FileRange> OutputQueue::front_file() const
+    {
+        if (head == slices.size() || !slices[head].file) return std::nullopt;
+
+        const auto& slice = slices[head];
+        return FileRange{ slice.file.get(), slice.offset, slice.size };
+    }
+
+    void OutputQueue::consume(size_t count)
+    {
+        count = std::min(count, pending);
+        pending -= count;
+
+        while (count > 0)
+        {
+            auto& slice = slices[head];
+            auto written = std::min(count, slice.size);
+
+            slice.offset += written;
+            slice.size -= written;
+            count -= written;
+
+            if (slice.size == 0)
+            {
+                // The shared bytes are let go as soon as they are written.
+                slice.shared.reset();
+                slice.file.reset();
+                head++;
+            }
+        }
+
+        if (pending == 0) clear();
+    }
+
+    void OutputQueue::clear()
+    {
+        slices.clear();
+        head = 0;
+        pending = 0;
+        storage.clear();
+    }
+
+    std::string OutputQueue::str() const
+    {
+        std::string bytes{};
+        bytes.reserve(pending);
+
+        for (size_t i = head; i < slices.size(); i++)
+        {
+            const auto& slice = slices[i];
+            if (!slice.file)
+            {
+                bytes.append(data(slice), slice.size);
+                continue;
+            }
+
+            auto at = bytes.size();
+            bytes.resize(at + slice.size);
+            bytes.resize(at + slice.file->read(slice.offset, bytes.data() + at, slice.size));
+        }
+
+        return bytes;
+    }
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <vector>
+#include <sys/uio.h>
+
+#include "open_file.h"
+
+namespace nimlib::Server::Utils
+{
+    // Bytes a connection is to write, kept as a list of slices written out
+    // together with writev(2).
+    //
+    // A slice either shares a string with whoever produced it, such as a
+    // response body or a cached file, which it keeps alive until written, or
+    // refers to bytes copied into the queue's own storage. Small pieces, like
+    // a status line and headers, are copied and joined with the bytes before
+    // them so that a response does not turn into many tiny slices. A slice
+    // can also be part of an open file, which is written with sendfile(2)
+    // straight from the file rather than gathered.
+    //
+    // A partial write only moves the start of the first slice, nothing is
+    // copied to keep what is left.
+    class OutputQueue
+    {
+    public:
+        // Strings shorter than this are copied rather than kept as a slice.
+        static constexpr size_t COPY_BELOW = 4 * 1024;
+        static constexpr size_t DEFAULT_HIGH_WATERMARK = 256 * 1024;
+
+        explicit OutputQueue(size_t high_watermark = DEFAULT_HIGH_WATERMARK);
+        ~OutputQueue() = default;
+
+        OutputQueue(const OutputQueue&) = delete;
+        OutputQueue& operator=(const OutputQueue&) = delete;
+        OutputQueue(OutputQueue&&) noexcept = default;
+        OutputQueue& operator=(OutputQueue&&) noexcept = default;
+
+        void append(std::string_view bytes);
+        void append(std::string&& bytes);
+        // Writes `count` bytes of `bytes` from `offset` without copying them.
+        void append(std::shared_ptr<const std::string> bytes, size_t offset = 0, size_t count = std::string::npos);
+        // Writes `count` bytes of `file` from `offset`, without reading them.
+        void append(std::shared_ptr<const OpenFile> file, size_t offset, size_t count);
+        OutputQueue& operator<<(std::string_view bytes);
+
+        // Bytes not written yet.
+        size_t size() const;
+        bool empty() const;
+
+        // Set once more than the high watermark is waiting to be written.
+        // Handlers producing output piece by piece, or answering several
+        // requests in a row, should hold back until the queue is written.
+        bool over_high_watermark() const;
+        void set_high_watermark(size_t bytes);
+
+        struct FileRange
+        {
+            const OpenFile* file;
+            size_t offset;
+            size_t size;
+        };
+
+        // Fills `buffers` with the bytes not written yet, in order, and
+        // returns how many of them were used. Gathering stops at a file,
+        // which is written on its own once it is first, see front_file().
+        // Valid until the queue changes.
+        size_t gather(std::span<iovec> buffers) const;
+        // The file the next bytes come from, if they do.
+        std::optional<FileRange> front_file() const;
+        // Marks the first `count` bytes as written.
+        void consume(size_t count);
+        void clear();
+
+        // Copy of the bytes not written yet, read from files where needed.
+        std::string str() const;
+
+    private:
+        struct Slice
+        {
+            // Both null for bytes in the queue's own storage.
+            std::shared_ptr<const std::string> shared;
+            std::shared_ptr<const OpenFile> file;
+            size_t offset;
+            size_t size;
+        };
+
+        const char* data(const Slice& slice) const;
+
+    private:
+        std::vector<Slice> slices{};
+        // First slice not written yet, the ones before it are dropped once
+        // everything has been written.
+        size_t head{ 0 };
+        size_t pending{ 0 };
+        // Handlers only add to a queue that has been written out in full, so
+        // the copied bytes do not pile up between writes.
+        std::string storage{};
+        size_t high_watermark;
+    };
+};
@@ -0,0 +1,328 @@
+#include "scan.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define NIMLIB_SCAN_X86
+#endif
+
+// The scalar and SSE2 kernels are also what the AVX2 kernels finish with,
+// once there are less than 32 bytes left. Inlined there, they are compiled
+// with the same VEX encoding as the rest of the AVX2 kernel, calling them
+// instead would mix in legacy SSE code with the upper halves of the AVX
+// registers in use, which stalls on many x86 CPUs.
+#define NIMLIB_SCAN_INLINE inline __attribute__((always_inline))
+
+namespace nimlib::Server::Utils::Scan
+{
+    namespace
+    {
+        // Every kernel returns `size` when it finds nothing.
+        struct Kernels
+        {
+            Level level;
+            size_t (*find_line_end)(const char* s, size_t size);
+            size_t (*find_char)(const char* s, size_t size, char c);
+            void (*to_lower)(const char* s, size_t size, char* out);
+            bool (*is_token)(const char* s, size_t size);
+        };
+
+        constexpr std::array<bool, 256> token_table = []()
+            {
+                std::array<bool, 256> table{};
+                for (int c = '0'; c <= '9'; c++) table[c] = true;
+                for (int c = 'a'; c <= 'z'; c++) table[c] = true;
+                for (int c = 'A'; c <= 'Z'; c++) table[c] = true;
+                for (char c : std::string_view{ "!#$%&'*+-.^_`|~" }) table[static_cast<unsigned char>(c)] = true;
+                return table;
+            }();
+
+        NIMLIB_SCAN_INLINE size_t find_line_end_scalar(const char* s, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                if (s[i] == '\r' || s[i] == '\n') return i;
+            }
+
+            return size;
+        }
+
+        NIMLIB_SCAN_INLINE size_t find_char_scalar(const char* s, size_t size, char c)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                if (s[i] == c) return i;
+            }
+
+            return size;
+        }
+
+        NIMLIB_SCAN_INLINE void to_lower_scalar(const char* s, size_t size, char* out)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                char c = s[i];
+                out[i] = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+            }
+        }
+
+        NIMLIB_SCAN_INLINE bool is_token_scalar(const char* s, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                if (!token_table[static_cast<unsigned char>(s[i])]) return false;
+            }
+
+            return true;
+        }
+
+        constexpr Kernels scalar_kernels{ Level::SCALAR, find_line_end_scalar, find_char_scalar, to_lower_scalar, is_token_scalar };
+
+#ifdef NIMLIB_SCAN_X86
+        // SSE2 is part of x86-64, these run on any CPU the server runs on.
+
+        NIMLIB_SCAN_INLINE __m128i load_16(const char* s) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)); }
+
+        // Bytes no further than `range` past `low`, as an all ones byte each.
+        NIMLIB_SCAN_INLINE __m128i in_range_16(__m128i block, char low, char range)
+        {
+            __m128i offset = _mm_sub_epi8(block, _mm_set1_epi8(low));
+            return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(range)), offset);
+        }
+
+        NIMLIB_SCAN_INLINE size_t find_line_end_sse2(const char* s, size_t size)
+        {
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m128i block = load_16(s + i);
+                __m128i found = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+                if (unsigned mask = _mm_movemask_epi8(found)) return i + std::countr_zero(mask);
+            }
+
+            return i + find_line_end_scalar(s + i, size - i);
+        }
+
+        NIMLIB_SCAN_INLINE size_t find_char_sse2(const char* s, size_t size, char c)
+        {
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m128i found = _mm_cmpeq_epi8(load_16(s + i), _mm_set1_epi8(c));
+                if (unsigned mask = _mm_movemask_epi8(found)) return i + std::countr_zero(mask);
+            }
+
+            return i + find_char_scalar(s + i, size - i, c);
+        }
+
+        NIMLIB_SCAN_INLINE void to_lower_sse2(const char* s, size_t size, char* out)
+        {
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m128i block = load_16(s + i);
+                __m128i upper = in_range_16(block, 'A', 25);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(block, _mm_and_si128(upper, _mm_set1_epi8(0x20))));
+            }
+
+            to_lower_scalar(s + i, size - i, out + i);
+        }
+
+        NIMLIB_SCAN_INLINE bool is_token_sse2(const char* s, size_t size)
+        {
+            // Without a byte shuffle there is no cheap lookup of the whole
+            // token set. Header names are mostly letters, digits and dashes,
+            // blocks of only those pass here, others are checked byte by byte.
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m128i block = load_16(s + i);
+                __m128i letter = in_range_16(_mm_or_si128(block, _mm_set1_epi8(0x20)), 'a', 25);
+                __m128i digit = in_range_16(block, '0', 9);
+                __m128i dash = _mm_cmpeq_epi8(block, _mm_set1_epi8('-'));
+                unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letter, digit), dash));
+
+                if (mask != 0xffff && !is_token_scalar(s + i, 16)) return false;
+            }
+
+            return is_token_scalar(s + i, size - i);
+        }
+
+        constexpr Kernels sse2_kernels{ Level::SSE2, find_line_end_sse2, find_char_sse2, to_lower_sse2, is_token_sse2 };
+
+        // Token bytes by their low nibble, a bit set for every high nibble
+        // making a token byte with it. Bytes from 0x80 up are never tokens.
+        constexpr std::array<uint8_t, 16> token_low_nibbles = []()
+            {
+                std::array<uint8_t, 16> nibbles{};
+                for (int high = 0; high < 8; high++)
+                {
+                    for (int low = 0; low < 16; low++)
+                    {
+                        if (token_table[high << 4 | low]) nibbles[low] |= 1 << high;
+                    }
+                }
+                return nibbles;
+            }();
+
+        constexpr std::array<uint8_t, 16> token_high_nibbles{ 1, 2, 4, 8, 16, 32, 64, 128 };
+
+        __attribute__((target("avx2"))) __m256i load_32(const char* s)
+        {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+        }
+
+        __attribute__((target("avx2"))) size_t find_line_end_avx2(const char* s, size_t size)
+        {
+            size_t i = 0;
+            for (; i + 32 <= size; i += 32)
+            {
+                __m256i block = load_32(s + i);
+                __m256i found = _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')));
+                if (unsigned mask = _mm256_movemask_epi8(found)) return i + std::countr_zero(mask);
+            }
+
+            return i + find_line_end_sse2(s + i, size - i);
+        }
+
+        __attribute__((target("avx2"))) size_t find_char_avx2(const char* s, size_t size, char c)
+        {
+            size_t i = 0;
+            for (; i + 32 <= size; i += 32)
+            {
+                __m256i found = _mm256_cmpeq_epi8(load_32(s + i), _mm256_set1_epi8(c));
+                if (unsigned mask = _mm256_movemask_epi8(found)) return i + std::countr_zero(mask);
+            }
+
+            return i + find_char_sse2(s + i, size - i, c);
+        }
+
+        __attribute__((target("avx2"))) void to_lower_avx2(const char* s, size_t size, char* out)
+        {
+            size_t i = 0;
+            for (; i + 32 <= size; i += 32)
+            {
+                __m256i block = load_32(s + i);
+                __m256i offset = _mm256_sub_epi8(block, _mm256_set1_epi8('A'));
+                __m256i upper = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(25)), offset);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_or_si256(block, _mm256_and_si256(upper, _mm256_set1_epi8(0x20))));
+            }
+
+            to_lower_sse2(s + i, size - i, out + i);
+        }
+
+        __attribute__((target("avx2"))) bool is_token_avx2(const char* s, size_t size)
+        {
+            const __m256i low_nibbles = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(token_low_nibbles.data())));
+            const __m256i high_nibbles = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(token_high_nibbles.data())));
+            const __m256i nibble = _mm256_set1_epi8(0x0f);
+
+            size_t i = 0;
+            for (; i + 32 <= size; i += 32)
+            {
+                __m256i block = load_32(s + i);
+                __m256i low = _mm256_and_si256(block, nibble);
+                __m256i high = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble);
+                __m256i bits = _mm256_and_si256(_mm256_shuffle_epi8(low_nibbles, low), _mm256_shuffle_epi8(high_nibbles, high));
+
+                if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(bits, _mm256_setzero_si256()))) return false;
+            }
+
+            return is_token_sse2(s + i, size - i);
+        }
+
+        constexpr Kernels avx2_kernels{ Level::AVX2, find_line_end_avx2, find_char_avx2, to_lower_avx2, is_token_avx2 };
+#endif
+
+        bool supported(Level level)
+        {
+            switch (level)
+            {
+#ifdef NIMLIB_SCAN_X86
+            case Level::AVX2:
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2");
+            case Level::SSE2:
+                return true;
+#endif
+            case Level::SCALAR:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        const Kernels* kernels_for(Level level)
+        {
+#ifdef NIMLIB_SCAN_X86
+            if (level == Level::AVX2) return &avx2_kernels;
+            if (level == Level::SSE2) return &sse2_kernels;
+#endif
+            return &scalar_kernels;
+        }
+
+        std::atomic<const Kernels*> active_kernels{ nullptr };
+
+        const Kernels& kernels()
+        {
+            auto active = active_kernels.load(std::memory_order_relaxed);
+            if (!active)
+            {
+                active = kernels_for(best_level());
+                active_kernels.store(active, std::memory_order_relaxed);
+            }
+
+            return *active;
+        }
+    }
+
+    Level best_level()
+    {
+        static const Level best = supported(Level::AVX2) ? Level::AVX2 : supported(Level::SSE2) ? Level::SSE2 : Level::SCALAR;
+        return best;
+    }
+
+    Level level() { return kernels().level; }
+
+    bool use_level(Level level)
+    {
+        if (!supported(level)) return false;
+
+        active_kernels.store(kernels_for(level), std::memory_order_relaxed);
+        return true;
+    }
+
+    const char* level_name(Level level)
+    {
+        switch (level)
+        {
+        case Level::AVX2: return "avx2";
+        case Level::SSE2: return "sse2";
+        default: return "scalar";
+        }
+    }
+
+    size_t find_line_end(std::string_view s, size_t from)
+    {
+        if (from >= s.size()) return std::string_view::npos;
+
+        size_t found = kernels().find_line_end(s.data() + from, s.size() - from);
+        return from + found == s.size() ? std::string_view::npos : from + found;
+    }
+
+    size_t find_char(std::string_view s, char c, size_t from)
+    {
+        if (from >= s.size()) return std::string_view::npos;
+
+        size_t found = kernels().find_char(s.data() + from, s.size() - from, c);
+        return from + found == s.size() ? std::string_view::npos : from + found;
+    }
+
+    void to_lower(std::string_view s, char* out) { kernels().to_lower(s.data(), s.size(), out); }
+
+    bool is_token(std::string_view s) { return !s.empty() && kernels().is_token(s.data(), s.size()); }
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace nimlib::Server::Utils::Scan
+{
+    // Byte scanning used by the HTTP parser. Every function has a scalar
+    // version and, on x86-64, SSE2 and AVX2 versions working on 16 or 32
+    // bytes at a time. The widest level the CPU supports is picked the first
+    // time any of them is called.
+    enum class Level { SCALAR, SSE2, AVX2 };
+
+    Level best_level();
+    Level level();
+    // Switches every scan to the given level, eg. to compare levels with
+    // each other. Returns false, and changes nothing, if the CPU can not run
+    // that level.
+    bool use_level(Level level);
+    const char* level_name(Level level);
+
+    // Offset of the first CR or LF at or after `from`, or npos if none.
+    size_t find_line_end(std::string_view s, size_t from = 0);
+    // Offset of the first `c` at or after `from`, or npos if none.
+    size_t find_char(std::string_view s, char c, size_t from = 0);
+    // Writes `s` to `out` with A-Z lower cased. `out` holds s.size() bytes
+    // and may be s.data().
+    void to_lower(std::string_view s, char* out);
+    // Whether `s` is a non empty token, the characters a method or header
+    // name is made of (RFC 9110, section 5.6.2).
+    bool is_token(std::string_view s);
+};
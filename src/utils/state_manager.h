@@ -37,6 +37,7 @@ namespace nimlib::Server::Utils
 
     private:
         bool timed_out() const;
+        void mark_state_change();
 
     private:
         T state;
@@ -110,7 +111,7 @@ namespace nimlib::Server::Utils
             }
         }
 
-        last_state_change = std::chrono::steady_clock::now();
+        mark_state_change();
         return state;
     }
 
@@ -133,7 +134,7 @@ namespace nimlib::Server::Utils
             }
         }
 
-        last_state_change = std::chrono::steady_clock::now();
+        mark_state_change();
         return state;
     }
 
@@ -142,7 +143,7 @@ namespace nimlib::Server::Utils
     {
         state = initial_state;
         reset_count = 0;
-        last_state_change = std::chrono::steady_clock::now();
+        mark_state_change();
     }
 
     template<typename T>
@@ -179,5 +180,12 @@ namespace nimlib::Server::Utils
             return false;
         }
     }
-};
 
+    template<typename T>
+    void StateManager<T>::mark_state_change()
+    {
+        // The clock is only read when some state can actually time out.
+        // Owners enforcing their deadlines elsewhere pass no timeouts.
+        if (!msec_time_outs.empty()) last_state_change = std::chrono::steady_clock::now();
+    }
+};
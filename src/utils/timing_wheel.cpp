@@ -0,0 +1,240 @@
+#include "timing_wheel.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <climits>
+
+namespace nimlib::Server::Utils
+{
+    TimingWheel::TimingWheel(time_point start) : start{ start }, last_advance{ start }
+    {
+        heads.fill(-1);
+    }
+
+    void TimingWheel::schedule(int id, time_point deadline)
+    {
+        assert(id >= 0);
+        if (id >= entries.size()) entries.resize(id + 1);
+
+        if (entries[id].slot >= 0)
+        {
+            unlink(id);
+        }
+        else
+        {
+            count++;
+        }
+
+        // A deadline that has already passed fires on the next tick.
+        entries[id].expiry = std::max(to_tick(deadline, true), current_tick + 1);
+        insert(id);
+    }
+
+    void TimingWheel::schedule(int id, std::chrono::milliseconds after)
+    {
+        schedule(id, last_advance + after);
+    }
+
+    void TimingWheel::cancel(int id)
+    {
+        if (scheduled(id))
+        {
+            unlink(id);
+            count--;
+        }
+    }
+
+    bool TimingWheel::scheduled(int id) const
+    {
+        return id >= 0 && id < entries.size() && entries[id].slot >= 0;
+    }
+
+    size_t TimingWheel::size() const { return count; }
+
+    const std::vector<int>& TimingWheel::advance(time_point now)
+    {
+        expired.clear();
+        if (now > last_advance) last_advance = now;
+
+        uint64_t target = to_tick(last_advance, false);
+
+        while (current_tick < target)
+        {
+            // Ticks without anything to cascade or expire are skipped over,
+            // an idle wheel costs nothing no matter how long it sleeps.
+            uint64_t next = next_event_tick();
+            if (next > target)
+            {
+                current_tick = target;
+                break;
+            }
+
+            current_tick = next;
+
+            // Higher levels go first, they may move entries into the slots of
+            // the lower levels that are due on this very tick.
+            for (int level = LEVELS - 1; level > 0; level--)
+            {
+                uint64_t lower_bits = (uint64_t{ 1 } << (SLOT_BITS * level)) - 1;
+                if ((current_tick & lower_bits) == 0) cascade(level);
+            }
+
+            int slot = current_tick & SLOT_MASK;
+            while (heads[slot] >= 0)
+            {
+                int id = heads[slot];
+                unlink(id);
+                count--;
+                expired.push_back(id);
+            }
+        }
+
+        return expired;
+    }
+
+    void TimingWheel::refresh(time_point now)
+    {
+        if (now > last_advance) last_advance = now;
+    }
+
+    int TimingWheel::next_time_out() const
+    {
+        if (count == 0) return -1;
+
+        auto due = start + std::chrono::milliseconds(next_event_tick());
+        auto remaining = std::chrono::ceil<std::chrono::milliseconds>(due - last_advance).count();
+        return std::clamp<long long>(remaining, 0, INT_MAX);
+    }
+
+    TimingWheel::time_point TimingWheel::now() const { return last_advance; }
+
+    void TimingWheel::insert(int id)
+    {
+        auto& entry = entries[id];
+
+        // An entry goes to the lowest level whose span still covers it, that
+        // is where its expiry shares all higher bits with the current tick.
+        int level = -1;
+        for (int l = 0; l < LEVELS; l++)
+        {
+            int shift = SLOT_BITS * (l + 1);
+            if ((entry.expiry >> shift) == (current_tick >> shift))
+            {
+                level = l;
+                break;
+            }
+        }
+
+        uint64_t index{};
+        if (level >= 0)
+        {
+            index = (entry.expiry >> (SLOT_BITS * level)) & SLOT_MASK;
+        }
+        else if (entry.expiry - current_tick < uint64_t{ 1 } << (SLOT_BITS * LEVELS))
+        {
+            // Due in the next round of the top level, its slot comes around
+            // once the top level wraps.
+            level = LEVELS - 1;
+            index = (entry.expiry >> (SLOT_BITS * level)) & SLOT_MASK;
+        }
+        else
+        {
+            // Beyond the reach of the wheel. Parked in the top level slot that
+            // comes around last, and placed again when it is cascaded.
+            level = LEVELS - 1;
+            index = ((current_tick >> (SLOT_BITS * level)) - 1) & SLOT_MASK;
+        }
+
+        int slot = level * SLOTS + index;
+        entry.slot = slot;
+        entry.previous = -1;
+        entry.next = heads[slot];
+        if (heads[slot] >= 0) entries[heads[slot]].previous = id;
+        heads[slot] = id;
+        occupied[level] |= uint64_t{ 1 } << index;
+    }
+
+    void TimingWheel::unlink(int id)
+    {
+        auto& entry = entries[id];
+
+        if (entry.previous >= 0)
+        {
+            entries[entry.previous].next = entry.next;
+        }
+        else
+        {
+            heads[entry.slot] = entry.next;
+        }
+
+        if (entry.next >= 0) entries[entry.next].previous = entry.previous;
+
+        if (heads[entry.slot] < 0)
+        {
+            occupied[entry.slot / SLOTS] &= ~(uint64_t{ 1 } << (entry.slot % SLOTS));
+        }
+
+        entry.slot = -1;
+        entry.previous = -1;
+        entry.next = -1;
+    }
+
+    void TimingWheel::cascade(int level)
+    {
+        int index = (current_tick >> (SLOT_BITS * level)) & SLOT_MASK;
+        int slot = level * SLOTS + index;
+
+        int id = heads[slot];
+        heads[slot] = -1;
+        occupied[level] &= ~(uint64_t{ 1 } << index);
+
+        while (id >= 0)
+        {
+            int next = entries[id].next;
+            insert(id);
+            id = next;
+        }
+    }
+
+    uint64_t TimingWheel::next_event_tick() const
+    {
+        uint64_t next_tick = NO_EVENT;
+
+        for (int level = 0; level < LEVELS; level++)
+        {
+            uint64_t slots = occupied[level];
+            if (!slots) continue;
+
+            int shift = SLOT_BITS * level;
+            uint64_t current = (current_tick >> shift) & SLOT_MASK;
+            uint64_t round = current_tick >> (shift + SLOT_BITS);
+            uint64_t later = current == SLOT_MASK ? 0 : slots & (~uint64_t{ 0 } << (current + 1));
+
+            uint64_t index{};
+            if (later)
+            {
+                index = std::countr_zero(later);
+            }
+            else
+            {
+                // Only parked entries wrap around to the next round.
+                index = std::countr_zero(slots);
+                round++;
+            }
+
+            next_tick = std::min(next_tick, ((round << SLOT_BITS) | index) << shift);
+        }
+
+        return next_tick;
+    }
+
+    uint64_t TimingWheel::to_tick(time_point t, bool round_up) const
+    {
+        if (t <= start) return 0;
+
+        using namespace std::chrono;
+        auto elapsed = round_up ? ceil<milliseconds>(t - start) : floor<milliseconds>(t - start);
+        return elapsed.count();
+    }
+}
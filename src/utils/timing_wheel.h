@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace nimlib::Server::Utils
+{
+    // A hierarchical timing wheel holding at most one deadline per id. Ids are
+    // small dense integers such as connection ids, so entries live in a vector
+    // indexed by id and scheduling or cancelling a deadline is O(1). Time moves
+    // in ticks of one millisecond and every level spans 64 slots of the level
+    // below it, deadlines too far away for the top level are parked there and
+    // placed again once the wheel gets closer to them.
+    class TimingWheel
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+        using time_point = clock::time_point;
+
+        explicit TimingWheel(time_point start = clock::now());
+        ~TimingWheel() = default;
+
+        TimingWheel(const TimingWheel&) = delete;
+        TimingWheel& operator=(const TimingWheel&) = delete;
+        TimingWheel(TimingWheel&&) noexcept = delete;
+        TimingWheel& operator=(TimingWheel&&) noexcept = delete;
+
+        void schedule(int id, time_point deadline);
+        void schedule(int id, std::chrono::milliseconds after);
+        void cancel(int id);
+        bool scheduled(int id) const;
+        size_t size() const;
+
+        // Moves the wheel forward to now and returns the ids whose deadlines
+        // have passed. The returned vector is reused by the next call.
+        const std::vector<int>& advance(time_point now);
+        // Moves the time deadlines are scheduled from to now without
+        // expiring anything, that is left to the next advance(). A loop
+        // calls it as soon as its wait returns, so the deadlines set while it
+        // handles what woke it do not start from before the wait.
+        void refresh(time_point now);
+        // Milliseconds until the wheel has work to do, or -1 if it is empty.
+        int next_time_out() const;
+        // The time the wheel was last advanced to.
+        time_point now() const;
+
+    private:
+        struct Entry
+        {
+            uint64_t expiry{};
+            int slot{ -1 };
+            int previous{ -1 };
+            int next{ -1 };
+        };
+
+        void insert(int id);
+        void unlink(int id);
+        void cascade(int level);
+        uint64_t next_event_tick() const;
+        uint64_t to_tick(time_point t, bool round_up) const;
+
+    private:
+        const time_point start;
+        time_point last_advance;
+        uint64_t current_tick{};
+        size_t count{};
+        std::vector<Entry> entries{};
+        std::vector<int> expired{};
+
+        static const int LEVELS{ 4 };
+        static const int SLOT_BITS{ 6 };
+        static const int SLOTS{ 1 << SLOT_BITS };
+        static const uint64_t SLOT_MASK{ SLOTS - 1 };
+        static const uint64_t NO_EVENT{ UINT64_MAX };
+
+        std::array<int, LEVELS * SLOTS> heads;
+        // One bit per slot, set while the slot holds any entries.
+        std::array<uint64_t, LEVELS> occupied{};
+    };
+};
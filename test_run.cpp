@@ -1,11 +1,26 @@
 #include "src/polling_server.h"
+#ifdef __linux__
+#include "src/epoll_server.h"
+#endif
+#ifdef NIMLIB_WITH_IO_URING
+#include "src/uring_server.h"
+#endif
+#include "src/multi_reactor_server.h"
 #include "src/metrics/builder.h"
 #include "src/common/decorators.h"
+#include "src/http/http.h"
+#include "src/http/static_file_cache.h"
 
-int main()
+#include <charconv>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+void register_metrics()
 {
-    using nimlib::Server::PollingServer;
-    using nimlib::Server::Decorators::decorate;
     using metrics_builder = nimlib::Server::Metrics::Builder<long>;
 
     metrics_builder::instantiate_metric(nimlib::Server::Constants::TIME_TO_RESPONSE)
@@ -16,6 +31,112 @@ int main()
         .with_timeseries(10)
         .build();
 
-    auto psl = decorate(std::make_unique<PollingServer>("8080"));
-    psl->run();
+    // The cache is shared by every loop, each loop's store reports it.
+    nimlib::Server::Metrics::MetricsStore<long>::get_instance().register_metric(
+        nimlib::Server::Handlers::Http::static_file_cache().metric());
+}
+
+std::unique_ptr<nimlib::Server::Types::Server> make_server(std::string_view backend, const std::string& port, bool reuse_port)
+{
+#ifdef __linux__
+    if (backend == "epoll") return std::make_unique<nimlib::Server::EpollServer>(port, reuse_port);
+#endif
+#ifdef NIMLIB_WITH_IO_URING
+    if (backend == "io_uring")
+    {
+        // Kernels without io_uring, or with it turned off, are served by
+        // epoll instead. The listener is closed first, so epoll can bind.
+        auto server = std::make_unique<nimlib::Server::UringServer>(port, reuse_port);
+        if (server->ready()) return server;
+
+        std::cerr << "io_uring could not be set up (" << std::strerror(server->setup_error()) << "), using epoll" << std::endl;
+        server.reset();
+        return std::make_unique<nimlib::Server::EpollServer>(port, reuse_port);
+    }
+#endif
+    return std::make_unique<nimlib::Server::PollingServer>(port, reuse_port);
+}
+
+bool load_routes(const std::string& config_file)
+{
+    using namespace nimlib::Server::Handlers::Http;
+
+    auto router = load_router(config_file, builtin_handlers());
+    if (!router)
+    {
+        std::cerr << "could not load routes from " << config_file << std::endl;
+        return false;
+    }
+
+    route_table().publish(std::make_shared<const Router>(std::move(router.value())));
+    return true;
+}
+
+void reload_routes_on_hangup(const std::string& config_file)
+{
+    // SIGHUP is blocked before any loop thread starts, so it is only ever
+    // taken here, outside of a signal handler.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    std::thread([config_file, signals]() {
+        int signal;
+        while (sigwait(&signals, &signal) == 0)
+        {
+            load_routes(config_file);
+        }
+        }).detach();
+}
+
+int main(int argc, char* argv[])
+{
+    using nimlib::Server::Decorators::decorate;
+    using nimlib::Server::MultiReactorServer;
+
+    // The event loop backend can be picked on the command line, eg.
+    // `test_run epoll` or `test_run io_uring`, to compare backends on the
+    // same workload. An optional second argument starts that many loops.
+    // A route configuration can be given as the third argument, sending the
+    // process SIGHUP reloads it without dropping any connection.
+    static const std::string port{ "8080" };
+    std::string_view backend{ argc > 1 ? argv[1] : "poll" };
+    int reactor_count{ 1 };
+    if (argc > 2)
+    {
+        std::string_view count{ argv[2] };
+        auto [end, error] = std::from_chars(count.data(), count.data() + count.size(), reactor_count);
+        if (error != std::errc{} || end != count.data() + count.size() || reactor_count < 1)
+        {
+            std::cerr << "the number of loops must be a positive number, not " << count << std::endl;
+            return 1;
+        }
+    }
+
+    // Routes are built up front rather than by the first connection.
+    nimlib::Server::Handlers::Http::route_table();
+    if (argc > 3)
+    {
+        if (!load_routes(argv[3])) return 1;
+        reload_routes_on_hangup(argv[3]);
+    }
+
+    if (reactor_count > 1)
+    {
+        // Metrics are sharded per loop, so every loop registers its own.
+        // /metrics reports the shard of the loop that accepted the
+        // connection it came in on.
+        auto psl = decorate(std::make_unique<MultiReactorServer>(reactor_count, [backend]() {
+            register_metrics();
+            return make_server(backend, port, true);
+            }));
+        psl->run();
+    }
+    else
+    {
+        register_metrics();
+        auto psl = decorate(make_server(backend, port, false));
+        psl->run();
+    }
 }
@@ -0,0 +1,10 @@
+#include <gtest/gtest.h>
+
+#include "../src/epoll_server.h"
+
+using namespace nimlib::Server;
+
+TEST(EpollServerTest, _)
+{
+    EpollServer es{ "8081" };
+}
@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../../src/http/body_reader.h"
+
+using nimlib::Server::Handlers::Http::BodyReader;
+using nimlib::Server::Handlers::Http::RequestBody;
+
+// Feeds `input` to the reader `step` bytes at a time, passing again whatever
+// it did not consume, like a handler reading a body as it arrives. Returns
+// the last result and leaves what follows the body in `rest`.
+static BodyReader::Result read_in_steps(BodyReader& reader, RequestBody& body, std::string_view input, size_t step, std::string& rest)
+{
+    std::string pending{};
+    auto result = BodyReader::Result::INCOMPLETE;
+
+    for (size_t at = 0; at < input.size() && result == BodyReader::Result::INCOMPLETE; at += step)
+    {
+        pending += input.substr(at, step);
+        size_t consumed{};
+        result = reader.read(pending, consumed, body);
+        pending.erase(0, consumed);
+    }
+
+    rest = pending;
+    return result;
+}
+
+// The whole body, read back a few bytes at a time.
+static std::string read_back(const RequestBody& body)
+{
+    std::string contents{};
+    char piece[7];
+
+    for (size_t copied; (copied = body.read(contents.size(), piece, sizeof(piece))) > 0;)
+    {
+        contents.append(piece, copied);
+    }
+
+    return contents;
+}
+
+TEST(BodyReaderTests, ContentLengthBody)
+{
+    const std::string input{ "hello worldGET / HTTP/1.1\r\n" };
+
+    for (size_t step : { 1, 3, 100 })
+    {
+        BodyReader reader;
+        RequestBody body;
+        std::string rest;
+        reader.expect_length(11);
+
+        EXPECT_EQ(read_in_steps(reader, body, input, step, rest), BodyReader::Result::COMPLETE);
+        EXPECT_EQ(body.view(), "hello world");
+        EXPECT_TRUE(std::string_view{ "GET / HTTP/1.1\r\n" }.starts_with(rest));
+    }
+}
+
+TEST(BodyReaderTests, EmptyBody)
+{
+    BodyReader reader;
+    RequestBody body;
+    size_t consumed{};
+    reader.expect_length(0);
+
+    EXPECT_EQ(reader.read("GET / HTTP/1.1\r\n", consumed, body), BodyReader::Result::COMPLETE);
+    EXPECT_EQ(consumed, 0);
+    EXPECT_EQ(body.size(), 0);
+}
+
+TEST(BodyReaderTests, ChunkedBody)
+{
+    const std::string input{
+        "5\r\nhello\r\n"
+        "1;name=value\r\n \r\n"
+        "A\r\n0123456789\r\n"
+        "0\r\n"
+        "Trailer: value\r\n"
+        "\r\n"
+        "GET / HTTP/1.1\r\n" };
+
+    for (size_t step : { 1, 2, 5, 1000 })
+    {
+        BodyReader reader;
+        RequestBody body;
+        std::string rest;
+        reader.expect_chunked();
+
+        EXPECT_EQ(read_in_steps(reader, body, input, step, rest), BodyReader::Result::COMPLETE) << step;
+        EXPECT_EQ(body.view(), "hello 0123456789") << step;
+        EXPECT_TRUE(std::string_view{ "GET / HTTP/1.1\r\n" }.starts_with(rest)) << step;
+    }
+}
+
+TEST(BodyReaderTests, ChunkedBodyPassedToSink)
+{
+    BodyReader reader;
+    RequestBody body;
+    std::vector<std::string> pieces{};
+    body.set_sink([&pieces](std::string_view bytes) { pieces.emplace_back(bytes); return true; });
+    std::string rest;
+    reader.expect_chunked();
+
+    EXPECT_EQ(read_in_steps(reader, body, "5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n", 1000, rest), BodyReader::Result::COMPLETE);
+    EXPECT_EQ(pieces, (std::vector<std::string>{ "hello", " world" }));
+    EXPECT_EQ(body.size(), 0);
+
+    // A sink refusing the body fails it, the next body is kept again.
+    body.clear();
+    body.set_sink([](std::string_view) { return false; });
+    reader.expect_length(5);
+    EXPECT_EQ(read_in_steps(reader, body, "hello", 5, rest), BodyReader::Result::INVALID);
+
+    body.clear();
+    reader.expect_length(5);
+    EXPECT_EQ(read_in_steps(reader, body, "hello", 5, rest), BodyReader::Result::COMPLETE);
+    EXPECT_EQ(body.view(), "hello");
+}
+
+TEST(BodyReaderTests, InvalidChunkedBodies)
+{
+    for (const std::string& input : std::vector<std::string>{
+        "x\r\nhello\r\n0\r\n\r\n",
+        "-5\r\nhello\r\n0\r\n\r\n",
+        "5\r\nhelloXX0\r\n\r\n",
+        "5 x\r\nhello\r\n0\r\n\r\n",
+        "fffffffffffffffff\r\n",
+        std::string(BodyReader::MAX_LINE_SIZE + 10, '1') })
+    {
+        BodyReader reader;
+        RequestBody body;
+        size_t consumed{};
+        reader.expect_chunked();
+
+        EXPECT_EQ(reader.read(input, consumed, body), BodyReader::Result::INVALID) << input.substr(0, 20);
+        EXPECT_EQ(reader.read("0\r\n\r\n", consumed, body), BodyReader::Result::INVALID);
+    }
+}
+
+TEST(BodyReaderTests, BodyOverMaxSizeRefused)
+{
+    RequestBody body;
+    size_t consumed{};
+
+    BodyReader exact{ 10 };
+    exact.expect_length(10);
+    EXPECT_EQ(exact.read("0123456789", consumed, body), BodyReader::Result::COMPLETE);
+
+    // Refused from the length alone, nothing is read.
+    BodyReader reader{ 10 };
+    reader.expect_length(11);
+    EXPECT_EQ(reader.read("0123456789x", consumed, body), BodyReader::Result::TOO_LARGE);
+    EXPECT_EQ(consumed, 0);
+
+    // Chunks are refused once their sizes add up to more.
+    std::string rest;
+    reader.expect_chunked();
+    EXPECT_EQ(read_in_steps(reader, body, "6\r\n012345\r\n5\r\n6789x\r\n0\r\n\r\n", 3, rest), BodyReader::Result::TOO_LARGE);
+    EXPECT_EQ(reader.read("0\r\n\r\n", consumed, body), BodyReader::Result::TOO_LARGE);
+
+    reader.expect_chunked();
+    EXPECT_EQ(read_in_steps(reader, body, "6\r\n012345\r\n4\r\n6789\r\n0\r\n\r\n", 3, rest), BodyReader::Result::COMPLETE);
+}
+
+TEST(BodyReaderTests, LongBodyWrittenToFile)
+{
+    std::string contents{};
+    for (int i = 0; i < 1000; i++) contents += std::to_string(i);
+
+    BodyReader reader;
+    RequestBody body{ 100 };
+    std::string rest;
+    reader.expect_length(contents.size());
+
+    EXPECT_EQ(read_in_steps(reader, body, contents, 64, rest), BodyReader::Result::COMPLETE);
+    EXPECT_FALSE(body.in_memory());
+    EXPECT_EQ(body.view(), "");
+    EXPECT_EQ(body.size(), contents.size());
+    EXPECT_EQ(read_back(body), contents);
+
+    // The next body starts out in memory again.
+    body.clear();
+    EXPECT_TRUE(body.in_memory());
+    EXPECT_TRUE(body.append("short"));
+    EXPECT_EQ(read_back(body), "short");
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <ctime>
+#include <string>
+
+#include "../../src/http/constant_response.h"
+#include "../../src/http/static_response.h"
+#include "../support/allocation_counter.h"
+
+using nimlib::Server::Handlers::Http::ConstantResponse;
+using nimlib::Server::Handlers::Http::date_header;
+using nimlib::Server::Handlers::Http::parse_http_date;
+
+TEST(ConstantResponseTests, SerializedOnce)
+{
+    ConstantResponse response{ 404, "Not found", "text/html; charset=UTF-8", "not found" };
+
+    EXPECT_EQ(response.head(), "HTTP/1.1 404 Not found\r\ncontent-type: text/html; charset=UTF-8\r\ncontent-length: 9\r\n");
+    EXPECT_EQ(response.tail(), "\r\nnot found");
+    EXPECT_EQ(*response.bytes(), std::string(response.head()) + std::string(response.tail()));
+    EXPECT_EQ(response.head_size(), response.head().size());
+    EXPECT_EQ(response.status(), 404);
+    EXPECT_FALSE(response.dated());
+
+    // Copies share the bytes.
+    auto copy = response;
+    EXPECT_EQ(copy.bytes(), response.bytes());
+}
+
+TEST(ConstantResponseTests, NoContentTypeWithoutBody)
+{
+    ConstantResponse response{ 204, "No Content", "", "", true };
+
+    EXPECT_EQ(response.head(), "HTTP/1.1 204 No Content\r\ncontent-length: 0\r\n");
+    EXPECT_EQ(response.tail(), "\r\n");
+    EXPECT_TRUE(response.dated());
+}
+
+TEST(ConstantResponseTests, DateHeaderFormattedOncePerSecond)
+{
+    auto line = date_header();
+    ASSERT_TRUE(line.starts_with("date: "));
+    ASSERT_TRUE(line.ends_with(" GMT\r\n"));
+
+    auto date = parse_http_date(line.substr(6, line.size() - 8));
+    ASSERT_TRUE(date);
+    EXPECT_LE(std::abs(*date - std::time(nullptr)), 1);
+
+    auto allocations = nimlib::Tests::allocation_count();
+    for (int i = 0; i < 1000; i++) line = date_header();
+    EXPECT_EQ(nimlib::Tests::allocation_count() - allocations, 0);
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../../src/http/headers.h"
+#include "../support/allocation_counter.h"
+
+using nimlib::Server::Handlers::Http::header_name;
+using nimlib::Server::Handlers::Http::Headers;
+using nimlib::Server::Handlers::Http::known_header;
+using nimlib::Server::Handlers::Http::KnownHeader;
+
+static std::vector<std::pair<std::string, std::string>> fields(const Headers& headers)
+{
+    std::vector<std::pair<std::string, std::string>> all{};
+    for (const auto& [name, value] : headers) all.emplace_back(name, value);
+    return all;
+}
+
+static std::vector<std::string> values(const Headers::ValueList& list)
+{
+    std::vector<std::string> all{};
+    for (auto value : list) all.emplace_back(value);
+    return all;
+}
+
+TEST(HeadersTests, KnownHeaderNames)
+{
+    for (size_t i = 0; i < static_cast<size_t>(KnownHeader::COUNT); i++)
+    {
+        auto header = static_cast<KnownHeader>(i);
+        EXPECT_EQ(known_header(header_name(header)), header) << header_name(header);
+    }
+
+    EXPECT_FALSE(known_header(""));
+    EXPECT_FALSE(known_header("x-request-id"));
+    EXPECT_FALSE(known_header("content-lengths"));
+    // Names are looked up lower case.
+    EXPECT_FALSE(known_header("Content-Length"));
+}
+
+TEST(HeadersTests, FieldsKeptInOrderWithNamesLowerCased)
+{
+    Headers headers{};
+    headers.add("Host", "localhost");
+    headers.add("X-Request-ID", "7");
+    headers.add(KnownHeader::ACCEPT, "*/*");
+    headers.add("host", "example.com");
+
+    EXPECT_EQ(headers.size(), 4);
+    EXPECT_EQ(fields(headers), (std::vector<std::pair<std::string, std::string>>{
+        { "host", "localhost" }, { "x-request-id", "7" }, { "accept", "*/*" }, { "host", "example.com" } }));
+    EXPECT_EQ(headers[1].name, "x-request-id");
+
+    EXPECT_EQ(headers.get(KnownHeader::HOST), "localhost");
+    EXPECT_EQ(headers.get("host"), "localhost");
+    EXPECT_EQ(headers.get("x-request-id"), "7");
+    EXPECT_FALSE(headers.get("x-other"));
+    EXPECT_FALSE(headers.get(KnownHeader::DATE));
+    EXPECT_TRUE(headers.contains(KnownHeader::ACCEPT));
+    EXPECT_FALSE(headers.contains("accept-encoding"));
+}
+
+TEST(HeadersTests, SetReplacesEveryField)
+{
+    Headers headers{};
+    headers.add("vary", "accept-encoding");
+    headers.add("content-type", "text/plain");
+    headers.add("vary", "origin");
+    headers.add("x-trace", "a");
+    headers.add("x-trace", "b");
+
+    headers.set(KnownHeader::VARY, "cookie");
+    headers.set("x-trace", "c");
+    headers.set("etag", "\"1\"");
+
+    EXPECT_EQ(fields(headers), (std::vector<std::pair<std::string, std::string>>{
+        { "vary", "cookie" }, { "content-type", "text/plain" }, { "x-trace", "c" }, { "etag", "\"1\"" } }));
+    EXPECT_EQ(headers.get(KnownHeader::CONTENT_TYPE), "text/plain");
+
+    headers.remove(KnownHeader::VARY);
+    headers.remove("x-trace");
+    EXPECT_EQ(fields(headers), (std::vector<std::pair<std::string, std::string>>{
+        { "content-type", "text/plain" }, { "etag", "\"1\"" } }));
+    EXPECT_EQ(headers.get(KnownHeader::ETAG), "\"1\"");
+    EXPECT_FALSE(headers.contains(KnownHeader::VARY));
+}
+
+TEST(HeadersTests, NamesMatchedInAnyCase)
+{
+    std::string long_name = "X-" + std::string(40, 'N');
+    Headers headers{};
+    headers.add("Content-Type", "text/plain");
+    headers.add("X-Trace", "a");
+    headers.add("x-trace", "b, c");
+    headers.add(long_name, "long");
+
+    EXPECT_EQ(headers.get("CONTENT-TYPE"), "text/plain");
+    EXPECT_EQ(headers.get("X-TRACE"), "a");
+    EXPECT_EQ(headers.get(long_name), "long");
+    EXPECT_TRUE(headers.contains("x-Trace"));
+    EXPECT_EQ(values(headers.list("X-Trace")), (std::vector<std::string>{ "a", "b", "c" }));
+    EXPECT_TRUE(headers.list("X-None").empty());
+
+    // Set replaces the fields whatever the case they were given in.
+    headers.set("X-TRACE", "d");
+    headers.set("Content-type", "text/html");
+    EXPECT_EQ(fields(headers), (std::vector<std::pair<std::string, std::string>>{
+        { "content-type", "text/html" }, { "x-" + std::string(40, 'n'), "long" }, { "x-trace", "d" } }));
+
+    headers.remove("X-Trace");
+    headers.remove(long_name);
+    headers.remove("CONTENT-TYPE");
+    EXPECT_TRUE(headers.empty());
+}
+
+TEST(HeadersTests, ListSplitsOnCommasAcrossFields)
+{
+    Headers headers{};
+    headers.add("Accept-Encoding", " gzip;q=0.5 ,br,, ");
+    headers.add("host", "localhost");
+    headers.add("accept-encoding", "zstd");
+    headers.add("x-list", "a,b");
+    headers.add("X-List", "");
+    headers.add("x-list", "c");
+
+    EXPECT_EQ(values(headers.list(KnownHeader::ACCEPT_ENCODING)), (std::vector<std::string>{ "gzip;q=0.5", "br", "zstd" }));
+    EXPECT_EQ(values(headers.list("x-list")), (std::vector<std::string>{ "a", "b", "c" }));
+    EXPECT_EQ(values(headers.list("host")), std::vector<std::string>{ "localhost" });
+    EXPECT_TRUE(headers.list(KnownHeader::RANGE).empty());
+    EXPECT_TRUE(headers.list("x-none").empty());
+
+    // The value as received is kept.
+    EXPECT_EQ(headers.get(KnownHeader::ACCEPT_ENCODING), " gzip;q=0.5 ,br,, ");
+}
+
+TEST(HeadersTests, MoreFieldsThanKeptInline)
+{
+    Headers headers{};
+    for (size_t i = 0; i < Headers::INLINE_FIELDS + 8; i++) headers.add("x-field-" + std::to_string(i), std::to_string(i));
+    headers.add("content-length", "5");
+
+    EXPECT_EQ(headers.size(), Headers::INLINE_FIELDS + 9);
+    EXPECT_EQ(headers.get("x-field-20"), "20");
+    EXPECT_EQ(headers.get(KnownHeader::CONTENT_LENGTH), "5");
+
+    headers.remove("x-field-0");
+    EXPECT_EQ(headers.size(), Headers::INLINE_FIELDS + 8);
+    EXPECT_EQ(headers[0].name, "x-field-1");
+    EXPECT_EQ(headers.get(KnownHeader::CONTENT_LENGTH), "5");
+
+    auto copy = headers;
+    EXPECT_EQ(fields(copy), fields(headers));
+}
+
+TEST(HeadersTests, ReusedWithoutAllocating)
+{
+    Headers headers{};
+    auto fill = [&headers]()
+        {
+            headers.add("Host", "localhost:8080");
+            headers.add("User-Agent", "Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0");
+            headers.add("Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
+            headers.add("Accept-Encoding", "gzip, deflate, br, zstd");
+            headers.add("Connection", "keep-alive");
+            headers.add("X-Request-ID", "f3b1c2d4");
+        };
+
+    fill();
+    headers.clear();
+    EXPECT_TRUE(headers.empty());
+
+    // Cleared headers keep the memory their fields took.
+    auto allocations = nimlib::Tests::allocation_count();
+    for (int i = 0; i < 100; i++)
+    {
+        fill();
+        headers.clear();
+    }
+    EXPECT_EQ(nimlib::Tests::allocation_count() - allocations, 0);
+}
@@ -0,0 +1,836 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../../src/http/http.h"
+#include "../../src/http/serializer.h"
+#include "../../src/http/static_file_cache.h"
+#include "../support/allocation_counter.h"
+#include "../support/gunzip.h"
+#include "../support/temp_file.h"
+
+using nimlib::Server::Handlers::Http::HttpHandler;
+using nimlib::Server::Handlers::Http::Router;
+using nimlib::Server::Handlers::Http::Request;
+using nimlib::Server::Handlers::Http::Response;
+using nimlib::Server::Handlers::Http::params_t;
+using nimlib::Server::Handlers::Http::parse_response;
+using nimlib::Server::Handlers::Http::set_body_memory_limit;
+using nimlib::Server::Handlers::Http::body_memory_limit;
+using nimlib::Server::Handlers::Http::set_max_body_size;
+using nimlib::Server::Handlers::Http::BodyReader;
+using nimlib::Server::Handlers::Http::RequestBody;
+using nimlib::Server::Handlers::Http::static_file_cache;
+using nimlib::Server::Handlers::Http::CompressionSettings;
+using nimlib::Server::Handlers::Http::set_response_compression;
+using nimlib::Server::Types::Handler;
+using nimlib::Server::Utils::ByteBuffer;
+using nimlib::Server::Utils::OutputQueue;
+using nimlib::Server::Types::Socket;
+using nimlib::Server::Constants::HandlerState;
+using nimlib::Server::Constants::ServerDirective;
+using nimlib::Server::Constants::ConnectionState;
+
+// Stands in for a TcpConnection, the handler reads from and writes to its
+// streams and tells it what it wants next.
+struct FakeConnection : public Connection, public StreamsProvider
+{
+    void accept_socket(std::unique_ptr<Socket> s) override {}
+    void notify(ServerDirective directive) override {}
+    void notify(Handler& handler) override { notified++; }
+    void set_handler(std::shared_ptr<Handler>) override {}
+    void halt() override {}
+    void time_out() override {}
+    ConnectionState get_state() override { return ConnectionState::HANDLING; }
+    const int get_id() const override { return 1; }
+
+    ByteBuffer& source() override { return input; }
+    OutputQueue& sink() override { return output; }
+
+    // The bytes the handler has not read yet.
+    std::string unread() { return std::string(input.readable()); }
+
+    ByteBuffer input{};
+    OutputQueue output{};
+    int notified{};
+};
+
+// Answers /keep/<n> with n and keeps the connection open, answers /close/<n>
+// with n and closes it, and answers POST /echo with the request body.
+static std::shared_ptr<const Router> pipeline_router()
+{
+    auto answer = [](HandlerState state)
+        {
+            return [state](const Request& request, Response& response, params_t& params) -> std::optional<HandlerState>
+                {
+                    response.status = 200;
+                    response.reason = "OK";
+                    response.body = params.empty() ? request.body : params.begin()->second;
+                    return state;
+                };
+        };
+
+    Router router{};
+    router.get("/keep/<n>", answer(HandlerState::FINISHED_WAIT));
+    router.get("/close/<n>", answer(HandlerState::FINISHED_NO_WAIT));
+    router.post("/echo", answer(HandlerState::FINISHED_WAIT));
+    router.post("/upload", [](const Request& request, Response& response, params_t& params) -> std::optional<HandlerState>
+        {
+            // Reads the body a piece at a time, wherever it was kept.
+            char piece[5];
+            for (size_t copied; (copied = request.content->read(response.body.size(), piece, sizeof(piece))) > 0;)
+            {
+                response.body.append(piece, copied);
+            }
+
+            response.status = 200;
+            response.reason = "OK";
+            return HandlerState::FINISHED_WAIT;
+        });
+
+    return std::make_shared<const Router>(std::move(router));
+}
+
+static std::string get(std::string target) { return "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n\r\n"; }
+
+// Responses without their Date header, which changes every second.
+static std::string undated(std::string responses)
+{
+    for (size_t at; (at = responses.find("\r\ndate: ")) != std::string::npos;)
+    {
+        responses.erase(at + 2, responses.find("\r\n", at + 2) - at);
+    }
+
+    return responses;
+}
+
+// The response the handler writes for `body`, with the Connection header it
+// is expected to add, if any, and without its Date header.
+static std::string response(std::string body, std::string connection = "")
+{
+    Response expected{};
+    expected.status = 200;
+    expected.reason = "OK";
+    if (!connection.empty()) expected.headers.set("connection", connection);
+    expected.body = body;
+
+    return undated(parse_response(expected).value());
+}
+
+TEST(HttpHandlerTests, PipelinedRequestsAnsweredInOneGo)
+{
+    FakeConnection connection;
+    HttpHandler handler{ pipeline_router() };
+    connection.input.append(get("/keep/1"));
+    connection.input.append(get("/keep/2"));
+    connection.input.append(get("/keep/3"));
+
+    handler.notify(connection, connection);
+
+    EXPECT_EQ(connection.notified, 1);
+    EXPECT_TRUE(handler.wants_to_live());
+    EXPECT_EQ(undated(connection.output.str()), response("1") + response("2") + response("3"));
+    EXPECT_EQ(connection.unread(), "");
+}
+
+TEST(HttpHandlerTests, PartialPipelinedRequestLeftForLater)
+{
+    FakeConnection connection;
+    HttpHandler handler{ pipeline_router() };
+    std::string third = get("/keep/3");
+    connection.input.append(get("/keep/1"));
+    connection.input.append(get("/keep/2"));
+    connection.input.append(third.substr(0, 10));
+
+    handler.notify(connection, connection);
+
+    EXPECT_TRUE(handler.wants_to_live());
+    EXPECT_EQ(undated(connection.output.str()), response("1") + response("2"));
+    EXPECT_EQ(connection.unread(), third.substr(0, 10));
+
+    // The connection writes the responses, then reads the rest.
+    connection.output.clear();
+    handler.notify(connection, connection);
+    EXPECT_TRUE(handler.wants_more_bytes());
+    EXPECT_EQ(connection.output.str(), "");
+
+    connection.input.append(third.substr(10));
+    handler.notify(connection, connection);
+    EXPECT_TRUE(handler.wants_to_live());
+    EXPECT_EQ(undated(connection.output.str()), response("3"));
+    EXPECT_EQ(connection.unread(), "");
+}
+
+TEST(HttpHandlerTests, PipelinedRequestsHeldBackOverHighWatermark)
+{
+    FakeConnection connection;
+    HttpHandler handler{ pipeline_router() };
+    connection.output.set_high_watermark(response("1").size() + nimlib::Server::Handlers::Http::date_header().size() + 1);
+    connection.input.append(get("/keep/1"));
+    connection.input.append(get("/keep/2"));
+    connection.input.append(get("/keep/3"));
+
+    handler.notify(connection, connection);
+
+    // Two responses are more than the connection wants waiting, the third
+    // request is answered once they have been written.
+    EXPECT_TRUE(handler.wants_to_live());
+    EXPECT_EQ(undated(connection.output.str()), response("1") + response("2"));
+    EXPECT_EQ(connection.unread(), get("/keep/3"));
+
+    connection.output.clear();
+    handler.notify(connection, connection);
+    EXPECT_EQ(undated(connection.output.str()), response("3"));
+    EXPECT_EQ(connection.unread(), "");
+}
+
+TEST(HttpHandlerTests, ClosingResponseEndsPipeline)
+{
+    FakeConnection connection;
+    HttpHandler handler{ pipeline_router() };
+    connection.input.append(get("/keep/1"));
+    connection.input.append(get("/close/2"));
+    connection.input.append(get("/keep/3"));
+
+    handler.notify(connection, connection);
+
+    EXPECT_TRUE(handler.wants_to_write());
+    EXPECT_FALSE(handler.wants_to_live());
+    EXPECT_EQ(undated(connection.output.str()), response("1") + response("2", "close"));
+}
+
+TEST(HttpHandlerTests, RequestBodyEndsAtContentLength)
+{
+    FakeConnection connection;
+    HttpHandler handler{ pipeline_router() };
+    std::string post{ "POST /echo HTTP/1.1\r\nContent-Length: 11\r\n\r\nhello world" };
+    connection.input.append(post.substr(0, post.size() - 5));
+
+    // The head has arrived, the body only in part.
+    handler.notify(connection, connection);
+    EXPECT_TRUE(handler.wants_more_bytes());
+    EXPECT_EQ(connection.output.str(), "");
+
+    connection.input.append(post.substr(post.size() - 5));
+    connection.input.append(get("/keep/2"));
+    handler.notify(connection, connection);
+
+    EXPECT_TRUE(handler.wants_to_live());
+    EXPECT_EQ(undated(connection.output.str()), response("hello world") + response("2"));
+    EXPECT_EQ(connection.unread(), "");
+}
+
+TEST(HttpHandlerTests, ClientClosesConnection)
+{
+    FakeConnection connection;
+    HttpHandler handler{ pipeline_router() };
+    connection.input.append("GET /keep/1 HTTP/1.1\r\nConnection: Close\r\n\r\n");
+    connection.input.append(get("/keep/2"));
+
+    handler.notify(connection, connection);
+
+    EXPECT_TRUE(handler.wants_to_write());
+    EXPECT_EQ(undated(connection.output.str()), response("1", "close"));
+}
+
+TEST(HttpHandlerTests, Http10KeptAliveOnlyWhenAsked)
+{
+    FakeConnection connection;
+    HttpHandler handler{ pipeline_router() };
+    connection.input.append("GET /keep/1 HTTP/1.0\r\nConnection: keep-alive\r\n\r\n");
+
+    handler.notify(connection, connection);
+    EXPECT_TRUE(handler.wants_to_live());
+    EXPECT_EQ(undated(connection.output.str()), response("1", "keep-alive"));
+
+    connection.output.clear();
+    connection.input.append("GET /keep/2 HTTP/1.0\r\n\r\n");
+
+    handler.notify(connection, connection);
+    EXPECT_TRUE(handler.wants_to_write());
+    EXPECT_EQ(undated(connection.output.str()), response("2", "close"));
+}
+
+TEST(HttpHandlerTests, ConnectionClosedAfterMaxRequests)
+{
+    FakeConnection connection;
+    HttpHandler handler{ pipeline_router() };
+    int served = 0;
+
+    while (served <= HttpHandler::MAX_KEEP_ALIVE_REQUESTS)
+    {
+        connection.output.clear();
+        connection.input.append(get("/keep/" + std::to_string(served)));
+        handler.notify(connection, connection);
+        served++;
+
+        if (!handler.wants_to_live()) break;
+        EXPECT_EQ(undated(connection.output.str()), response(std::to_string(served - 1)));
+    }
+
+    EXPECT_EQ(served, HttpHandler::MAX_KEEP_ALIVE_REQUESTS);
+    EXPECT_TRUE(handler.wants_to_write());
+    EXPECT_EQ(undated(connection.output.str()), response(std::to_string(served - 1), "close"));
+}
+
+TEST(HttpHandlerTests, ChunkedRequestBody)
+{
+    FakeConnection connection;
+    HttpHandler handler{ pipeline_router() };
+    std::string post{ "POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n" };
+    connection.input.append(post.substr(0, 50));
+
+    handler.notify(connection, connection);
+    EXPECT_TRUE(handler.wants_more_bytes());
+    EXPECT_EQ(connection.output.str(), "");
+
+    connection.input.append(post.substr(50));
+    connection.input.append(get("/keep/2"));
+    handler.notify(connection, connection);
+
+    EXPECT_TRUE(handler.wants_to_live());
+    EXPECT_EQ(undated(connection.output.str()), response("hello world") + response("2"));
+    EXPECT_EQ(connection.unread(), "");
+}
+
+TEST(HttpHandlerTests, BodyPassedToRouteAsItArrives)
+{
+    std::vector<std::string> pieces{};
+    Router router{};
+    router.post("/store/<name>",
+        [&pieces](const Request& request, Response& response, params_t& params) -> std::optional<HandlerState>
+        {
+            response.status = 200;
+            response.reason = "OK";
+            response.body = std::to_string(pieces.size()) + " pieces, " + std::to_string(request.content->size()) + " kept";
+            return HandlerState::FINISHED_WAIT;
+        },
+        [&pieces](const Request& request, params_t& params, std::string_view bytes)
+        {
+            pieces.push_back(std::string(params.begin()->second) + ":" + std::string(bytes));
+            return true;
+        });
+
+    FakeConnection connection;
+    HttpHandler handler{ std::make_shared<const Router>(std::move(router)) };
+    std::string post{ "POST /store/a HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n" };
+    connection.input.append(post.substr(0, 63));
+
+    // The first chunk is handed over before the rest has arrived.
+    handler.notify(connection, connection);
+    EXPECT_TRUE(handler.wants_more_bytes());
+    EXPECT_EQ(pieces, std::vector<std::string>{ "a:hello" });
+
+    connection.input.append(post.substr(63));
+    handler.notify(connection, connection);
+
+    EXPECT_TRUE(handler.wants_to_live());
+    EXPECT_EQ(pieces, (std::vector<std::string>{ "a:hello", "a: world" }));
+    EXPECT_EQ(undated(connection.output.str()), response("2 pieces, 0 kept"));
+}
+
+TEST(HttpHandlerTests, BodyRefusedByRouteRejected)
+{
+    Router router{};
+    router.post("/store",
+        [](const Request& request, Response& response, params_t& params) -> std::optional<HandlerState>
+        {
+            response.status = 200;
+            response.reason = "OK";
+            return HandlerState::FINISHED_WAIT;
+        },
+        [](const Request& request, params_t& params, std::string_view bytes) { return bytes.find('!') == std::string_view::npos; });
+
+    FakeConnection connection;
+    HttpHandler handler{ std::make_shared<const Router>(std::move(router)) };
+    connection.input.append("POST /store HTTP/1.1\r\nContent-Length: 5\r\n\r\nno!!!");
+
+    handler.notify(connection, connection);
+
+    EXPECT_TRUE(handler.wants_to_write());
+    EXPECT_EQ(connection.output.str(), "");
+}
+
+TEST(HttpHandlerTests, BodyOverMaxSizeAnsweredWith413)
+{
+    set_max_body_size(10);
+    HttpHandler handler{ pipeline_router() };
+    HttpHandler chunked_handler{ pipeline_router() };
+    set_max_body_size(BodyReader::DEFAULT_MAX_SIZE);
+
+    // Answered as soon as the head is in, without waiting for the body.
+    FakeConnection connection;
+    connection.input.append("POST /echo HTTP/1.1\r\nContent-Length: 11\r\n\r\n");
+    handler.notify(connection, connection);
+
+    auto output = undated(connection.output.str());
+    EXPECT_TRUE(output.starts_with("HTTP/1.1 413 Content Too Large\r\n"));
+    EXPECT_NE(output.find("connection: close\r\n"), std::string::npos);
+    EXPECT_TRUE(output.ends_with("\r\n\r\ncontent too large"));
+    EXPECT_TRUE(handler.wants_to_write());
+
+    FakeConnection chunked;
+    chunked.input.append("POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n6\r\n012345\r\n");
+    chunked_handler.notify(chunked, chunked);
+    EXPECT_TRUE(chunked_handler.wants_more_bytes());
+    chunked.input.append("5\r\n6789x\r\n0\r\n\r\n");
+    chunked_handler.notify(chunked, chunked);
+
+    EXPECT_EQ(undated(chunked.output.str()), output);
+    EXPECT_TRUE(chunked_handler.wants_to_write());
+}
+
+TEST(HttpHandlerTests, UnknownTransferCodingRejected)
+{
+    FakeConnection connection;
+    HttpHandler handler{ pipeline_router() };
+    connection.input.append("POST /echo HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\nhello");
+
+    handler.notify(connection, connection);
+
+    EXPECT_TRUE(handler.wants_to_write());
+    EXPECT_EQ(connection.output.str(), "");
+}
+
+TEST(HttpHandlerTests, LongBodyReadFromFile)
+{
+    set_body_memory_limit(16);
+    FakeConnection connection;
+    HttpHandler handler{ pipeline_router() };
+    set_body_memory_limit(RequestBody::DEFAULT_MEMORY_LIMIT);
+
+    std::string body{};
+    for (int i = 0; i < 100; i++) body += std::to_string(i);
+    std::string post{ "POST /upload HTTP/1.1\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body };
+
+    // The body arrives over several reads, each taken off the stream.
+    for (size_t at = 0; at < post.size(); at += 40)
+    {
+        connection.input.append(post.substr(at, 40));
+        handler.notify(connection, connection);
+        if (at + 40 >= post.size()) break;
+
+        EXPECT_TRUE(handler.wants_more_bytes());
+        if (at + 40 > post.find("\r\n\r\n") + 4) EXPECT_EQ(connection.unread(), "");
+    }
+
+    EXPECT_TRUE(handler.wants_to_live());
+    EXPECT_EQ(undated(connection.output.str()), response(body));
+}
+
+TEST(HttpHandlerTests, StaticFileWrittenFromFile)
+{
+    std::string contents(100000, 'x');
+    auto path = nimlib::Tests::temp_file(contents, ".jpg");
+    Router router{};
+    router.serve_static_big("/picture", path);
+
+    FakeConnection connection;
+    HttpHandler handler{ std::make_shared<const Router>(std::move(router)) };
+    connection.input.append(get("/picture"));
+
+    handler.notify(connection, connection);
+
+    // Only the head went through memory, the body is left in the file.
+    auto output = connection.output.str();
+    auto head = output.substr(0, output.find("\r\n\r\n") + 4);
+    EXPECT_TRUE(head.starts_with("HTTP/1.1 200 OK\r\n"));
+    EXPECT_NE(head.find("content-type: image/jpeg\r\n"), std::string::npos);
+    EXPECT_NE(head.find("content-length: " + std::to_string(contents.size()) + "\r\n"), std::string::npos);
+
+    EXPECT_TRUE(handler.wants_to_live());
+    EXPECT_EQ(connection.output.size(), head.size() + contents.size());
+    EXPECT_EQ(connection.output.str(), head + contents);
+
+    std::array<iovec, 4> buffers;
+    ASSERT_EQ(connection.output.gather(buffers), 1);
+    EXPECT_EQ(buffers[0].iov_len, head.size());
+    connection.output.consume(head.size());
+    ASSERT_TRUE(connection.output.front_file());
+    EXPECT_EQ(connection.output.front_file()->size, contents.size());
+
+    unlink(path.c_str());
+}
+
+TEST(HttpHandlerTests, StaticFileWrittenFromCache)
+{
+    std::string contents(10000, 'x');
+    auto path = nimlib::Tests::temp_file(contents, ".jpg");
+    Router router{};
+    router.serve_static("/picture", path);
+
+    FakeConnection connection;
+    HttpHandler handler{ std::make_shared<const Router>(std::move(router)) };
+    connection.input.append(get("/picture"));
+    connection.input.append(get("/picture"));
+
+    handler.notify(connection, connection);
+
+    // Both responses carry the same bytes and headers, built once.
+    auto cached = static_file_cache().get(path, "image/jpeg");
+    ASSERT_TRUE(cached);
+    auto response = connection.output.str();
+    auto head_end = response.find("\r\n\r\n");
+    ASSERT_NE(head_end, std::string::npos);
+    auto head = response.substr(0, head_end + 4);
+
+    EXPECT_NE(head.find(*cached->headers), std::string::npos);
+    EXPECT_EQ(head.find("content-length", head.find("content-length") + 1), std::string::npos);
+    EXPECT_EQ(response, head + contents + head + contents);
+
+    unlink(path.c_str());
+}
+
+TEST(HttpHandlerTests, CachedStaticFileServedWithoutAllocating)
+{
+    std::string contents(10000, 'x');
+    auto path = nimlib::Tests::temp_file(contents, ".jpg");
+    Router router{};
+    router.serve_static("/files/<name>", path);
+
+    FakeConnection connection;
+    HttpHandler handler{ std::make_shared<const Router>(std::move(router)) };
+    auto serve = [&connection, &handler]()
+        {
+            connection.input.append(
+                "GET /files/picture HTTP/1.1\r\n"
+                "Host: localhost:8080\r\n"
+                "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+                "Accept: image/avif,image/webp,image/png,image/svg+xml,image/*;q=0.8,*/*;q=0.5\r\n"
+                "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+                "Connection: keep-alive\r\n"
+                "\r\n");
+            handler.notify(connection, connection);
+            auto written = connection.output.size();
+            connection.output.clear();
+            return written;
+        };
+
+    // The first requests fill the cache and give the connection, its arena
+    // and its buffers the memory they need.
+    auto written = serve();
+    EXPECT_GT(written, contents.size());
+    serve();
+
+    // The request, its params and headers and the response are all on the
+    // arena, the body is shared from the cache.
+    auto allocations = nimlib::Tests::allocation_count();
+    for (int i = 0; i < 100; i++) EXPECT_EQ(serve(), written);
+    EXPECT_EQ(nimlib::Tests::allocation_count() - allocations, 0);
+    EXPECT_TRUE(handler.wants_to_live());
+
+    unlink(path.c_str());
+}
+
+TEST(HttpHandlerTests, LongStreamDoesNotGrowTheArena)
+{
+    // Each chunk routes the request again, finding its parameter again.
+    Router router{};
+    router.get("/stream/<name>", [](const Request&, Response& response, params_t& params) -> std::optional<HandlerState>
+        {
+            response.status = 200;
+            response.reason = "OK";
+            response.body = params.begin()->second;
+            return HandlerState::RECALL;
+        });
+
+    FakeConnection connection;
+    HttpHandler handler{ std::make_shared<const Router>(std::move(router)) };
+    connection.input.append("GET /stream/chunk HTTP/1.1\r\n\r\n");
+    handler.notify(connection, connection);
+    for (int i = 0; i < 10; i++) handler.notify(connection, connection);
+    connection.output.clear();
+
+    auto allocations = nimlib::Tests::allocation_count();
+    for (int i = 0; i < 1000; i++)
+    {
+        handler.notify(connection, connection);
+        connection.output.clear();
+    }
+    EXPECT_EQ(nimlib::Tests::allocation_count() - allocations, 0);
+    EXPECT_TRUE(handler.wants_to_be_calledback());
+}
+
+TEST(HttpHandlerTests, StaticFileRangesWritten)
+{
+    std::string contents{};
+    for (int i = 0; i < 1000; i++) contents += std::to_string(i % 10);
+
+    for (auto big : { false, true })
+    {
+        auto path = nimlib::Tests::temp_file(contents, ".mp4");
+        Router router{};
+        big ? router.serve_static_big("/video", path) : router.serve_static("/video", path);
+
+        FakeConnection connection;
+        HttpHandler handler{ std::make_shared<const Router>(std::move(router)) };
+        connection.input.append("GET /video HTTP/1.1\r\nRange: bytes=10-14\r\n\r\n");
+        connection.input.append("GET /video HTTP/1.1\r\nRange: bytes=0-1,-3\r\n\r\n");
+
+        handler.notify(connection, connection);
+
+        auto output = connection.output.str();
+        auto first_end = output.find("\r\n\r\n") + 4;
+        auto first = output.substr(0, first_end + 5);
+        EXPECT_TRUE(first.starts_with("HTTP/1.1 206 Partial Content\r\n")) << big;
+        EXPECT_NE(first.find("content-range: bytes 10-14/1000\r\n"), std::string::npos) << big;
+        EXPECT_NE(first.find("content-length: 5\r\n"), std::string::npos) << big;
+        EXPECT_TRUE(first.ends_with("\r\n\r\n01234")) << big;
+
+        // The second response holds both parts, each with its own headers.
+        auto second = output.substr(first.size());
+        auto boundary_at = second.find("boundary=") + 9;
+        auto boundary = second.substr(boundary_at, second.find("\r\n", boundary_at) - boundary_at);
+        auto body = "\r\n--" + boundary + "\r\ncontent-type: video/mp4\r\ncontent-range: bytes 0-1/1000\r\n\r\n01"
+            + "\r\n--" + boundary + "\r\ncontent-type: video/mp4\r\ncontent-range: bytes 997-999/1000\r\n\r\n789"
+            + "\r\n--" + boundary + "--\r\n";
+        EXPECT_TRUE(second.starts_with("HTTP/1.1 206 Partial Content\r\n")) << big;
+        EXPECT_NE(second.find("content-length: " + std::to_string(body.size()) + "\r\n"), std::string::npos) << big;
+        EXPECT_TRUE(second.ends_with("\r\n\r\n" + body)) << big;
+
+        unlink(path.c_str());
+    }
+}
+
+TEST(HttpHandlerTests, StaticFileNotModified)
+{
+    auto path = nimlib::Tests::temp_file("not really a video", ".mp4");
+
+    for (auto big : { false, true })
+    {
+        Router router{};
+        big ? router.serve_static_big("/video", path) : router.serve_static("/video", path);
+
+        FakeConnection connection;
+        HttpHandler handler{ std::make_shared<const Router>(std::move(router)) };
+        connection.input.append(get("/video"));
+        handler.notify(connection, connection);
+
+        auto output = connection.output.str();
+        auto etag_at = output.find("etag: ") + 6;
+        auto etag = output.substr(etag_at, output.find("\r\n", etag_at) - etag_at);
+        EXPECT_TRUE(output.starts_with("HTTP/1.1 200 OK\r\n")) << big;
+        EXPECT_NE(output.find("accept-ranges: bytes\r\n"), std::string::npos) << big;
+        EXPECT_TRUE(output.ends_with("not really a video")) << big;
+
+        // The client's copy is current, nothing but the head is sent.
+        connection.output.clear();
+        connection.input.append("GET /video HTTP/1.1\r\nIf-None-Match: " + etag + "\r\n\r\n");
+        handler.notify(connection, connection);
+
+        output = connection.output.str();
+        EXPECT_TRUE(output.starts_with("HTTP/1.1 304 Not Modified\r\n")) << big;
+        EXPECT_NE(output.find("etag: " + etag + "\r\n"), std::string::npos) << big;
+        EXPECT_EQ(output.find("content-length"), std::string::npos) << big;
+        EXPECT_TRUE(output.ends_with("\r\n\r\n")) << big;
+    }
+
+    unlink(path.c_str());
+}
+
+TEST(HttpHandlerTests, PrecompressedCopySent)
+{
+    auto path = nimlib::Tests::temp_file("hello, hello, hello", ".txt");
+    std::string gzipped{ "pretend this is gzip" };
+    auto gzipped_path = path + ".gz";
+    auto file = std::fopen(gzipped_path.c_str(), "w");
+    std::fputs(gzipped.c_str(), file);
+    std::fclose(file);
+
+    Router router{};
+    router.serve_static("/greeting", path);
+    FakeConnection connection;
+    HttpHandler handler{ std::make_shared<const Router>(std::move(router)) };
+
+    connection.input.append("GET /greeting HTTP/1.1\r\nAccept-Encoding: br;q=1, gzip;q=0.8\r\n\r\n");
+    handler.notify(connection, connection);
+    auto output = connection.output.str();
+    EXPECT_NE(output.find("content-encoding: gzip\r\n"), std::string::npos);
+    EXPECT_NE(output.find("vary: accept-encoding\r\n"), std::string::npos);
+    EXPECT_TRUE(output.ends_with("\r\n\r\n" + gzipped));
+
+    // The file as it is, still varying with the header.
+    connection.output.clear();
+    connection.input.append("GET /greeting HTTP/1.1\r\nAccept-Encoding: identity\r\n\r\n");
+    handler.notify(connection, connection);
+    output = connection.output.str();
+    EXPECT_EQ(output.find("content-encoding"), std::string::npos);
+    EXPECT_NE(output.find("vary: accept-encoding\r\n"), std::string::npos);
+    EXPECT_TRUE(output.ends_with("\r\n\r\nhello, hello, hello"));
+
+    unlink(gzipped_path.c_str());
+    unlink(path.c_str());
+}
+
+// Answers /text with a report long enough to be compressed, /short with one
+// that is not, /picture with bytes that are compressed already and /stream
+// with three chunks, one per RECALL.
+static std::shared_ptr<const Router> compression_router(const std::string& text)
+{
+    auto answer = [](std::string content_type, std::string body)
+        {
+            return [content_type, body](const Request&, Response& response, params_t&) -> std::optional<HandlerState>
+                {
+                    response.status = 200;
+                    response.reason = "OK";
+                    response.headers.set("content-type", content_type);
+                    response.body = body;
+                    return HandlerState::FINISHED_WAIT;
+                };
+        };
+
+    auto chunks = std::make_shared<int>(0);
+    auto stream = [chunks, text](const Request&, Response& response, params_t&) -> std::optional<HandlerState>
+        {
+            response.status = 200;
+            response.reason = "OK";
+            response.headers.set("content-type", "text/plain");
+            response.body = std::to_string(*chunks) + text;
+            return ++*chunks % 3 == 0 ? HandlerState::FINISHED_WAIT : HandlerState::RECALL;
+        };
+
+    Router router{};
+    router.get("/text", answer("text/plain; charset=UTF-8", text));
+    router.get("/short", answer("text/plain", "short"));
+    router.get("/picture", answer("image/jpeg", text));
+    router.get("/stream", stream);
+    return std::make_shared<const Router>(std::move(router));
+}
+
+// The body of a response, after its head.
+static std::string body_of(const std::string& response) { return response.substr(response.find("\r\n\r\n") + 4); }
+
+// Joins the chunks of a chunked body.
+static std::string unchunk(std::string_view body)
+{
+    std::string joined{};
+    while (true)
+    {
+        auto line_end = body.find("\r\n");
+        auto size = std::stoul(std::string(body.substr(0, line_end)), nullptr, 16);
+        if (size == 0) return joined;
+        joined += body.substr(line_end + 2, size);
+        body.remove_prefix(line_end + 2 + size + 2);
+    }
+}
+
+TEST(HttpHandlerTests, ResponseCompressed)
+{
+    if (!nimlib::Server::Utils::gzip_available()) GTEST_SKIP() << "built without zlib";
+
+    std::string text{};
+    for (int i = 0; i < 200; i++) text += "requests_served " + std::to_string(i) + "\n";
+
+    FakeConnection connection;
+    HttpHandler handler{ compression_router(text) };
+
+    connection.input.append("GET /text HTTP/1.1\r\nAccept-Encoding: gzip, deflate\r\n\r\n");
+    handler.notify(connection, connection);
+    auto output = connection.output.str();
+    auto body = body_of(output);
+    EXPECT_NE(output.find("content-encoding: gzip\r\n"), std::string::npos);
+    EXPECT_NE(output.find("vary: accept-encoding\r\n"), std::string::npos);
+    EXPECT_NE(output.find("content-length: " + std::to_string(body.size()) + "\r\n"), std::string::npos);
+    EXPECT_LT(body.size(), text.size() / 2);
+    EXPECT_EQ(nimlib::Tests::gunzip(body), text);
+
+    // Not accepted, sent as it is but still varying with the header.
+    connection.output.clear();
+    connection.input.append("GET /text HTTP/1.1\r\nAccept-Encoding: br, gzip;q=0\r\n\r\n");
+    handler.notify(connection, connection);
+    output = connection.output.str();
+    EXPECT_EQ(output.find("content-encoding"), std::string::npos);
+    EXPECT_NE(output.find("vary: accept-encoding\r\n"), std::string::npos);
+    EXPECT_EQ(body_of(output), text);
+
+    // Too short, or compressed already.
+    for (auto target : { "/short", "/picture" })
+    {
+        connection.output.clear();
+        connection.input.append(std::string("GET ") + target + " HTTP/1.1\r\nAccept-Encoding: gzip\r\n\r\n");
+        handler.notify(connection, connection);
+        output = connection.output.str();
+        EXPECT_EQ(output.find("content-encoding"), std::string::npos) << target;
+        EXPECT_EQ(output.find("vary"), std::string::npos) << target;
+    }
+
+    // Turned off.
+    set_response_compression({ 0 });
+    connection.output.clear();
+    connection.input.append("GET /text HTTP/1.1\r\nAccept-Encoding: gzip\r\n\r\n");
+    handler.notify(connection, connection);
+    set_response_compression({});
+    EXPECT_EQ(body_of(connection.output.str()), text);
+}
+
+TEST(HttpHandlerTests, StreamedResponseCompressed)
+{
+    if (!nimlib::Server::Utils::gzip_available()) GTEST_SKIP() << "built without zlib";
+
+    std::string text(300, 'z');
+    FakeConnection connection;
+    HttpHandler handler{ compression_router(text) };
+
+    connection.input.append("GET /stream HTTP/1.1\r\nAccept-Encoding: gzip\r\n\r\n");
+    handler.notify(connection, connection);
+    EXPECT_TRUE(handler.wants_to_be_calledback());
+
+    // What has been sent so far can be read before the stream ends.
+    auto first = unchunk(body_of(connection.output.str()) + "0\r\n\r\n");
+    EXPECT_EQ(nimlib::Tests::gunzip(first, true), "0" + text);
+
+    while (handler.wants_to_be_calledback()) handler.notify(connection, connection);
+
+    auto output = connection.output.str();
+    EXPECT_NE(output.find("transfer-encoding: chunked\r\n"), std::string::npos);
+    EXPECT_NE(output.find("content-encoding: gzip\r\n"), std::string::npos);
+    EXPECT_EQ(output.find("content-length"), std::string::npos);
+    EXPECT_TRUE(output.ends_with("\r\n0\r\n\r\n"));
+    EXPECT_EQ(nimlib::Tests::gunzip(unchunk(body_of(output))), "0" + text + "1" + text + "2" + text);
+    // Done, and waiting for the next request.
+    EXPECT_TRUE(handler.wants_more_bytes());
+
+    // HTTP/1.0 clients can not read chunks, they get the stream as it is,
+    // the route counting on from the last one.
+    connection.output.clear();
+    connection.input.append("GET /stream HTTP/1.0\r\nAccept-Encoding: gzip\r\n\r\n");
+    handler.notify(connection, connection);
+    while (handler.wants_to_be_calledback()) handler.notify(connection, connection);
+    output = connection.output.str();
+    EXPECT_EQ(output.find("content-encoding"), std::string::npos);
+    EXPECT_TRUE(output.ends_with("3" + text + "4" + text + "5" + text));
+}
+
+TEST(HttpHandlerTests, ConstantResponseSentAsSerialized)
+{
+    Router router{};
+    router.constant("/health", { 200, "OK", "text/plain", "ok", true });
+    router.constant("/robots.txt", { 200, "OK", "text/plain", std::string(OutputQueue::COPY_BELOW, 'r') });
+
+    FakeConnection connection;
+    HttpHandler handler{ std::make_shared<const Router>(std::move(router)) };
+
+    connection.input.append("GET /health HTTP/1.1\r\n\r\n");
+    handler.notify(connection, connection);
+    auto output = connection.output.str();
+    EXPECT_TRUE(output.starts_with("HTTP/1.1 200 OK\r\ncontent-type: text/plain\r\ncontent-length: 2\r\ndate: "));
+    EXPECT_TRUE(output.ends_with(" GMT\r\n\r\nok"));
+    EXPECT_EQ(output.find("connection"), std::string::npos);
+    EXPECT_TRUE(handler.wants_to_live());
+
+    // A long body is shared rather than copied, the connection still closes
+    // when the client asks.
+    connection.output.clear();
+    connection.input.append("GET /robots.txt HTTP/1.1\r\nConnection: close\r\n\r\n");
+    handler.notify(connection, connection);
+    output = connection.output.str();
+    EXPECT_TRUE(output.starts_with("HTTP/1.1 200 OK\r\ncontent-type: text/plain\r\ncontent-length: 4096\r\nconnection: close\r\n\r\nrrr"));
+    EXPECT_EQ(output.size(), output.find("\r\n\r\n") + 4 + OutputQueue::COPY_BELOW);
+    EXPECT_TRUE(handler.wants_to_write());
+}
@@ -1,11 +1,30 @@
 #include <gtest/gtest.h>
 
 #include <sstream>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "../../src/http/parser.h"
 
+using nimlib::Server::Handlers::Http::Headers;
 using nimlib::Server::Handlers::Http::parse_request;
+using nimlib::Server::Handlers::Http::RequestParser;
+
+// The values listed under a header, split on commas.
+static std::vector<std::string> values(const Headers& headers, std::string_view name)
+{
+    std::vector<std::string> listed{};
+    for (auto value : headers.list(name)) listed.emplace_back(value);
+    return listed;
+}
+
+static std::vector<std::pair<std::string, std::string>> fields(const Headers& headers)
+{
+    std::vector<std::pair<std::string, std::string>> all{};
+    for (const auto& [name, value] : headers) all.emplace_back(name, value);
+    return all;
+}
 
 TEST(HttpRequestParserTests, IncorrectStartLine)
 {
@@ -355,9 +374,9 @@ TEST(HttpRequestParserTests, RepeatedHeaderField)
     std::vector<std::string> header_1{ "value-1", "value-2" };
 
     EXPECT_TRUE(parse_result);
-    EXPECT_EQ(parse_result.value().headers.find("header1")->second, header_1);
-    EXPECT_EQ(parse_result.value().headers.find("host")->second, std::vector<std::string> { "www.hostname.com" });
-    EXPECT_EQ(parse_result.value().headers.find("connection")->second, std::vector<std::string> { "keep-alive" });
+    EXPECT_EQ(values(parse_result.value().headers, "header1"), header_1);
+    EXPECT_EQ(values(parse_result.value().headers, "host"), std::vector<std::string> { "www.hostname.com" });
+    EXPECT_EQ(values(parse_result.value().headers, "connection"), std::vector<std::string> { "keep-alive" });
 }
 
 TEST(HttpRequestParserTests, WhiteSpaceRemovedFromHeaderValues)
@@ -373,9 +392,9 @@ TEST(HttpRequestParserTests, WhiteSpaceRemovedFromHeaderValues)
     std::vector<std::string> header_1{ "value-1", "value-2" };
 
     EXPECT_TRUE(parse_result);
-    EXPECT_EQ(parse_result.value().headers.find("header1")->second, header_1);
-    EXPECT_EQ(parse_result.value().headers.find("host")->second, std::vector<std::string> { "www.hostname.com" });
-    EXPECT_EQ(parse_result.value().headers.find("connection")->second, std::vector<std::string> { "keep-alive" });
+    EXPECT_EQ(values(parse_result.value().headers, "header1"), header_1);
+    EXPECT_EQ(values(parse_result.value().headers, "host"), std::vector<std::string> { "www.hostname.com" });
+    EXPECT_EQ(values(parse_result.value().headers, "connection"), std::vector<std::string> { "keep-alive" });
 }
 
 TEST(HttpRequestParserTests, HeaderFieldValueSplit)
@@ -392,15 +411,160 @@ TEST(HttpRequestParserTests, HeaderFieldValueSplit)
 
     EXPECT_TRUE(parse_result);
     EXPECT_EQ(parse_result.value().headers.size(), 4);
-    EXPECT_EQ(parse_result.value().headers.find("header")->second.size(), 3);
-    EXPECT_EQ(parse_result.value().headers.find("header")->second[0], "value-1");
-    EXPECT_EQ(parse_result.value().headers.find("header")->second[1], "value-2");
-    EXPECT_EQ(parse_result.value().headers.find("header")->second[2], "value-3");
-    EXPECT_EQ(parse_result.value().headers.find("transfer-encoding")->second.size(), 2);
-    EXPECT_EQ(parse_result.value().headers.find("transfer-encoding")->second[0], "gzip;q=0.5");
-    EXPECT_EQ(parse_result.value().headers.find("transfer-encoding")->second[1], "chunked");
-    EXPECT_EQ(parse_result.value().headers.find("host")->second[0], "www.hostname.com");
-    EXPECT_EQ(parse_result.value().headers.find("connection")->second[0], "keep-alive");
+    EXPECT_EQ(values(parse_result.value().headers, "header").size(), 3);
+    EXPECT_EQ(values(parse_result.value().headers, "header")[0], "value-1");
+    EXPECT_EQ(values(parse_result.value().headers, "header")[1], "value-2");
+    EXPECT_EQ(values(parse_result.value().headers, "header")[2], "value-3");
+    EXPECT_EQ(values(parse_result.value().headers, "transfer-encoding").size(), 2);
+    EXPECT_EQ(values(parse_result.value().headers, "transfer-encoding")[0], "gzip;q=0.5");
+    EXPECT_EQ(values(parse_result.value().headers, "transfer-encoding")[1], "chunked");
+    EXPECT_EQ(values(parse_result.value().headers, "host")[0], "www.hostname.com");
+    EXPECT_EQ(values(parse_result.value().headers, "connection")[0], "keep-alive");
+}
+
+TEST(HttpRequestParserTests, ParsedInPlace)
+{
+    std::string input{
+        "POST /some/target/ HTTP/1.1\r\n"
+        "Host: www.hostname.com\r\n"
+        "Content-Type:  text/plain \r\n"
+        "Content-Length: 12\r\n"
+        "\r\n"
+        "message body" };
+    RequestParser parser;
+
+    EXPECT_EQ(parser.parse(input), RequestParser::Result::COMPLETE);
+    EXPECT_EQ(parser.method(), "POST");
+    EXPECT_EQ(parser.target(), "/some/target/");
+    EXPECT_EQ(parser.version(), "HTTP/1.1");
+    EXPECT_EQ(parser.headers().size(), 3);
+    EXPECT_EQ(parser.headers()[1].name, "Content-Type");
+    EXPECT_EQ(parser.headers()[1].value, "text/plain");
+    EXPECT_EQ(parser.header("content-length"), "12");
+    EXPECT_FALSE(parser.header("connection"));
+    EXPECT_EQ(input.substr(parser.head_size()), "message body");
+
+    // Nothing is copied out of the input.
+    EXPECT_GE(parser.target().data(), input.data());
+    EXPECT_LT(parser.target().data(), input.data() + input.size());
+}
+
+TEST(HttpRequestParserTests, ParsedAsBytesArrive)
+{
+    const std::string request{
+        "GET /some/target/ HTTP/1.1\r\n"
+        "Host: www.hostname.com\r\n"
+        "Accept: text/html, application/json\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n" };
+    RequestParser parser;
+    auto result = RequestParser::Result::INCOMPLETE;
+
+    for (size_t i = 1; i <= request.size(); i++)
+    {
+        // A new copy every time, the bytes received so far may have moved.
+        std::string received = request.substr(0, i);
+        result = parser.parse(received);
+
+        if (i < request.size()) ASSERT_EQ(result, RequestParser::Result::INCOMPLETE) << i;
+
+        if (result == RequestParser::Result::COMPLETE)
+        {
+            EXPECT_EQ(parser.method(), "GET");
+            EXPECT_EQ(parser.target(), "/some/target/");
+            EXPECT_EQ(parser.header("host"), "www.hostname.com");
+            EXPECT_EQ(parser.header("accept"), "text/html, application/json");
+            EXPECT_EQ(parser.header("connection"), "keep-alive");
+            EXPECT_EQ(parser.head_size(), request.size());
+        }
+    }
+
+    EXPECT_EQ(result, RequestParser::Result::COMPLETE);
+}
+
+TEST(HttpRequestParserTests, EmptyValuesMovedWithBuffer)
+{
+    RequestParser parser;
+
+    // Parsed up to an empty value, then again from a buffer that has
+    // moved, with the rest of the request.
+    std::string first{ "GET / HTTP/1.1\r\nX-Empty:   \r\nHost: a" };
+    EXPECT_EQ(parser.parse(first), RequestParser::Result::INCOMPLETE);
+
+    std::string second{ first + "\r\n\r\n" };
+    first.assign(first.size(), '#');
+    ASSERT_EQ(parser.parse(second), RequestParser::Result::COMPLETE);
+
+    EXPECT_EQ(parser.method(), "GET");
+    EXPECT_EQ(parser.version(), "HTTP/1.1");
+    EXPECT_EQ(parser.header("x-empty"), "");
+    EXPECT_EQ(parser.header("host"), "a");
+}
+
+TEST(HttpRequestParserTests, InvalidRequestsRejectedInPlace)
+{
+    for (std::string input : {
+        "GET /some/target/ HTTP/1.1\n",
+        "GET /some/target/ HTTP/1.1\rHost: www.hostname.com\r\n\r\n",
+        "GET x /some/target/ HTTP/1.1\r\n",
+        "GEET /some/target/ HTTP/1.1\r\n",
+        "GET /some/target/ HTTP1.1\r\n",
+        "GET  HTTP/1.1\r\n",
+        "GET /some/target/ HTTP/1.1\r\nHost: www.hostname.com\n\r\n",
+        "GET /some/target/ HTTP/1.1\r\nConnection keep-alive\r\n\r\n",
+        "GET /some/target/ HTTP/1.1\r\nHost : www.hostname.com\r\n\r\n",
+        "GET /some/target/ HTTP/1.1\r\n Host: www.hostname.com\r\n\r\n",
+        "GET /some/target/ HTTP/1.1\r\nContent-Length: 12\r\nTransfer-Encoding: chunked\r\n\r\n",
+        "GET /some/target/ HTTP/1.1\r\nTransfer-Encoding: chunked\r\nContent-Length: 12\r\n\r\n",
+        "GET /some/target/ HTTP/1.1\r\nContent-Length: 45a2\r\n\r\n",
+        "GET /some/target/ HTTP/1.1\r\nContent-Length: 12\r\nContent-Length: 14\r\n\r\n" })
+    {
+        RequestParser parser;
+        EXPECT_EQ(parser.parse(input), RequestParser::Result::INVALID) << input;
+        EXPECT_EQ(parser.parse(input), RequestParser::Result::INVALID) << input;
+    }
+}
+
+TEST(HttpRequestParserTests, OversizedHeadRejected)
+{
+    std::string too_many_headers{ "GET / HTTP/1.1\r\n" };
+    for (size_t i = 0; i <= RequestParser::MAX_HEADERS; i++) too_many_headers += "Header: value\r\n";
+    too_many_headers += "\r\n";
+
+    std::string too_long_head{ "GET / HTTP/1.1\r\nHeader: " };
+    too_long_head += std::string(RequestParser::MAX_HEAD_SIZE, 'x');
+
+    RequestParser parser;
+    EXPECT_EQ(parser.parse(too_many_headers), RequestParser::Result::INVALID);
+    parser.reset();
+    EXPECT_EQ(parser.parse(too_long_head), RequestParser::Result::INVALID);
+}
+
+TEST(HttpRequestParserTests, ParsedInPlaceSameAsParsedFromStream)
+{
+    std::string input{
+        "GET /some/target/ HTTP/1.1\r\n"
+        "Host: www.hostname.com\r\n"
+        "Header: value-1, value-2, \tvalue-3\r\n"
+        "Connection: keep-alive\r\n"
+        "Header: value-4\r\n"
+        "\r\n"
+        "message_body" };
+    std::stringstream input_stream{ input };
+    RequestParser parser;
+
+    ASSERT_EQ(parser.parse(input), RequestParser::Result::COMPLETE);
+    // Without a Content-Length there is no body, what follows the head is the
+    // next request.
+    auto request = parser.request({});
+    auto expected = parse_request(input_stream);
+
+    ASSERT_TRUE(expected);
+    EXPECT_EQ(request.method, expected.value().method);
+    EXPECT_EQ(request.target, expected.value().target);
+    EXPECT_EQ(request.version, expected.value().version);
+    EXPECT_EQ(fields(request.headers), fields(expected.value().headers));
+    EXPECT_EQ(request.body, expected.value().body);
 }
 
 TEST(HttpResponseParserTests, _)
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "../../src/http/route_table.h"
+#include "../../src/common/common.h"
+
+using nimlib::Server::Handlers::Http::Router;
+using nimlib::Server::Handlers::Http::RouteTable;
+using nimlib::Server::Handlers::Http::Request;
+using nimlib::Server::Handlers::Http::Response;
+using nimlib::Server::Handlers::Http::named_handlers;
+using nimlib::Server::Handlers::Http::params_t;
+using nimlib::Server::Handlers::Http::load_router;
+using nimlib::Server::Constants::HandlerState;
+
+static auto body_handler(std::string body)
+{
+    return [body](const Request&, Response& response, params_t&) -> std::optional<HandlerState>
+        {
+            response.body = body;
+            return HandlerState::FINISHED_NO_WAIT;
+        };
+}
+
+static std::string route(const Router& router, std::string method, std::string target)
+{
+    Request request{};
+    request.method = method;
+    request.target = target;
+    Response response{};
+    router.route(request, response);
+    return response.body;
+}
+
+static std::shared_ptr<const Router> router_answering(std::string body)
+{
+    Router router{};
+    router.get("/", body_handler(body));
+    return std::make_shared<const Router>(std::move(router));
+}
+
+TEST(HttpRouteTable, LoadRouterFromConfiguration)
+{
+    named_handlers handlers{ {"hello", body_handler("hello")}, {"missing", body_handler("missing")} };
+    std::istringstream config{
+        "# comments and empty lines are skipped\n"
+        "\n"
+        "get /greeting hello\n"
+        "post /greeting/<name> hello\n"
+        "fallback missing\n"
+    };
+
+    auto router = load_router(config, handlers);
+
+    ASSERT_TRUE(router);
+    EXPECT_EQ(route(router.value(), "GET", "/greeting"), "hello");
+    EXPECT_EQ(route(router.value(), "POST", "/greeting/someone"), "hello");
+    EXPECT_EQ(route(router.value(), "GET", "/elsewhere"), "missing");
+}
+
+TEST(HttpRouteTable, LoadRouterRejectsBadConfiguration)
+{
+    named_handlers handlers{ {"hello", body_handler("hello")} };
+
+    for (std::string line : {
+        "get /greeting unknown_handler",
+        "get /greeting",
+        "get /greeting hello extra",
+        "put /greeting hello",
+        "fallback unknown_handler",
+        "static /file relative/path.jpg" })
+    {
+        std::istringstream config{ "get / hello\n" + line + "\n" };
+        EXPECT_FALSE(load_router(config, handlers)) << line;
+    }
+
+    EXPECT_FALSE(load_router("/this/file/does/not/exist", handlers));
+}
+
+TEST(HttpRouteTable, ReadersPickUpPublishedSnapshots)
+{
+    RouteTable table{ router_answering("first") };
+
+    std::shared_ptr<const Router> router;
+    uint64_t router_version{};
+    EXPECT_TRUE(table.refresh(router, router_version));
+    EXPECT_FALSE(table.refresh(router, router_version));
+    EXPECT_EQ(route(*router, "GET", "/"), "first");
+
+    table.publish(router_answering("second"));
+
+    // A reader still holding the old snapshot keeps routing with it until
+    // it asks for the new one.
+    EXPECT_EQ(route(*router, "GET", "/"), "first");
+    EXPECT_TRUE(table.refresh(router, router_version));
+    EXPECT_EQ(route(*router, "GET", "/"), "second");
+    EXPECT_EQ(router_version, table.version());
+    EXPECT_EQ(router, table.snapshot());
+}
+
+TEST(HttpRouteTable, OldSnapshotReleasedByLastReader)
+{
+    RouteTable table{ router_answering("first") };
+
+    std::shared_ptr<const Router> router;
+    uint64_t router_version{};
+    table.refresh(router, router_version);
+    std::weak_ptr<const Router> first{ router };
+
+    table.publish(router_answering("second"));
+    EXPECT_FALSE(first.expired());
+
+    table.refresh(router, router_version);
+    EXPECT_TRUE(first.expired());
+}
+
+TEST(HttpRouteTable, PublishWhileReading)
+{
+    RouteTable table{ router_answering("0") };
+    std::atomic<bool> publishing{ true };
+    const int SNAPSHOT_COUNT = 200;
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; i++)
+    {
+        readers.emplace_back([&table, &publishing]() {
+            std::shared_ptr<const Router> router;
+            uint64_t router_version{};
+            int last_seen{};
+
+            while (publishing.load())
+            {
+                table.refresh(router, router_version);
+                int seen = std::stoi(route(*router, "GET", "/"));
+                EXPECT_GE(seen, last_seen);
+                last_seen = seen;
+            }
+            });
+    }
+
+    for (int i = 1; i <= SNAPSHOT_COUNT; i++)
+    {
+        table.publish(router_answering(std::to_string(i)));
+    }
+    publishing.store(false);
+    for (auto& reader : readers) reader.join();
+
+    EXPECT_EQ(route(*table.snapshot(), "GET", "/"), std::to_string(SNAPSHOT_COUNT));
+}
@@ -2,16 +2,18 @@
 
 #include <unordered_map>
 #include <optional>
+#include <memory>
 
 #include "../../src/http/router.h"
 #include "../../src/common/common.h"
+#include "../support/temp_file.h"
 
 using nimlib::Server::Handlers::Http::Router;
 using nimlib::Server::Handlers::Http::Request;
 using nimlib::Server::Handlers::Http::Response;
 using nimlib::Server::Constants::HandlerState;
-using route_handler = std::function<std::optional<HandlerState>(const Request&, Response&, std::unordered_map<std::string, std::string>&)>;
-using params_t = std::unordered_map<std::string, std::string>;
+using nimlib::Server::Handlers::Http::params_t;
+using nimlib::Server::Handlers::Http::route_handler;
 
 TEST(HttpRouter, EmptyRouteRejected)
 {
@@ -671,3 +673,91 @@ TEST(HttpRouter, AddSubroutesWithParamsInTopAndSubRoute)
     EXPECT_EQ(captured_param_2, "sub_route_value");
     EXPECT_EQ(captured_param_3, "route_action");
 }
+
+TEST(HttpRouter, SharedReadOnlyRouter)
+{
+    Router router{};
+    int handler_invocations = 0;
+
+    route_handler handler = [&handler_invocations](const Request&, Response& response, params_t& params) -> std::optional<HandlerState>
+        {
+            handler_invocations++;
+            response.body = params["id"];
+            return HandlerState::FINISHED_NO_WAIT;
+        };
+    router.get("/items/<id>", handler);
+
+    // Once built, the routes are only ever used through a const snapshot.
+    std::shared_ptr<const Router> shared_router = std::make_shared<const Router>(std::move(router));
+
+    Request request_1{};
+    Response response_1{};
+    request_1.method = "GET";
+    request_1.target = "/items/1";
+
+    Request request_2{};
+    Response response_2{};
+    request_2.method = "GET";
+    request_2.target = "/items/2";
+
+    auto routing_result_1 = shared_router->route(request_1, response_1);
+    auto routing_result_2 = shared_router->route(request_2, response_2);
+
+    EXPECT_TRUE(routing_result_1);
+    EXPECT_TRUE(routing_result_2);
+    EXPECT_EQ(handler_invocations, 2);
+    EXPECT_EQ(response_1.body, "1");
+    EXPECT_EQ(response_2.body, "2");
+}
+
+TEST(HttpRouter, StaticFileSentOpen)
+{
+    auto path = nimlib::Tests::temp_file("not really a picture", ".jpg");
+    Router router{};
+    EXPECT_TRUE(router.serve_static("/picture", path));
+    EXPECT_TRUE(router.serve_static_big("/big_picture", path));
+    EXPECT_FALSE(router.serve_static("/missing", path + ".missing"));
+
+    {
+        Request request{};
+        Response response{};
+        request.method = "GET";
+        request.target = "/big_picture";
+
+        // The file is not read, the response carries it for the connection
+        // to send.
+        EXPECT_EQ(router.route(request, response), HandlerState::FINISHED_WAIT);
+        EXPECT_EQ(response.status, 200);
+        EXPECT_EQ(response.headers.get("content-type"), "image/jpeg");
+        EXPECT_EQ(response.body, "");
+        ASSERT_TRUE(response.file);
+        EXPECT_EQ(response.file->size(), 20);
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        Request request{};
+        Response response{};
+        request.method = "GET";
+        request.target = "/picture";
+
+        // A small file comes from the cache with its headers.
+        EXPECT_EQ(router.route(request, response), HandlerState::FINISHED_WAIT);
+        EXPECT_EQ(response.status, 200);
+        EXPECT_FALSE(response.file);
+        ASSERT_TRUE(response.shared_body);
+        EXPECT_EQ(*response.shared_body, "not really a picture");
+        ASSERT_TRUE(response.header_block);
+        EXPECT_TRUE(response.header_block->starts_with("content-type: image/jpeg\r\ncontent-length: 20\r\n"));
+    }
+
+    unlink(path.c_str());
+
+    Request request{};
+    Response response{};
+    request.method = "GET";
+    request.target = "/big_picture";
+    EXPECT_EQ(router.route(request, response), HandlerState::FINISHED_WAIT);
+    EXPECT_EQ(response.status, 404);
+    EXPECT_FALSE(response.file);
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include "../../src/http/headers.h"
+#include "../../src/http/serializer.h"
+#include "../../src/utils/output_queue.h"
+#include "../support/allocation_counter.h"
+
+using nimlib::Server::Handlers::Http::header_name;
+using nimlib::Server::Handlers::Http::KnownHeader;
+using nimlib::Server::Handlers::Http::reason_phrase;
+using nimlib::Server::Handlers::Http::response_head;
+using nimlib::Server::Handlers::Http::Response;
+using nimlib::Server::Handlers::Http::status_line;
+using nimlib::Server::Handlers::Http::write_response_head;
+using nimlib::Server::Utils::OutputQueue;
+
+// A response head without its Date header, which changes every second.
+static std::string undated_head(const Response& response)
+{
+    auto head = response_head(response);
+    auto date = head.find("date: ");
+    EXPECT_NE(date, std::string::npos);
+    return head.erase(date, head.find("\r\n", date) + 2 - date);
+}
+
+static Response ok_response(std::string body)
+{
+    Response response{};
+    response.status = 200;
+    response.reason = "OK";
+    response.body = std::move(body);
+    return response;
+}
+
+TEST(SerializerTests, StatusLines)
+{
+    EXPECT_EQ(status_line(200), "HTTP/1.1 200 OK\r\n");
+    EXPECT_EQ(status_line(404), "HTTP/1.1 404 Not Found\r\n");
+    EXPECT_EQ(status_line(299), "");
+    EXPECT_EQ(reason_phrase(416), "Range Not Satisfiable");
+    EXPECT_EQ(reason_phrase(299), "");
+
+    Response response = ok_response("");
+    response.status = 404;
+    response.reason = "Not found";
+    EXPECT_TRUE(response_head(response).starts_with("HTTP/1.1 404 Not found\r\n"));
+
+    response.reason.clear();
+    EXPECT_TRUE(response_head(response).starts_with("HTTP/1.1 404 Not Found\r\n"));
+
+    response.version = "HTTP/1.0";
+    EXPECT_TRUE(response_head(response).starts_with("HTTP/1.0 404 Not Found\r\n"));
+
+    response.status = 299;
+    response.reason = "Custom";
+    EXPECT_TRUE(response_head(response).starts_with("HTTP/1.0 299 Custom\r\n"));
+}
+
+TEST(SerializerTests, FieldsWrittenInOrderAsGiven)
+{
+    Response response = ok_response("ok");
+    response.headers.add("Vary", "accept-encoding, origin");
+    response.headers.add("x-request-id", "7");
+    response.headers.add("vary", "cookie");
+
+    EXPECT_EQ(undated_head(response), "HTTP/1.1 200 OK\r\nvary: accept-encoding, origin\r\nx-request-id: 7\r\nvary: cookie\r\ncontent-length: 2\r\n\r\n");
+}
+
+TEST(SerializerTests, ContentLengthAddedWhenBodyCanBeMeasured)
+{
+    Response response = ok_response("hello");
+    EXPECT_EQ(undated_head(response), "HTTP/1.1 200 OK\r\ncontent-length: 5\r\n\r\n");
+
+    response.shared_body = std::make_shared<const std::string>(1234, 'x');
+    EXPECT_EQ(undated_head(response), "HTTP/1.1 200 OK\r\ncontent-length: 1234\r\n\r\n");
+
+    // Given already, or not known up front.
+    response.headers.set("content-length", "1234");
+    EXPECT_EQ(undated_head(response), "HTTP/1.1 200 OK\r\ncontent-length: 1234\r\n\r\n");
+    response.headers.clear();
+    response.headers.set("transfer-encoding", "chunked");
+    EXPECT_EQ(undated_head(response), "HTTP/1.1 200 OK\r\ntransfer-encoding: chunked\r\n\r\n");
+
+    // Carried by the header block.
+    response.headers.clear();
+    response.header_block = std::make_shared<const std::string>("content-length: 1234\r\n");
+    EXPECT_EQ(undated_head(response), "HTTP/1.1 200 OK\r\ncontent-length: 1234\r\n\r\n");
+
+    // Responses that can not have a body.
+    for (short status : { 101, 204, 304 })
+    {
+        Response bodiless = ok_response("");
+        bodiless.status = status;
+        bodiless.reason.clear();
+        EXPECT_EQ(undated_head(bodiless), std::string(status_line(status)) + "\r\n") << status;
+    }
+}
+
+TEST(SerializerTests, DateAddedUnlessGiven)
+{
+    Response response = ok_response("");
+    auto head = response_head(response);
+    EXPECT_NE(head.find("\r\ndate: "), std::string::npos);
+    EXPECT_TRUE(head.ends_with(" GMT\r\n\r\n"));
+
+    response.headers.set("date", "Sun, 06 Nov 1994 08:49:37 GMT");
+    EXPECT_EQ(response_head(response), "HTTP/1.1 200 OK\r\ndate: Sun, 06 Nov 1994 08:49:37 GMT\r\ncontent-length: 0\r\n\r\n");
+}
+
+TEST(SerializerTests, HeadWrittenToQueueWithoutAllocating)
+{
+    Response response = ok_response("ok");
+    response.headers.set("content-type", "text/plain; charset=UTF-8");
+    response.headers.set("connection", "keep-alive");
+
+    OutputQueue queue{};
+    write_response_head(response, queue);
+    EXPECT_EQ(queue.str(), response_head(response));
+
+    // Once the queue's storage has grown, writing heads does not allocate.
+    queue.consume(queue.size());
+    auto allocations = nimlib::Tests::allocation_count();
+    for (int i = 0; i < 100; i++)
+    {
+        write_response_head(response, queue);
+        queue.consume(queue.size());
+    }
+    EXPECT_EQ(nimlib::Tests::allocation_count() - allocations, 0);
+}
+
+TEST(SerializerTests, KnownHeaderNames)
+{
+    EXPECT_EQ(header_name(KnownHeader::CONTENT_LENGTH), "content-length");
+    EXPECT_EQ(header_name(KnownHeader::VARY), "vary");
+    EXPECT_EQ(header_name(KnownHeader::ACCEPT_ENCODING), "accept-encoding");
+}
@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "../../src/http/static_file_cache.h"
+#include "../support/allocation_counter.h"
+#include "../support/temp_file.h"
+
+using nimlib::Server::Handlers::Http::StaticFileCache;
+
+using namespace std::chrono_literals;
+
+// Sets the modification time of the file at `path` to `seconds` past the epoch.
+static void set_modified(const std::string& path, time_t seconds)
+{
+    timespec times[2]{ { seconds, 0 }, { seconds, 0 } };
+    utimensat(AT_FDCWD, path.c_str(), times, 0);
+}
+
+TEST(StaticFileCacheTests, FileReadOnce)
+{
+    auto path = nimlib::Tests::temp_file("<p>hello</p>", ".html");
+    set_modified(path, 784111777);
+    StaticFileCache cache{};
+
+    auto first = cache.get(path, "text/html");
+    ASSERT_TRUE(first);
+    EXPECT_EQ(*first->bytes, "<p>hello</p>");
+    EXPECT_EQ(first->last_modified, "Sun, 06 Nov 1994 08:49:37 GMT");
+    EXPECT_EQ(*first->headers,
+        "content-type: text/html\r\n"
+        "content-length: 12\r\n"
+        "etag: " + first->etag + "\r\n"
+        "last-modified: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+        "accept-ranges: bytes\r\n");
+
+    auto second = cache.get(path, "text/html");
+    EXPECT_EQ(second, first);
+    EXPECT_EQ(cache.hits(), 1);
+    EXPECT_EQ(cache.misses(), 1);
+    EXPECT_EQ(cache.file_count(), 1);
+    EXPECT_GT(cache.size(), 12);
+
+    unlink(path.c_str());
+}
+
+TEST(StaticFileCacheTests, HitsDoNotAllocate)
+{
+    auto path = nimlib::Tests::temp_file("body { color: red; }", ".css");
+    StaticFileCache cache{};
+    ASSERT_TRUE(cache.get(path, "text/css"));
+
+    auto allocations = nimlib::Tests::allocation_count();
+    for (int i = 0; i < 1000; i++) cache.get(path, "text/css");
+
+    EXPECT_EQ(nimlib::Tests::allocation_count() - allocations, 0);
+    EXPECT_EQ(cache.hits(), 1000);
+
+    unlink(path.c_str());
+}
+
+TEST(StaticFileCacheTests, ChangedFileReadAgain)
+{
+    auto path = nimlib::Tests::temp_file("first", ".txt");
+    set_modified(path, 1000);
+    StaticFileCache cache{ StaticFileCache::DEFAULT_BYTE_BUDGET, StaticFileCache::DEFAULT_MAX_FILE_SIZE, 0ms };
+
+    auto first = cache.get(path, "text/plain");
+    ASSERT_TRUE(first);
+
+    // Same size, only the modification time tells it apart.
+    auto file = open(path.c_str(), O_WRONLY | O_TRUNC);
+    ASSERT_EQ(write(file, "later", 5), 5);
+    close(file);
+    set_modified(path, 2000);
+
+    auto second = cache.get(path, "text/plain");
+    ASSERT_TRUE(second);
+    EXPECT_EQ(*second->bytes, "later");
+    EXPECT_NE(second->etag, first->etag);
+    EXPECT_EQ(*first->bytes, "first");
+    EXPECT_EQ(cache.misses(), 2);
+    EXPECT_EQ(cache.file_count(), 1);
+
+    // Removed files are dropped.
+    unlink(path.c_str());
+    EXPECT_FALSE(cache.get(path, "text/plain"));
+    EXPECT_EQ(cache.file_count(), 0);
+    EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(StaticFileCacheTests, LeastRecentlyUsedEvicted)
+{
+    std::string contents(400, 'x');
+    auto a = nimlib::Tests::temp_file(contents);
+    auto b = nimlib::Tests::temp_file(contents);
+    auto c = nimlib::Tests::temp_file(contents);
+    StaticFileCache cache{ 1200, 1000 };
+
+    cache.get(a, "text/plain");
+    cache.get(b, "text/plain");
+    cache.get(a, "text/plain");
+    cache.get(c, "text/plain");
+
+    // b was used least recently and made room for c.
+    EXPECT_EQ(cache.file_count(), 2);
+    EXPECT_LE(cache.size(), 1200);
+    EXPECT_EQ(cache.misses(), 3);
+
+    cache.get(a, "text/plain");
+    cache.get(c, "text/plain");
+    EXPECT_EQ(cache.misses(), 3);
+    cache.get(b, "text/plain");
+    EXPECT_EQ(cache.misses(), 4);
+
+    for (const auto& path : { a, b, c }) unlink(path.c_str());
+}
+
+TEST(StaticFileCacheTests, HitsCountedAcrossThreads)
+{
+    auto path = nimlib::Tests::temp_file("hello");
+    StaticFileCache cache{};
+    auto cached = cache.get(path, "text/plain");
+    ASSERT_TRUE(cached);
+
+    std::vector<std::thread> threads{};
+    for (int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&cache, &path, &cached]()
+            {
+                for (int i = 0; i < 1000; i++) EXPECT_EQ(cache.get(path, "text/plain"), cached);
+            });
+    }
+    for (auto& thread : threads) thread.join();
+
+    EXPECT_EQ(cache.hits(), 4000);
+    EXPECT_EQ(cache.misses(), 1);
+
+    unlink(path.c_str());
+}
+
+TEST(StaticFileCacheTests, FileEvictedByAnotherThreadReadAgain)
+{
+    std::string contents(400, 'x');
+    auto a = nimlib::Tests::temp_file(contents);
+    auto b = nimlib::Tests::temp_file(contents);
+    auto c = nimlib::Tests::temp_file(contents);
+    StaticFileCache cache{ 1200, 1000 };
+
+    // a is in this thread's front, evicting it on another drops that.
+    cache.get(a, "text/plain");
+    std::thread{ [&cache, &b, &c]() { cache.get(b, "text/plain"); cache.get(c, "text/plain"); } }.join();
+    EXPECT_EQ(cache.misses(), 3);
+    EXPECT_EQ(cache.file_count(), 2);
+
+    cache.get(a, "text/plain");
+    EXPECT_EQ(cache.misses(), 4);
+
+    for (const auto& path : { a, b, c }) unlink(path.c_str());
+}
+
+TEST(StaticFileCacheTests, BigFilesNotCached)
+{
+    auto path = nimlib::Tests::temp_file(std::string(2000, 'x'));
+    StaticFileCache cache{ 10000, 1000 };
+
+    EXPECT_FALSE(cache.get(path, "text/plain"));
+    EXPECT_FALSE(cache.get("/no/such/file", "text/plain"));
+    EXPECT_EQ(cache.file_count(), 0);
+    EXPECT_EQ(cache.hits() + cache.misses(), 0);
+
+    unlink(path.c_str());
+}
+
+TEST(StaticFileCacheTests, MetricReport)
+{
+    auto path = nimlib::Tests::temp_file("hello");
+    StaticFileCache cache{};
+    cache.get(path, "text/plain");
+    cache.get(path, "text/plain");
+    cache.get(path, "text/plain");
+    cache.get(path, "text/plain");
+
+    auto metric = cache.metric();
+    EXPECT_EQ(metric->get_name(), "static_file_cache");
+
+    nimlib::Server::Metrics::Metric<long>::report_data_t report{};
+    metric->get_report(report);
+    ASSERT_EQ(report.size(), 5);
+    EXPECT_EQ(report[0], std::make_pair(std::string{ "hits" }, std::vector<long>{ 3 }));
+    EXPECT_EQ(report[1], std::make_pair(std::string{ "misses" }, std::vector<long>{ 1 }));
+    EXPECT_EQ(report[2], std::make_pair(std::string{ "hit_ratio_percent" }, std::vector<long>{ 75 }));
+    EXPECT_EQ(report[3], std::make_pair(std::string{ "bytes" }, std::vector<long>{ static_cast<long>(cache.size()) }));
+    EXPECT_EQ(report[4], std::make_pair(std::string{ "files" }, std::vector<long>{ 1 }));
+
+    unlink(path.c_str());
+}
@@ -0,0 +1,264 @@
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../../src/http/static_response.h"
+#include "../../src/utils/compression.h"
+#include "../../src/utils/open_file.h"
+#include "../support/temp_file.h"
+
+using nimlib::Server::Handlers::Http::answer_conditionally;
+using nimlib::Server::Handlers::Http::ByteRange;
+using nimlib::Server::Handlers::Http::choose_variant;
+using nimlib::Server::Handlers::Http::encoded_variants;
+using nimlib::Server::Handlers::Http::EncodedVariant;
+using nimlib::Server::Handlers::Http::entity_tag;
+using nimlib::Server::Handlers::Http::http_date;
+using nimlib::Server::Handlers::Http::parse_http_date;
+using nimlib::Server::Handlers::Http::parse_ranges;
+using nimlib::Server::Handlers::Http::Request;
+using nimlib::Server::Handlers::Http::Response;
+using nimlib::Server::Handlers::Http::Validators;
+
+static const std::string ETAG{ "\"2ebc3c21.0-64\"" };
+static const std::string LAST_MODIFIED{ "Sun, 06 Nov 1994 08:49:37 GMT" };
+static const Validators VALIDATORS{ ETAG, LAST_MODIFIED, 784111777 };
+
+using header_list = std::vector<std::pair<std::string, std::string>>;
+
+// A GET with the given headers.
+static Request request_with(const header_list& headers)
+{
+    Request request{};
+    request.method = "GET";
+    request.target = "/video";
+    for (const auto& [name, value] : headers) request.headers.add(name, value);
+    return request;
+}
+
+// Sets the modification time of the file at `path` to `seconds` past the epoch.
+static void set_modified(const std::string& path, time_t seconds)
+{
+    timespec times[2]{ { seconds, 0 }, { seconds, 0 } };
+    utimensat(AT_FDCWD, path.c_str(), times, 0);
+}
+
+static std::vector<std::pair<size_t, size_t>> pairs(const std::vector<ByteRange>& ranges)
+{
+    std::vector<std::pair<size_t, size_t>> result{};
+    for (const auto& range : ranges) result.emplace_back(range.first, range.last);
+    return result;
+}
+
+TEST(StaticResponseTests, Dates)
+{
+    EXPECT_EQ(http_date(784111777), LAST_MODIFIED);
+    EXPECT_EQ(parse_http_date(LAST_MODIFIED), 784111777);
+    EXPECT_EQ(parse_http_date("Sunday, 06-Nov-94 08:49:37 GMT"), 784111777);
+    EXPECT_EQ(parse_http_date("Sun Nov  6 08:49:37 1994"), 784111777);
+    EXPECT_FALSE(parse_http_date("yesterday"));
+    EXPECT_FALSE(parse_http_date("Sun, 06 Nov 1994 08:49:37 GMT and then some"));
+}
+
+TEST(StaticResponseTests, EntityTagFollowsFile)
+{
+    auto tag = entity_tag(100, { 784111777, 0 });
+    EXPECT_EQ(tag.front(), '"');
+    EXPECT_EQ(tag.back(), '"');
+    EXPECT_NE(tag, entity_tag(101, { 784111777, 0 }));
+    EXPECT_NE(tag, entity_tag(100, { 784111777, 1 }));
+}
+
+TEST(StaticResponseTests, Ranges)
+{
+    using ranges_t = std::vector<std::pair<size_t, size_t>>;
+
+    EXPECT_EQ(pairs(*parse_ranges("bytes=0-9", 100)), (ranges_t{ { 0, 9 } }));
+    EXPECT_EQ(pairs(*parse_ranges("bytes=90-", 100)), (ranges_t{ { 90, 99 } }));
+    EXPECT_EQ(pairs(*parse_ranges("bytes=-10", 100)), (ranges_t{ { 90, 99 } }));
+    EXPECT_EQ(pairs(*parse_ranges("bytes=-500", 100)), (ranges_t{ { 0, 99 } }));
+    EXPECT_EQ(pairs(*parse_ranges("bytes=50-500", 100)), (ranges_t{ { 50, 99 } }));
+    EXPECT_EQ(pairs(*parse_ranges("bytes=0-0, 10-19 ,-1", 100)), (ranges_t{ { 0, 0 }, { 10, 19 }, { 99, 99 } }));
+
+    // Ranges past the end are left out, with none left nothing can be sent.
+    EXPECT_EQ(pairs(*parse_ranges("bytes=0-9,100-200", 100)), (ranges_t{ { 0, 9 } }));
+    EXPECT_TRUE(parse_ranges("bytes=100-", 100)->empty());
+    EXPECT_TRUE(parse_ranges("bytes=-0", 100)->empty());
+
+    // Headers not understood are ignored.
+    for (auto value : { "items=0-9", "bytes=", "bytes=9-0", "bytes=a-b", "bytes=5", "bytes=0-9,x" })
+    {
+        EXPECT_FALSE(parse_ranges(value, 100)) << value;
+    }
+
+    std::string many{ "bytes=0-0" };
+    for (int i = 1; i <= 16; i++) many += "," + std::to_string(i) + "-" + std::to_string(i);
+    EXPECT_FALSE(parse_ranges(many, 100));
+}
+
+TEST(StaticResponseTests, NotModified)
+{
+    for (const auto& headers : std::vector<header_list>{
+        { { "if-none-match", ETAG } },
+        { { "if-none-match", "\"other\", W/" + ETAG } },
+        { { "if-none-match", "*" } },
+        { { "if-modified-since", "Sun, 06 Nov 1994 08:49:37 GMT" } },
+        { { "if-modified-since", "Mon, 07 Nov 1994 08:49:37 GMT" } } })
+    {
+        Response response{};
+        EXPECT_TRUE(answer_conditionally(request_with(headers), response, VALIDATORS, 100, "video/mp4"));
+        EXPECT_EQ(response.status, 304);
+        EXPECT_EQ(response.headers.get("etag"), ETAG);
+        EXPECT_EQ(response.headers.get("last-modified"), LAST_MODIFIED);
+        EXPECT_TRUE(response.ranges.empty());
+    }
+
+    // If-None-Match decides on its own when it is there.
+    for (const auto& headers : std::vector<header_list>{
+        { { "if-none-match", "\"other\"" } },
+        { { "if-none-match", "\"other\"" }, { "if-modified-since", "Mon, 07 Nov 1994 08:49:37 GMT" } },
+        { { "if-modified-since", "Sat, 05 Nov 1994 08:49:37 GMT" } },
+        { { "if-modified-since", "not a date" } } })
+    {
+        Response response{};
+        EXPECT_FALSE(answer_conditionally(request_with(headers), response, VALIDATORS, 100, "video/mp4"));
+    }
+}
+
+TEST(StaticResponseTests, SingleRange)
+{
+    Response response{};
+    EXPECT_TRUE(answer_conditionally(request_with({ { "range", "bytes=10-19" } }), response, VALIDATORS, 100, "video/mp4"));
+
+    EXPECT_EQ(response.status, 206);
+    EXPECT_EQ(response.headers.get("content-type"), "video/mp4");
+    EXPECT_EQ(response.headers.get("content-range"), "bytes 10-19/100");
+    ASSERT_EQ(response.ranges.size(), 1);
+    EXPECT_EQ(response.ranges[0].head, "");
+    EXPECT_EQ(response.ranges[0].offset, 10);
+    EXPECT_EQ(response.ranges[0].size, 10);
+    EXPECT_EQ(response.body, "");
+}
+
+TEST(StaticResponseTests, MultipleRanges)
+{
+    Response response{};
+    EXPECT_TRUE(answer_conditionally(request_with({ { "range", "bytes=0-4, -5" } }), response, VALIDATORS, 100, "video/mp4"));
+
+    EXPECT_EQ(response.status, 206);
+    ASSERT_TRUE(response.headers.contains("content-type"));
+    std::string content_type{ *response.headers.get("content-type") };
+    ASSERT_TRUE(content_type.starts_with("multipart/byteranges; boundary="));
+    auto boundary = content_type.substr(content_type.find('=') + 1);
+
+    ASSERT_EQ(response.ranges.size(), 2);
+    EXPECT_EQ(response.ranges[0].head, "\r\n--" + boundary + "\r\ncontent-type: video/mp4\r\ncontent-range: bytes 0-4/100\r\n\r\n");
+    EXPECT_EQ(response.ranges[0].offset, 0);
+    EXPECT_EQ(response.ranges[0].size, 5);
+    EXPECT_EQ(response.ranges[1].head, "\r\n--" + boundary + "\r\ncontent-type: video/mp4\r\ncontent-range: bytes 95-99/100\r\n\r\n");
+    EXPECT_EQ(response.ranges[1].offset, 95);
+    EXPECT_EQ(response.ranges[1].size, 5);
+    EXPECT_EQ(response.body, "\r\n--" + boundary + "--\r\n");
+}
+
+TEST(StaticResponseTests, RangeNotSatisfiable)
+{
+    Response response{};
+    EXPECT_TRUE(answer_conditionally(request_with({ { "range", "bytes=200-" } }), response, VALIDATORS, 100, "video/mp4"));
+
+    EXPECT_EQ(response.status, 416);
+    EXPECT_EQ(response.headers.get("content-range"), "bytes */100");
+    EXPECT_TRUE(response.ranges.empty());
+}
+
+TEST(StaticResponseTests, IfRange)
+{
+    // The range is only sent if the client's part is of the current file,
+    // otherwise the whole file is.
+    for (auto [if_range, partial] : std::vector<std::pair<std::string, bool>>{
+        { ETAG, true },
+        { "Sun, 06 Nov 1994 08:49:37 GMT", true },
+        { "\"other\"", false },
+        { "W/" + ETAG, false },
+        { "Mon, 07 Nov 1994 08:49:37 GMT", false } })
+    {
+        Response response{};
+        auto request = request_with({ { "range", "bytes=10-19" }, { "if-range", if_range } });
+        EXPECT_EQ(answer_conditionally(request, response, VALIDATORS, 100, "video/mp4"), partial) << if_range;
+    }
+}
+
+TEST(StaticResponseTests, VariantChosenByAcceptEncoding)
+{
+    const std::vector<EncodedVariant> variants{ { "br", "/a.txt.br" }, { "gzip", "/a.txt.gz" } };
+
+    for (auto [codings, expected] : std::vector<std::pair<std::string, std::string>>{
+        { "gzip, br", "br" },
+        { "gzip;q=1, br;q=0.5", "gzip" },
+        { "br;q=0 ,gzip", "gzip" },
+        { "X-GZIP", "gzip" },
+        { "deflate,*", "br" },
+        { "*;q=0.2, gzip;q=0.3", "gzip" },
+        { "br;q=0, gzip;q=0", "" },
+        { "br;q=2x", "" },
+        { "identity", "" } })
+    {
+        auto variant = choose_variant(request_with({ { "accept-encoding", codings } }), variants);
+        EXPECT_EQ(variant ? variant->encoding : "", expected) << codings;
+    }
+
+    // Codings listed over more than one field.
+    auto variant = choose_variant(request_with({ { "accept-encoding", "gzip;q=0.5" }, { "Accept-Encoding", "br" } }), variants);
+    EXPECT_EQ(variant ? variant->encoding : "", "br");
+
+    EXPECT_FALSE(choose_variant(request_with({}), variants));
+    EXPECT_FALSE(choose_variant(request_with({ { "accept-encoding", "gzip" } }), {}));
+}
+
+TEST(StaticResponseTests, VariantsFoundNextToFile)
+{
+    auto path = nimlib::Tests::temp_file(std::string(4096, 'a'), ".txt");
+    set_modified(path, 2000);
+
+    // A copy older than the file is not used.
+    std::string br_path{ path + ".br" };
+    std::string zst_path{ path + ".zst" };
+    close(open(br_path.c_str(), O_WRONLY | O_CREAT, 0644));
+    close(open(zst_path.c_str(), O_WRONLY | O_CREAT, 0644));
+    set_modified(br_path, 3000);
+    set_modified(zst_path, 1000);
+
+    auto variants = encoded_variants(path, "text/plain");
+    std::vector<std::string> encodings{};
+    for (const auto& variant : variants) encodings.push_back(variant.encoding);
+
+    if (nimlib::Server::Utils::gzip_available())
+    {
+        // The missing gzip copy is written when the file is registered.
+        EXPECT_EQ(encodings, (std::vector<std::string>{ "br", "gzip" }));
+        ASSERT_EQ(variants.size(), 2);
+        EXPECT_EQ(variants[1].path, path + ".gz");
+
+        auto gzipped = nimlib::Server::Utils::OpenFile::open(path + ".gz");
+        ASSERT_TRUE(gzipped);
+        EXPECT_LT(gzipped->size(), 4096);
+        unsigned char magic[2]{};
+        gzipped->read(0, reinterpret_cast<char*>(magic), 2);
+        EXPECT_EQ(magic[0], 0x1f);
+        EXPECT_EQ(magic[1], 0x8b);
+    }
+    else
+    {
+        EXPECT_EQ(encodings, std::vector<std::string>{ "br" });
+    }
+
+    // Content already compressed is not compressed again.
+    auto picture = nimlib::Tests::temp_file(std::string(4096, 'a'), ".jpg");
+    EXPECT_TRUE(encoded_variants(picture, "image/jpeg").empty());
+
+    for (const auto& file : { path, br_path, zst_path, path + ".gz", picture }) unlink(file.c_str());
+}
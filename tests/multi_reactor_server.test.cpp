@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "../src/multi_reactor_server.h"
+#include "../src/tcp_connection_pool.h"
+#include "../src/metrics/metrics_store.h"
+
+using nimlib::Server::MultiReactorServer;
+using nimlib::Server::TcpConnectionPool;
+using nimlib::Server::Types::Server;
+
+struct RecordingServer : public Server
+{
+    RecordingServer(std::mutex& lock, std::set<std::thread::id>& threads, std::set<void*>& pools, std::set<void*>& stores)
+        : lock{ lock }, threads{ threads }, pools{ pools }, stores{ stores }
+    {}
+
+    void run() override
+    {
+        std::lock_guard guard{ lock };
+        threads.insert(std::this_thread::get_id());
+        pools.insert(&TcpConnectionPool::get_pool());
+        stores.insert(&nimlib::Server::Metrics::MetricsStore<long>::get_instance());
+    }
+
+    std::mutex& lock;
+    std::set<std::thread::id>& threads;
+    std::set<void*>& pools;
+    std::set<void*>& stores;
+};
+
+TEST(MultiReactorServerTest, EveryReactorRunsOnItsOwnThreadWithItsOwnState)
+{
+    std::mutex lock;
+    std::set<std::thread::id> threads;
+    std::set<void*> pools;
+    std::set<void*> stores;
+
+    MultiReactorServer server{ 4, [&]() {
+        return std::make_unique<RecordingServer>(lock, threads, pools, stores);
+        } };
+    server.run();
+
+    EXPECT_EQ(threads.size(), 4);
+    EXPECT_EQ(threads.count(std::this_thread::get_id()), 0);
+    EXPECT_EQ(pools.size(), 4);
+    EXPECT_EQ(stores.size(), 4);
+}
+
+TEST(MultiReactorServerTest, AtLeastOneReactor)
+{
+    int created{ 0 };
+
+    MultiReactorServer server{ 0, [&]() {
+        created++;
+        return std::unique_ptr<Server>{};
+        } };
+    server.run();
+
+    EXPECT_EQ(created, 1);
+}
@@ -0,0 +1,75 @@
+#include "allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    thread_local size_t allocations{ 0 };
+
+    void* counted_allocation(size_t size)
+    {
+        allocations++;
+        if (size == 0) size = 1;
+
+        if (void* pointer = std::malloc(size)) return pointer;
+        throw std::bad_alloc{};
+    }
+
+    // The aligned forms are the ones std::pmr::new_delete_resource() calls.
+    void* counted_allocation(size_t size, std::align_val_t alignment)
+    {
+        allocations++;
+        auto align = static_cast<size_t>(alignment);
+        size = (size + align - 1) / align * align;
+        if (size == 0) size = align;
+
+        if (void* pointer = std::aligned_alloc(align, size)) return pointer;
+        throw std::bad_alloc{};
+    }
+};
+
+namespace nimlib::Tests
+{
+    size_t allocation_count() { return allocations; }
+};
+
+void* operator new(size_t size) { return counted_allocation(size); }
+
+void* operator new[](size_t size) { return counted_allocation(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try { return counted_allocation(size); }
+    catch (...) { return nullptr; }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    try { return counted_allocation(size); }
+    catch (...) { return nullptr; }
+}
+
+void* operator new(size_t size, std::align_val_t alignment) { return counted_allocation(size, alignment); }
+
+void* operator new[](size_t size, std::align_val_t alignment) { return counted_allocation(size, alignment); }
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+
+void operator delete[](void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { std::free(pointer); }
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { std::free(pointer); }
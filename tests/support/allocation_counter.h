@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+namespace nimlib::Tests
+{
+    // How many times the calling thread has called the global operator new.
+    // Linking allocation_counter.cpp into a test binary replaces the global
+    // operators to count them, a test can then check that some code does not
+    // allocate by comparing the count before and after running it.
+    size_t allocation_count();
+};
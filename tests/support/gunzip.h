@@ -0,0 +1,45 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#ifdef NIMLIB_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+namespace nimlib::Tests
+{
+    // Decompresses a gzip stream, nothing is returned when it is not one or
+    // when the tests are built without zlib. With `partial`, a stream that
+    // has not ended yet is accepted.
+    inline std::optional<std::string> gunzip(std::string_view compressed, bool partial = false)
+    {
+#ifdef NIMLIB_WITH_ZLIB
+        z_stream stream{};
+        if (inflateInit2(&stream, 15 + 16) != Z_OK) return {};
+
+        std::string output{};
+        char buffer[16384];
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+        stream.avail_in = compressed.size();
+
+        int result = Z_OK;
+        while (result == Z_OK)
+        {
+            stream.next_out = reinterpret_cast<Bytef*>(buffer);
+            stream.avail_out = sizeof(buffer);
+            result = inflate(&stream, Z_NO_FLUSH);
+            output.append(buffer, sizeof(buffer) - stream.avail_out);
+            if (result == Z_OK && stream.avail_in == 0 && stream.avail_out > 0) break;
+        }
+        inflateEnd(&stream);
+
+        bool ended = result == Z_STREAM_END && stream.avail_in == 0;
+        if (!ended && !(partial && (result == Z_OK || result == Z_BUF_ERROR))) return {};
+        return output;
+#else
+        return {};
+#endif
+    }
+};
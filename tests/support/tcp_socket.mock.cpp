@@ -4,6 +4,7 @@
 #include <sstream>
 #include <cstdlib>
 #include <ctime>
+#include <unistd.h>
 
 #include "tcp_socket.mock.h"
 
@@ -71,7 +72,11 @@ namespace nimlib::Server::Sockets
 
     int MockTcpSocket::tcp_send(std::span<uint8_t> buffer)
     {
-        if (total_socket_write_count > max_bytes_to_write * 4) return -1;
+        if (total_socket_write_count > max_bytes_to_write * 4)
+        {
+            errno = send_error;
+            return -1;
+        }
 
         int bytes_to_send = buffer.size() <= max_bytes_to_write
             ? buffer.size()
@@ -95,6 +100,49 @@ namespace nimlib::Server::Sockets
         return tcp_send(s);
     }
 
+    int MockTcpSocket::tcp_send(std::span<const iovec> buffers, bool more)
+    {
+        if (total_socket_write_count > max_bytes_to_write * 4)
+        {
+            errno = send_error;
+            return -1;
+        }
+
+        // Like a single send, no more than max_bytes_to_write bytes go out
+        // across all the buffers.
+        int bytes_sent = 0;
+        for (const auto& buffer : buffers)
+        {
+            auto bytes = static_cast<const char*>(buffer.iov_base);
+            for (size_t i = 0; i < buffer.iov_len && bytes_sent < max_bytes_to_write; i++, bytes_sent++)
+            {
+                write_result << bytes[i];
+            }
+        }
+
+        total_socket_write_count += bytes_sent;
+
+        return bytes_sent;
+    }
+
+    int MockTcpSocket::tcp_send_file(int file_descriptor, size_t offset, size_t count)
+    {
+        if (total_socket_write_count > max_bytes_to_write * 4)
+        {
+            errno = send_error;
+            return -1;
+        }
+
+        std::string bytes(std::min<size_t>(count, max_bytes_to_write), '\0');
+        auto copied = pread(file_descriptor, bytes.data(), bytes.size(), offset);
+        if (copied <= 0) return -1;
+
+        write_result << bytes.substr(0, copied);
+        total_socket_write_count += copied;
+
+        return copied;
+    }
+
     void MockTcpSocket::tcp_close() {}
 
     const int MockTcpSocket::get_tcp_socket_descriptor() const { return tcp_socket_descriptor; }
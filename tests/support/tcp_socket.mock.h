@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cerrno>
 #include <sstream>
 #include <string>
 
@@ -25,6 +26,8 @@ namespace nimlib::Server::Sockets
         int tcp_read(std::span<uint8_t> buffer, int flags) override;
         int tcp_send(std::span<uint8_t> buffer) override;
         int tcp_send(std::string_view buffer) override;
+        int tcp_send(std::span<const iovec> buffers, bool more) override;
+        int tcp_send_file(int file_descriptor, size_t offset, size_t count) override;
         void tcp_close() override;  // TODO: may never be used
         const int get_tcp_socket_descriptor() const override;
         const std::string& get_port() const override;
@@ -41,6 +44,9 @@ namespace nimlib::Server::Sockets
         // the socket fails.
         const int max_bytes_to_read;
         const int max_bytes_to_write;
+        // What errno is set to when writing fails, by default the socket is
+        // only full and can be written to again.
+        int send_error{ EAGAIN };
         // The vector below can be used to mimic the scenario of reading
         // different bytes count on each call to the tcp_read method.
         std::vector<int> byte_counts_to_read{};
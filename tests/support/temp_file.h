@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+namespace nimlib::Tests
+{
+    // Creates a file holding `contents` and returns its absolute path. The
+    // suffix lets the router tell its content type.
+    inline std::string temp_file(std::string_view contents, const std::string& suffix = "")
+    {
+        std::string path{ "/tmp/nimlib_test_XXXXXX" + suffix };
+        int file_descriptor = mkstemps(path.data(), suffix.size());
+        if (file_descriptor < 0) return {};
+
+        for (size_t written = 0; written < contents.size();)
+        {
+            auto count = write(file_descriptor, contents.data() + written, contents.size() - written);
+            if (count <= 0) break;
+            written += count;
+        }
+
+        close(file_descriptor);
+        return path;
+    }
+};
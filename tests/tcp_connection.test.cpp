@@ -1,10 +1,15 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "../src/common/types.h"
 #include "../src/tcp_connection.h"
+#include "support/allocation_counter.h"
 #include "support/tcp_socket.mock.h"
+#include "support/temp_file.h"
 
 using nimlib::Server::TcpConnection;
 using nimlib::Server::Sockets::MockTcpSocket;
@@ -14,6 +19,8 @@ using nimlib::Server::Types::StreamsProvider;
 using nimlib::Server::Constants::HandlerState;
 using nimlib::Server::Constants::ServerDirective;
 using nimlib::Server::Constants::ConnectionState;
+using nimlib::Server::Utils::ByteBuffer;
+using nimlib::Server::Utils::OutputQueue;
 
 struct MockHandler : public Handler
 {
@@ -36,16 +43,22 @@ struct MockHandler : public Handler
     {
         read_attempts_so_far++;
 
-        // Pretend we have used the input stream.
-        char c;
-        while (in >> c)
-        {
-            internal_input += c;
-            if (output_result.empty()) out << c;
-        }
+        // Pretend we have used the input, leaving it in the buffer.
+        auto unseen = in.readable().substr(seen);
+        internal_input += unseen;
+        if (output_result.empty()) out << unseen;
+        seen += unseen.size();
 
         out << output_result;
 
+        // A handler keeping the connection alive is done with the request it
+        // answers, only what follows it is left for the next one.
+        if (wants_to_write() && wants_to_live())
+        {
+            in.consume(seen);
+            seen = 0;
+        }
+
         connection.notify(*this);
     }
 
@@ -61,8 +74,9 @@ struct MockHandler : public Handler
 
     HandlerState get_state() override { return state_manager.get_state(); }
 
-    std::stringstream& in;
-    std::stringstream& out;
+    ByteBuffer& in;
+    OutputQueue& out;
+    size_t seen{ 0 };
     HandlerState handler_state;
     std::string output_result;
     std::string internal_input{};
@@ -70,6 +84,88 @@ struct MockHandler : public Handler
     int read_attempts_so_far{ 0 };
 };
 
+// Reads one fixed size request per call, like a handler answering the
+// first of several requests a client has pipelined.
+struct PipelinedRequestsHandler : public Handler
+{
+    PipelinedRequestsHandler(StreamsProvider& streams, int request_size)
+        : in{ streams.source() }, out{ streams.sink() }, request_size{ request_size }
+    {};
+    ~PipelinedRequestsHandler() = default;
+
+    void notify(Connection& connection, StreamsProvider& streams) override
+    {
+        auto request = in.readable().substr(0, request_size);
+        requests.emplace_back(request);
+        in.consume(request.size());
+        out << "response";
+
+        connection.notify(*this);
+    }
+
+    void notify(Handler& handler, Connection& connection, StreamsProvider& streams) override {}
+
+    bool wants_more_bytes() override { return false; }
+
+    bool wants_to_write() override { return false; }
+
+    bool wants_to_live() override { return true; }
+
+    bool wants_to_be_calledback() override { return false; }
+
+    HandlerState get_state() override { return state_manager.get_state(); }
+
+    ByteBuffer& in;
+    OutputQueue& out;
+    int request_size;
+    std::vector<std::string> requests{};
+};
+
+// Reads and forgets every request, waiting for the next one.
+struct DiscardingHandler : public Handler
+{
+    DiscardingHandler(StreamsProvider& streams) : in{ streams.source() } {};
+    ~DiscardingHandler() = default;
+
+    void notify(Connection& connection, StreamsProvider& streams) override
+    {
+        bytes_read += in.size();
+        in.consume(in.size());
+
+        connection.notify(*this);
+    }
+
+    void notify(Handler& handler, Connection& connection, StreamsProvider& streams) override {}
+
+    bool wants_more_bytes() override { return true; }
+
+    bool wants_to_write() override { return false; }
+
+    bool wants_to_live() override { return false; }
+
+    bool wants_to_be_calledback() override { return false; }
+
+    HandlerState get_state() override { return state_manager.get_state(); }
+
+    ByteBuffer& in;
+    size_t bytes_read{ 0 };
+};
+
+// Has the same request to give on every read.
+struct RepeatingRequestSocket : public MockTcpSocket
+{
+    RepeatingRequestSocket(std::string_view request) : MockTcpSocket{ 1 }, request{ request } {}
+
+    int tcp_read(std::span<uint8_t> buffer, int flags) override
+    {
+        auto count = std::min(buffer.size(), request.size());
+        std::copy_n(request.begin(), count, buffer.begin());
+        return count;
+    }
+
+    std::string_view request;
+};
+
 TEST(ConnectionTests, Read_WithEnoughBuffer_SingleRead)
 {
     /*
@@ -92,7 +188,7 @@ TEST(ConnectionTests, Read_WithEnoughBuffer_SingleRead)
     connection.notify(ServerDirective::READ_SOCKET);
 
     auto state_1 = connection.get_state();
-    EXPECT_EQ(connection.source().str().size(), 470);
+    EXPECT_EQ(connection.source().size(), 470);
     EXPECT_EQ(pointer_to_socket->read_result.str(), handler->internal_input);
     EXPECT_EQ(state_1, ConnectionState::READY_TO_WRITE);
 
@@ -126,21 +222,21 @@ TEST(ConnectionTests, Read_WithEnoughBuffer_MultipleReads)
 
     auto state_1 = connection.get_state();
     EXPECT_EQ(state_1, ConnectionState::READY_TO_READ);
-    EXPECT_EQ(connection.source().str().size(), 129);
+    EXPECT_EQ(connection.source().size(), 129);
     EXPECT_EQ(pointer_to_socket->read_result.str(), handler->internal_input);
 
     connection.notify(ServerDirective::READ_SOCKET);
 
     auto state_2 = connection.get_state();
     EXPECT_EQ(state_2, ConnectionState::READY_TO_READ);
-    EXPECT_EQ(connection.source().str().size(), 129 + 131);
+    EXPECT_EQ(connection.source().size(), 129 + 131);
     EXPECT_EQ(pointer_to_socket->read_result.str(), handler->internal_input);
 
     connection.notify(ServerDirective::READ_SOCKET);
 
     auto state_3 = connection.get_state();
     EXPECT_EQ(state_3, ConnectionState::READY_TO_WRITE);
-    EXPECT_EQ(connection.source().str().size(), 129 + 131 + 257);
+    EXPECT_EQ(connection.source().size(), 129 + 131 + 257);
     EXPECT_EQ(pointer_to_socket->read_result.str(), handler->internal_input);
 
     connection.notify(ServerDirective::WRITE_SOCKET);
@@ -157,8 +253,7 @@ TEST(ConnectionTests, Read_WithExactlyEnoughBuffer)
     the TcpConnection object will be ConnectionState::READY_TO_WRITE.
     */
 
-    auto socket = std::make_unique<MockTcpSocket>(1, 1024, 1024);
-    socket->byte_counts_to_read = { 10 };
+    auto socket = std::make_unique<MockTcpSocket>(1, 10, 1024);
     MockTcpSocket* pointer_to_socket = socket.get();
     TcpConnection connection{ std::move(socket), 1, 10 };
     auto handler = std::make_shared<MockHandler>(connection, 1, HandlerState::FINISHED_NO_WAIT);
@@ -168,55 +263,63 @@ TEST(ConnectionTests, Read_WithExactlyEnoughBuffer)
 
     auto state = connection.get_state();
     EXPECT_EQ(state, ConnectionState::READY_TO_WRITE);
-    EXPECT_EQ(connection.source().str().size(), 10);
+    EXPECT_EQ(connection.source().size(), 10);
     EXPECT_EQ(pointer_to_socket->read_result.str(), handler->internal_input);
 }
 
 TEST(ConnectionTests, Read_WithSmallBuffer)
 {
     /*
-    When the TcpConnection object has a small buffer, ie., all the data the
-    application requires cannot be read by the object at once, the handler
-    object is expected to report incomplete data (HandlerState::INCOMPLETE_INPUT)
-    and the TcpConnection object will try to read more data from the socket.
-
-    Let's say the handler object needs 470 bytes to process but the TcpConnection
-    object has a buffer of only 167 bytes (all completely arbitrary). Since
-    470 / 167 ~= 2.8, the handler needs to ask the TcpConnection to read the
-    socket 3 times to get all the required 470 bytes.
+    When the TcpConnection object has a small buffer, ie., all the data
+    available on the socket cannot be read by the object at once, the
+    connection reads the socket again into more space until the socket is
+    drained, before handing the data to the handler.
+
+    Let's say the socket has 470 bytes but the TcpConnection object reads at
+    least 167 bytes at a time (all completely arbitrary). Since 470 / 167 ~= 2.8,
+    the connection reads the socket 3 times and the handler gets all the 470
+    bytes at once.
     */
 
     auto socket = std::make_unique<MockTcpSocket>(1, 470, 1024);
     MockTcpSocket* pointer_to_socket = socket.get();
+    socket->byte_counts_to_read = { 167, 167, 167 };
     TcpConnection connection{ std::move(socket), 1, 167 };
-    auto handler = std::make_shared<MockHandler>(connection, 3, HandlerState::FINISHED_NO_WAIT);
+    auto handler = std::make_shared<MockHandler>(connection, 1, HandlerState::FINISHED_NO_WAIT);
     connection.set_handler(handler);
 
     connection.notify(ServerDirective::READ_SOCKET);
 
     auto state_1 = connection.get_state();
-    EXPECT_EQ(state_1, ConnectionState::READY_TO_READ);
-    EXPECT_EQ(connection.source().str().size(), 167);
+    EXPECT_EQ(state_1, ConnectionState::READY_TO_WRITE);
+    EXPECT_EQ(pointer_to_socket->read_sequence, 3);
+    EXPECT_EQ(handler->read_attempts_so_far, 1);
+    EXPECT_EQ(connection.source().size(), 470);
     EXPECT_EQ(pointer_to_socket->read_result.str(), handler->internal_input);
 
-    connection.notify(ServerDirective::READ_SOCKET);
+    connection.notify(ServerDirective::WRITE_SOCKET);
 
     auto state_2 = connection.get_state();
-    EXPECT_EQ(state_2, ConnectionState::READY_TO_READ);
-    EXPECT_EQ(connection.source().str().size(), 167 + 167);
-    EXPECT_EQ(pointer_to_socket->read_result.str(), handler->internal_input);
+    EXPECT_EQ(state_2, ConnectionState::DONE);
+}
 
-    connection.notify(ServerDirective::READ_SOCKET);
+TEST(ConnectionTests, Read_NoAllocationsOnceWarm)
+{
+    std::string_view request{ "GET /index.html HTTP/1.1\r\nHost: localhost\r\nAccept: */*\r\n\r\n" };
+    TcpConnection connection{ std::make_unique<RepeatingRequestSocket>(request), 1, 1024 };
+    auto handler = std::make_shared<DiscardingHandler>(connection);
+    connection.set_handler(handler);
 
-    auto state_3 = connection.get_state();
-    EXPECT_EQ(state_3, ConnectionState::READY_TO_WRITE);
-    EXPECT_EQ(connection.source().str().size(), 470);
-    EXPECT_EQ(pointer_to_socket->read_result.str(), handler->internal_input);
+    // The first read sizes the input buffer, the next ones reuse it.
+    connection.notify(ServerDirective::READ_SOCKET);
+    EXPECT_EQ(connection.get_state(), ConnectionState::READY_TO_READ);
 
-    connection.notify(ServerDirective::WRITE_SOCKET);
+    auto allocations = nimlib::Tests::allocation_count();
+    for (int i = 0; i < 1000; i++) connection.notify(ServerDirective::READ_SOCKET);
 
-    auto state_4 = connection.get_state();
-    EXPECT_EQ(state_4, ConnectionState::DONE);
+    EXPECT_EQ(nimlib::Tests::allocation_count() - allocations, 0);
+    EXPECT_EQ(handler->bytes_read, request.size() * 1001);
+    EXPECT_EQ(connection.get_state(), ConnectionState::READY_TO_READ);
 }
 
 TEST(ConnectionTests, Read_ConnectionStateWhenSocketNotReady)
@@ -290,6 +393,92 @@ TEST(ConnectionTests, Write_ConnectionKeepAlive)
     EXPECT_EQ(pointer_to_socket->write_result.str(), "HTTP/1.1 404 Not Found");
 }
 
+TEST(ConnectionTests, Write_ConnectionKeepAlive_WithPipelinedRequests)
+{
+    /*
+    The client has sent two requests in one go. Once the response to the first
+    one is written, the second one is handled straight away, without waiting
+    for the socket to have more to read.
+    */
+    auto s = std::make_unique<MockTcpSocket>(1, 100);
+    auto pointer_to_socket = s.get();
+    TcpConnection connection{ std::move(s), 1, 100 };
+    auto handler = std::make_shared<PipelinedRequestsHandler>(connection, 60);
+    connection.set_handler(handler);
+
+    connection.notify(ServerDirective::READ_SOCKET);
+    connection.notify(ServerDirective::WRITE_SOCKET);
+    EXPECT_EQ(connection.get_state(), ConnectionState::HANDLING);
+
+    connection.notify(ServerDirective::CONTINUE_HANDLING);
+    connection.notify(ServerDirective::WRITE_SOCKET);
+    EXPECT_EQ(connection.get_state(), ConnectionState::READY_TO_READ);
+
+    ASSERT_EQ(handler->requests.size(), 2);
+    EXPECT_EQ(handler->requests[0], pointer_to_socket->read_buffer.substr(0, 60));
+    EXPECT_EQ(handler->requests[1], pointer_to_socket->read_buffer.substr(60, 40));
+    EXPECT_EQ(pointer_to_socket->write_result.str(), "responseresponse");
+}
+
+TEST(ConnectionTests, Write_FileSentFromDisk)
+{
+    std::string contents{};
+    for (int i = 0; i < 500; i++) contents += std::to_string(i);
+    auto path = nimlib::Tests::temp_file(contents);
+    auto file = nimlib::Server::Utils::OpenFile::open(path);
+    unlink(path.c_str());
+
+    auto s = std::make_unique<MockTcpSocket>(1, 1024, 1000);
+    auto pointer_to_socket = s.get();
+    TcpConnection connection{ std::move(s), 1 };
+    auto handler = std::make_shared<MockHandler>(connection, 1, HandlerState::FINISHED_NO_WAIT, "head;");
+    connection.set_handler(handler);
+
+    connection.notify(ServerDirective::READ_SOCKET);
+    connection.sink().append(file, 0, file->size());
+    connection.sink() << ";tail";
+    connection.notify(ServerDirective::WRITE_SOCKET);
+
+    // The file goes out in several sends, each from where the last stopped.
+    EXPECT_EQ(pointer_to_socket->write_result.str(), "head;" + contents + ";tail");
+    EXPECT_EQ(connection.get_state(), ConnectionState::DONE);
+}
+
+TEST(ConnectionTests, Write_SameFileToTwoConnections)
+{
+    std::string contents{};
+    for (int i = 0; i < 500; i++) contents += std::to_string(i);
+    auto path = nimlib::Tests::temp_file(contents);
+    auto file = nimlib::Server::Utils::OpenFile::open(path);
+    unlink(path.c_str());
+
+    auto s1 = std::make_unique<MockTcpSocket>(1, 1024, 400);
+    auto s2 = std::make_unique<MockTcpSocket>(2, 1024, 700);
+    auto socket1 = s1.get();
+    auto socket2 = s2.get();
+    TcpConnection connection1{ std::move(s1), 1 };
+    TcpConnection connection2{ std::move(s2), 2 };
+    auto handler1 = std::make_shared<MockHandler>(connection1, 1, HandlerState::FINISHED_NO_WAIT, "one;");
+    auto handler2 = std::make_shared<MockHandler>(connection2, 1, HandlerState::FINISHED_NO_WAIT, "two;");
+    connection1.set_handler(handler1);
+    connection2.set_handler(handler2);
+
+    connection1.notify(ServerDirective::READ_SOCKET);
+    connection2.notify(ServerDirective::READ_SOCKET);
+    connection1.sink().append(file, 0, file->size());
+    connection2.sink().append(file, 100, file->size() - 100);
+
+    // Each connection keeps its own place in the file, sending it to one
+    // does not move the other along.
+    connection2.notify(ServerDirective::WRITE_SOCKET);
+    connection1.notify(ServerDirective::WRITE_SOCKET);
+
+    EXPECT_EQ(socket1->write_result.str(), "one;" + contents);
+    EXPECT_EQ(socket2->write_result.str(), "two;" + contents.substr(100));
+    EXPECT_EQ(connection1.get_state(), ConnectionState::DONE);
+    EXPECT_EQ(connection2.get_state(), ConnectionState::DONE);
+}
+
 TEST(ConnectionTests, Write_ConnectionClose)
 {
     auto s = std::make_unique<MockTcpSocket>(1);
@@ -324,7 +513,7 @@ TEST(ConnectionTests, Write_SeveralWrites)
      an error.
      */
 
-    auto s = std::make_unique<MockTcpSocket>(1, 1024, 127);
+    auto s = std::make_unique<MockTcpSocket>(1, 473, 127);
     auto pointer_to_socket = s.get();
     TcpConnection connection{ std::move(s), 1, 473 };
     auto handler = std::make_shared<MockHandler>(connection);
@@ -354,7 +543,7 @@ TEST(ConnectionTests, Write_WithError)
      of the socket failing to complete the write operation.
      */
 
-    auto s = std::make_unique<MockTcpSocket>(1, 1024, 64);
+    auto s = std::make_unique<MockTcpSocket>(1, 512, 64);
     auto pointer_to_socket = s.get();
     TcpConnection connection{ std::move(s), 1, 512 };
     auto handler = std::make_shared<MockHandler>(connection);
@@ -376,6 +565,59 @@ TEST(ConnectionTests, Write_WithError)
     EXPECT_EQ(pointer_to_socket->write_result.str(), expected_connection_output);
 }
 
+TEST(ConnectionTests, Write_LargeFileOverSeveralTurns)
+{
+    /*
+     A socket that keeps taking bytes is still left after a bounded amount,
+     the rest of the file goes out on the next turns.
+     */
+
+    const size_t per_turn = 1024 * 1024;
+    std::string contents(3 * per_turn, 'x');
+    auto path = nimlib::Tests::temp_file(contents);
+    auto file = nimlib::Server::Utils::OpenFile::open(path);
+    unlink(path.c_str());
+
+    auto s = std::make_unique<MockTcpSocket>(1, 1024, 1 << 20);
+    auto pointer_to_socket = s.get();
+    TcpConnection connection{ std::move(s), 1 };
+    auto handler = std::make_shared<MockHandler>(connection, 1, HandlerState::FINISHED_NO_WAIT, "");
+    connection.set_handler(handler);
+
+    connection.notify(ServerDirective::READ_SOCKET);
+    connection.sink().append(file, 0, file->size());
+    connection.notify(ServerDirective::WRITE_SOCKET);
+
+    EXPECT_LT(pointer_to_socket->write_result.str().size(), 2 * per_turn);
+    EXPECT_EQ(connection.get_state(), ConnectionState::READY_TO_WRITE);
+
+    connection.notify(ServerDirective::WRITE_SOCKET);
+    connection.notify(ServerDirective::WRITE_SOCKET);
+
+    EXPECT_TRUE(pointer_to_socket->write_result.str().ends_with(contents));
+    EXPECT_EQ(connection.get_state(), ConnectionState::DONE);
+}
+
+TEST(ConnectionTests, Write_PeerGone)
+{
+    /*
+     A send failing for any other reason than a full socket, here the peer
+     resetting the connection, is not retried, the connection ends.
+     */
+
+    auto s = std::make_unique<MockTcpSocket>(1, 512, 64);
+    auto pointer_to_socket = s.get();
+    pointer_to_socket->send_error = ECONNRESET;
+    TcpConnection connection{ std::move(s), 1, 512 };
+    auto handler = std::make_shared<MockHandler>(connection);
+    connection.set_handler(handler);
+
+    connection.notify(ServerDirective::READ_SOCKET);
+    connection.notify(ServerDirective::WRITE_SOCKET);
+
+    EXPECT_EQ(connection.get_state(), ConnectionState::CONNECTION_ERROR);
+}
+
 TEST(ConnectionTests, ConnectionState_WhenJustCreated)
 {
     auto s = std::make_unique<MockTcpSocket>(1, 1024, 1024);
@@ -403,6 +645,44 @@ TEST(ConnectionTests, ConnectionState_WhenHalted)
 
     auto state = c.get_state();
     EXPECT_EQ(state, ConnectionState::INACTIVE);
-    EXPECT_EQ(connection_streams.source().str(), "");
+    EXPECT_EQ(connection_streams.source().readable(), "");
     EXPECT_EQ(connection_streams.sink().str(), "");
 }
+
+TEST(ConnectionTests, ConnectionState_WhenTimedOut)
+{
+    nimlib::Server::Utils::TimingWheel timers{};
+    TcpConnection c{ 5, timers };
+
+    EXPECT_FALSE(timers.scheduled(5));
+
+    c.accept_socket(std::make_unique<MockTcpSocket>(5, 1024, 1024));
+    EXPECT_TRUE(timers.scheduled(5));
+
+    c.time_out();
+    EXPECT_EQ(c.get_state(), ConnectionState::CONNECTION_ERROR);
+    EXPECT_FALSE(timers.scheduled(5));
+
+    c.halt();
+    EXPECT_EQ(c.get_state(), ConnectionState::INACTIVE);
+    EXPECT_FALSE(timers.scheduled(5));
+}
+
+TEST(ConnectionTests, ConnectionState_KeptAliveTimesOutWhenIdle)
+{
+    nimlib::Server::Utils::TimingWheel timers{};
+    TcpConnection c{ 5, timers };
+    c.accept_socket(std::make_unique<MockTcpSocket>(5));
+    auto handler = std::make_shared<MockHandler>(c, 1, HandlerState::FINISHED_WAIT, "HTTP/1.1 200 OK");
+    c.set_handler(handler);
+
+    c.notify(ServerDirective::READ_SOCKET);
+    c.notify(ServerDirective::WRITE_SOCKET);
+    EXPECT_EQ(c.get_state(), ConnectionState::READY_TO_READ);
+
+    // Waiting for the next request is bounded by the keep alive timeout,
+    // not by the much longer one of a connection waiting for its first.
+    auto now = nimlib::Server::Utils::TimingWheel::clock::now();
+    EXPECT_TRUE(timers.advance(now + TcpConnection::KEEP_ALIVE_TIME_OUT / 2).empty());
+    EXPECT_EQ(timers.advance(now + TcpConnection::KEEP_ALIVE_TIME_OUT * 2), std::vector<int>{ 5 });
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/tcp_connection_pool.h"
+#include "support/tcp_socket.mock.h"
+
+using nimlib::Server::TcpConnectionPool;
+using nimlib::Server::Sockets::MockTcpSocket;
+using nimlib::Server::Constants::ConnectionState;
+
+// Every thread has its own pool, so each test runs on a new thread to start
+// from an empty one.
+void with_new_pool(std::function<void(TcpConnectionPool&)> test)
+{
+    std::thread{ [&]() { test(TcpConnectionPool::get_pool()); } }.join();
+}
+
+void record(TcpConnectionPool& pool, int socket)
+{
+    pool.record_connection(std::make_unique<MockTcpSocket>(socket, 1, 1));
+}
+
+TEST(TcpConnectionPoolTest, GrowsWithSocketDescriptors)
+{
+    with_new_pool([](TcpConnectionPool& pool) {
+        record(pool, 3);
+        record(pool, 500);
+        record(pool, 150'000);
+
+        EXPECT_EQ(pool.size(), 3);
+        EXPECT_EQ(pool.find(3)->get_id(), 3);
+        EXPECT_EQ(pool.find(500)->get_id(), 500);
+        EXPECT_EQ(pool.find(150'000)->get_id(), 150'000);
+        EXPECT_EQ(pool.find(150'000)->get_state(), ConnectionState::READY_TO_READ);
+        EXPECT_EQ(pool.find(4), nullptr);
+        EXPECT_EQ(pool.find(1'000'000), nullptr);
+        });
+}
+
+TEST(TcpConnectionPoolTest, RecyclesHaltedConnections)
+{
+    with_new_pool([](TcpConnectionPool& pool) {
+        record(pool, 7);
+        auto connection = pool.find(7);
+
+        connection->time_out();
+        EXPECT_EQ(pool.clean_up(7), ConnectionState::INACTIVE);
+        EXPECT_EQ(pool.find(7), nullptr);
+        EXPECT_EQ(pool.size(), 0);
+
+        record(pool, 9);
+        EXPECT_EQ(pool.find(9), connection);
+        EXPECT_EQ(connection->get_id(), 9);
+        EXPECT_EQ(connection->get_state(), ConnectionState::READY_TO_READ);
+        });
+}
+
+TEST(TcpConnectionPoolTest, LiveConnectionsStayDense)
+{
+    with_new_pool([](TcpConnectionPool& pool) {
+        for (int socket = 10; socket < 20; socket++) record(pool, socket);
+
+        for (int socket : { 10, 13, 19 })
+        {
+            pool.find(socket)->time_out();
+            pool.clean_up(socket);
+        }
+
+        std::vector<int> ids{};
+        for (auto connection : pool.get_all()) ids.push_back(connection->get_id());
+        std::sort(ids.begin(), ids.end());
+
+        EXPECT_EQ(ids, (std::vector<int>{ 11, 12, 14, 15, 16, 17, 18 }));
+        for (int id : ids) EXPECT_EQ(pool.find(id)->get_id(), id);
+        });
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+
+#include <botan/auto_rng.h>
+#include <botan/credentials_manager.h>
+#include <botan/tls_callbacks.h>
+#include <botan/tls_client.h>
+#include <botan/tls_policy.h>
+#include <botan/tls_session_manager_noop.h>
+
+#include "../../src/tls/tls_layer.h"
+
+using nimlib::Server::Handlers::TlsLayer;
+using nimlib::Server::Types::Connection;
+using nimlib::Server::Types::Handler;
+using nimlib::Server::Types::Socket;
+using nimlib::Server::Types::StreamsProvider;
+using nimlib::Server::Utils::ByteBuffer;
+using nimlib::Server::Utils::OutputQueue;
+using nimlib::Server::Constants::HandlerState;
+using nimlib::Server::Constants::ServerDirective;
+using nimlib::Server::Constants::ConnectionState;
+
+// The helpers are kept to this file, unit_tests links other fakes by the
+// same names.
+namespace
+{
+// Stands in for a TcpConnection, its streams carry the encrypted bytes.
+struct FakeConnection : public Connection, public StreamsProvider
+{
+    void accept_socket(std::unique_ptr<Socket> s) override {}
+    void notify(ServerDirective directive) override {}
+    void notify(Handler& handler) override {}
+    void set_handler(std::shared_ptr<Handler>) override {}
+    void halt() override {}
+    void time_out() override {}
+    ConnectionState get_state() override { return ConnectionState::HANDLING; }
+    const int get_id() const override { return 1; }
+
+    ByteBuffer& source() override { return input; }
+    OutputQueue& sink() override { return output; }
+
+    ByteBuffer input{};
+    OutputQueue output{};
+};
+
+// Answers every "ping\n" with "pong\n", keeping the connection open after
+// it or not, the way an HttpHandler does for keep-alive requests.
+struct PingHandler : public Handler
+{
+    explicit PingHandler(bool keep_alive) : keep_alive{ keep_alive } {}
+
+    void notify(Connection& connection, StreamsProvider& streams) override {}
+
+    void notify(Handler& handler, Connection& connection, StreamsProvider& streams) override
+    {
+        ByteBuffer& input{ streams.source() };
+        for (size_t at; (at = input.readable().find("ping\n")) != std::string_view::npos;)
+        {
+            input.consume(at + 5);
+            streams.sink().append(std::string_view{ "pong\n" });
+            answered = true;
+        }
+        handler.notify(*this, connection, streams);
+    }
+
+    bool wants_more_bytes() override { return !answered || keep_alive; }
+    bool wants_to_write() override { return answered && !keep_alive; }
+    bool wants_to_live() override { return answered && keep_alive; }
+    bool wants_to_be_calledback() override { return false; }
+    HandlerState get_state() override { return HandlerState::FINISHED_WAIT; }
+
+    bool keep_alive;
+    bool answered{ false };
+};
+
+// The client end, whatever it writes is picked up by exchange().
+struct ClientCallbacks : public Botan::TLS::Callbacks
+{
+    void tls_emit_data(std::span<const uint8_t> data) override
+    {
+        to_server.append(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    void tls_record_received(uint64_t seq_no, std::span<const uint8_t> data) override
+    {
+        received.append(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    void tls_alert(Botan::TLS::Alert alert) override
+    {
+        if (alert.type() == Botan::TLS::AlertType::CloseNotify) close_notified = true;
+    }
+
+    // The test certificate is self-signed, the client trusts it as it is.
+    void tls_verify_cert_chain(
+        const std::vector<Botan::X509_Certificate>& cert_chain,
+        const std::vector<std::optional<Botan::OCSP::Response>>& ocsp_responses,
+        const std::vector<Botan::Certificate_Store*>& trusted_roots,
+        Botan::Usage_Type usage,
+        std::string_view hostname,
+        const Botan::TLS::Policy& policy) override {}
+
+    std::string to_server{};
+    std::string received{};
+    bool close_notified{ false };
+};
+
+class TlsSession
+{
+public:
+    explicit TlsSession(bool keep_alive) :
+        handler{ std::make_shared<PingHandler>(keep_alive) },
+        layer{ handler },
+        callbacks{ std::make_shared<ClientCallbacks>() },
+        rng{ std::make_shared<Botan::AutoSeeded_RNG>() },
+        client{
+            callbacks,
+            std::make_shared<Botan::TLS::Session_Manager_Noop>(),
+            std::make_shared<Botan::Credentials_Manager>(),
+            std::make_shared<Botan::TLS::Policy>(),
+            rng }
+    {
+        exchange();
+    }
+
+    // Passes bytes both ways until neither end has more to say.
+    void exchange()
+    {
+        while (!callbacks->to_server.empty())
+        {
+            connection.input.append(callbacks->to_server);
+            callbacks->to_server.clear();
+            layer.notify(connection, connection);
+
+            std::string to_client = connection.output.str();
+            connection.output.clear();
+            if (!to_client.empty())
+            {
+                client.received_data(reinterpret_cast<const uint8_t*>(to_client.data()), to_client.size());
+            }
+        }
+    }
+
+    void send(std::string_view data)
+    {
+        client.send(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+        exchange();
+    }
+
+    std::shared_ptr<PingHandler> handler;
+    FakeConnection connection{};
+    TlsLayer layer;
+    std::shared_ptr<ClientCallbacks> callbacks;
+    std::shared_ptr<Botan::AutoSeeded_RNG> rng;
+    Botan::TLS::Client client;
+};
+}
+
+TEST(TlsLayerTests, KeptAliveSessionAnswersSeveralRequests)
+{
+    TlsSession session{ true };
+    ASSERT_TRUE(session.client.is_active());
+
+    session.send("ping\n");
+    session.send("ping\n");
+
+    EXPECT_EQ(session.callbacks->received, "pong\npong\n");
+    EXPECT_FALSE(session.callbacks->close_notified);
+    EXPECT_TRUE(session.client.is_active());
+    EXPECT_TRUE(session.layer.wants_to_live());
+}
+
+TEST(TlsLayerTests, SessionClosedAfterLastResponse)
+{
+    TlsSession session{ false };
+    ASSERT_TRUE(session.client.is_active());
+
+    session.send("ping\n");
+
+    EXPECT_EQ(session.callbacks->received, "pong\n");
+    EXPECT_TRUE(session.callbacks->close_notified);
+}
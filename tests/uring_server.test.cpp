@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../src/uring_server.h"
+
+using namespace nimlib::Server;
+
+TEST(UringServerTest, _)
+{
+    UringServer us{ "8082" };
+}
+
+// How many answers to GET /health the bytes hold.
+static int health_answers(const std::string& received)
+{
+    int count{};
+    for (auto at = received.find("HTTP/1.1 200 OK\r\n"); at != std::string::npos; at = received.find("HTTP/1.1 200 OK\r\n", at + 1))
+    {
+        count++;
+    }
+    return count;
+}
+
+// Reads until `count` complete answers to GET /health have come in, or the
+// connection ends.
+static std::string read_responses(int client, int count)
+{
+    std::string received{};
+    char buffer[4096];
+
+    while (health_answers(received) < count || !received.ends_with("\r\n\r\nok"))
+    {
+        auto size = recv(client, buffer, sizeof(buffer), 0);
+        if (size <= 0) break;
+        received.append(buffer, size);
+    }
+
+    return received;
+}
+
+TEST(UringServerTest, RequestsReceivedAndAnswered)
+{
+    static const std::string port{ "8085" };
+    static std::atomic<int> started{ 0 };
+
+    // The loop never returns, it runs on its own thread, which owns the
+    // connection pool, until the process ends.
+    std::thread{ []() {
+        UringServer server{ port };
+        if (!server.ready())
+        {
+            started = -1;
+            return;
+        }
+
+        started = 1;
+        server.run();
+        } }.detach();
+
+    while (started == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    if (started < 0) GTEST_SKIP() << "io_uring is not available";
+
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(client, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(std::stoi(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+
+    // Accepted, then one request after the other on the same connection,
+    // the second sent in two pieces.
+    std::string request{ "GET /health HTTP/1.1\r\nHost: localhost\r\n\r\n" };
+    ASSERT_EQ(send(client, request.data(), request.size(), 0), request.size());
+    auto first = read_responses(client, 1);
+    EXPECT_TRUE(first.starts_with("HTTP/1.1 200 OK\r\n")) << first;
+    EXPECT_TRUE(first.ends_with("\r\n\r\nok")) << first;
+    EXPECT_EQ(health_answers(first), 1);
+
+    ASSERT_EQ(send(client, request.data(), 10, 0), 10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(send(client, request.data() + 10, request.size() - 10, 0), request.size() - 10);
+    EXPECT_EQ(health_answers(read_responses(client, 1)), 1);
+
+    // Pipelined requests are answered in order.
+    std::string pipelined = request + request + request;
+    ASSERT_EQ(send(client, pipelined.data(), pipelined.size(), 0), pipelined.size());
+    EXPECT_EQ(health_answers(read_responses(client, 3)), 3);
+
+    close(client);
+}
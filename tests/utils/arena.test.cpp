@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "../../src/utils/arena.h"
+#include "../support/allocation_counter.h"
+
+using nimlib::Server::Utils::Arena;
+
+TEST(ArenaTests, NoBlockUntilAskedFor)
+{
+    Arena arena{};
+
+    EXPECT_EQ(arena.heap_blocks(), 0);
+    EXPECT_EQ(arena.used(), 0);
+
+    arena.reset();
+    EXPECT_EQ(arena.heap_blocks(), 0);
+}
+
+TEST(ArenaTests, AllocatesFromItsBlock)
+{
+    Arena arena{ 1024 };
+
+    std::pmr::vector<int> numbers{ &arena };
+    numbers.reserve(16);
+    std::pmr::string text{ "longer than a short string is kept inline", &arena };
+
+    EXPECT_EQ(arena.heap_blocks(), 1);
+    EXPECT_GE(arena.used(), 16 * sizeof(int) + text.size());
+
+    // Aligned as asked.
+    auto aligned = arena.allocate(64, 64);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 64, 0);
+}
+
+TEST(ArenaTests, ResetKeepsTheFirstBlock)
+{
+    Arena arena{ 1024 };
+
+    auto fill = [&arena](size_t bytes)
+        {
+            std::pmr::string text(bytes, 'x', &arena);
+            return text.size();
+        };
+
+    fill(512);
+    arena.reset();
+    EXPECT_EQ(arena.used(), 0);
+
+    // Requests that fit in the block take nothing from the heap once it is
+    // there.
+    auto allocations = nimlib::Tests::allocation_count();
+    for (int i = 0; i < 100; i++)
+    {
+        fill(512);
+        arena.reset();
+    }
+    EXPECT_EQ(nimlib::Tests::allocation_count() - allocations, 0);
+    EXPECT_EQ(arena.heap_blocks(), 1);
+}
+
+TEST(ArenaTests, GrowsPastTheFirstBlockUntilReset)
+{
+    Arena arena{ 256 };
+
+    {
+        std::pmr::vector<std::pmr::string> lines{ &arena };
+        for (int i = 0; i < 64; i++) lines.emplace_back(100, 'a' + i % 26);
+        EXPECT_EQ(std::string_view{ lines[63] }, std::string(100, 'a' + 63 % 26));
+    }
+
+    EXPECT_GT(arena.heap_blocks(), 1);
+    EXPECT_GT(arena.used(), 64 * 100);
+
+    // The blocks taken are given back, the first one is used again.
+    auto blocks = arena.heap_blocks();
+    arena.reset();
+    std::pmr::string small(100, 'b', &arena);
+    EXPECT_EQ(arena.heap_blocks(), blocks);
+}
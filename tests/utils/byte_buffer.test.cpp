@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+#include "../../src/utils/byte_buffer.h"
+
+using nimlib::Server::Utils::ByteBuffer;
+
+// Writes `bytes` into the free space the way a socket read does.
+static void receive(ByteBuffer& buffer, std::string_view bytes, size_t min_size)
+{
+    auto space = buffer.writable(min_size);
+    ASSERT_GE(space.size(), min_size);
+    ASSERT_GE(space.size(), bytes.size());
+
+    std::memcpy(space.data(), bytes.data(), bytes.size());
+    buffer.commit(bytes.size());
+}
+
+TEST(ByteBufferTests, EmptyWhenCreated)
+{
+    ByteBuffer buffer{};
+
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(buffer.size(), 0);
+    EXPECT_EQ(buffer.readable(), "");
+    EXPECT_EQ(buffer.capacity(), 0);
+}
+
+TEST(ByteBufferTests, ReadsWhatWasWritten)
+{
+    ByteBuffer buffer{ 16 };
+
+    receive(buffer, "GET / HTTP/1.1\r\n", 16);
+    buffer.append("\r\n");
+
+    EXPECT_EQ(buffer.readable(), "GET / HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(buffer.size(), 18);
+
+    buffer.consume(4);
+    EXPECT_EQ(buffer.readable(), "/ HTTP/1.1\r\n\r\n");
+
+    // Consuming more than there is reads everything.
+    buffer.consume(100);
+    EXPECT_TRUE(buffer.empty());
+}
+
+TEST(ByteBufferTests, ReusesStorageOnceEverythingIsRead)
+{
+    ByteBuffer buffer{ 64 };
+    const std::string request(48, 'x');
+
+    for (int i = 0; i < 100; i++)
+    {
+        receive(buffer, request, 64);
+        EXPECT_EQ(buffer.readable(), request);
+        buffer.consume(request.size());
+    }
+
+    EXPECT_EQ(buffer.capacity(), 64);
+}
+
+TEST(ByteBufferTests, MovesUnreadBytesToMakeSpace)
+{
+    ByteBuffer buffer{ 32 };
+
+    buffer.append("first request|second");
+    buffer.consume(14);
+
+    // Twenty free bytes only fit once the unread ones are moved to the front.
+    receive(buffer, " request|", 20);
+    EXPECT_EQ(buffer.readable(), "second request|");
+    EXPECT_EQ(buffer.capacity(), 32);
+}
+
+TEST(ByteBufferTests, GrowsKeepingUnreadBytes)
+{
+    ByteBuffer buffer{ 8 };
+
+    buffer.append("12345678");
+    buffer.consume(2);
+    buffer.append("9abcdefghij");
+
+    EXPECT_EQ(buffer.readable(), "3456789abcdefghij");
+    EXPECT_GE(buffer.capacity(), 17);
+}
+
+TEST(ByteBufferTests, ClearKeepsStorage)
+{
+    ByteBuffer buffer{};
+
+    buffer.append(std::string(1000, 'x'));
+    auto capacity = buffer.capacity();
+    buffer.clear();
+
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(buffer.capacity(), capacity);
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../../src/utils/compression.h"
+#include "../support/gunzip.h"
+
+using nimlib::Server::Utils::compressible_type;
+using nimlib::Server::Utils::gzip_available;
+using nimlib::Server::Utils::GzipStream;
+using nimlib::Tests::gunzip;
+
+// Text repetitive enough to compress well, like markup or a report.
+static std::string sample_text(size_t lines)
+{
+    std::string text{};
+    for (size_t i = 0; i < lines; i++) text += "<li class=\"entry\">entry number " + std::to_string(i) + "</li>\n";
+    return text;
+}
+
+TEST(CompressionTests, CompressibleTypes)
+{
+    EXPECT_TRUE(compressible_type("text/html"));
+    EXPECT_TRUE(compressible_type("text/plain; charset=UTF-8"));
+    EXPECT_TRUE(compressible_type("application/json ; charset=utf-8"));
+    EXPECT_TRUE(compressible_type("image/svg+xml"));
+    EXPECT_FALSE(compressible_type("image/jpeg"));
+    EXPECT_FALSE(compressible_type("video/mp4"));
+    EXPECT_FALSE(compressible_type("application/json-seq"));
+    EXPECT_FALSE(compressible_type(""));
+}
+
+TEST(CompressionTests, WholeBodyCompressed)
+{
+    if (!gzip_available()) GTEST_SKIP() << "built without zlib";
+
+    auto text = sample_text(1000);
+    GzipStream stream{ 6 };
+    std::string compressed{};
+    ASSERT_TRUE(stream.finish(text, compressed));
+
+    EXPECT_LT(compressed.size(), text.size() / 4);
+    EXPECT_EQ(gunzip(compressed), text);
+
+    // The stream starts over once finished.
+    std::string again{};
+    ASSERT_TRUE(stream.finish("short", again));
+    EXPECT_EQ(gunzip(again), "short");
+    EXPECT_EQ(stream.level(), 6);
+}
+
+TEST(CompressionTests, FlushedPiecesReadableAsTheyCome)
+{
+    if (!gzip_available()) GTEST_SKIP() << "built without zlib";
+
+    GzipStream stream{ 1 };
+    std::string compressed{};
+    std::string expected{};
+
+    for (int piece = 0; piece < 5; piece++)
+    {
+        auto text = sample_text(50 + piece);
+        expected += text;
+        ASSERT_TRUE(stream.write(text, compressed, true));
+        EXPECT_EQ(gunzip(compressed, true), expected) << piece;
+    }
+
+    // Nothing new to flush is not an error.
+    ASSERT_TRUE(stream.write("", compressed, true));
+    ASSERT_TRUE(stream.finish("the end", compressed));
+    EXPECT_EQ(gunzip(compressed), expected + "the end");
+}
+
+TEST(CompressionTests, UnflushedWritesKeptUntilFinish)
+{
+    if (!gzip_available()) GTEST_SKIP() << "built without zlib";
+
+    GzipStream stream{ 9 };
+    std::string compressed{};
+    ASSERT_TRUE(stream.write("held back", compressed));
+    ASSERT_TRUE(stream.write(" for now", compressed));
+    EXPECT_NE(gunzip(compressed, true), "held back for now");
+
+    ASSERT_TRUE(stream.finish({}, compressed));
+    EXPECT_EQ(gunzip(compressed), "held back for now");
+}
+
+TEST(CompressionTests, NothingWrittenWithoutZlib)
+{
+    if (gzip_available()) GTEST_SKIP() << "built with zlib";
+
+    GzipStream stream{ 6 };
+    std::string compressed{};
+    EXPECT_FALSE(stream.write("text", compressed, true));
+    EXPECT_FALSE(stream.finish("text", compressed));
+    EXPECT_TRUE(compressed.empty());
+}
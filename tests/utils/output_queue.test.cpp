@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <memory>
+#include <string>
+
+#include "../../src/utils/output_queue.h"
+#include "../support/temp_file.h"
+
+using nimlib::Server::Utils::OpenFile;
+using nimlib::Server::Utils::OutputQueue;
+
+TEST(OutputQueueTests, EmptyWhenCreated)
+{
+    OutputQueue queue{};
+    std::array<iovec, 4> buffers;
+
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.size(), 0);
+    EXPECT_EQ(queue.gather(buffers), 0);
+    EXPECT_EQ(queue.str(), "");
+}
+
+TEST(OutputQueueTests, CopiedBytesJoinedInOneSlice)
+{
+    OutputQueue queue{};
+    std::array<iovec, 4> buffers;
+
+    queue << "HTTP/1.1 200 OK\r\n" << "content-length: 2\r\n\r\n";
+    queue.append(std::string{ "ok" });
+
+    EXPECT_EQ(queue.gather(buffers), 1);
+    EXPECT_EQ(queue.str(), "HTTP/1.1 200 OK\r\ncontent-length: 2\r\n\r\nok");
+    EXPECT_EQ(queue.size(), queue.str().size());
+}
+
+TEST(OutputQueueTests, SharedBytesNotCopied)
+{
+    OutputQueue queue{};
+    std::array<iovec, 4> buffers;
+    auto body = std::make_shared<const std::string>(10000, 'x');
+
+    queue << "head\r\n\r\n";
+    queue.append(body);
+    queue << "tail";
+
+    ASSERT_EQ(queue.gather(buffers), 3);
+    EXPECT_EQ(buffers[1].iov_base, body->data());
+    EXPECT_EQ(buffers[1].iov_len, body->size());
+    EXPECT_EQ(queue.size(), 8 + 10000 + 4);
+
+    // The queue keeps the body alive until it is written.
+    EXPECT_EQ(body.use_count(), 2);
+    queue.consume(8 + 10000);
+    EXPECT_EQ(body.use_count(), 1);
+    EXPECT_EQ(queue.str(), "tail");
+}
+
+TEST(OutputQueueTests, LongStringsKeptAsTheyAre)
+{
+    OutputQueue queue{};
+    std::array<iovec, 4> buffers;
+    std::string body(OutputQueue::COPY_BELOW, 'x');
+    auto bytes = body.data();
+
+    queue.append(std::move(body));
+
+    ASSERT_EQ(queue.gather(buffers), 1);
+    EXPECT_EQ(buffers[0].iov_base, bytes);
+}
+
+TEST(OutputQueueTests, PartialWritesMoveTheStart)
+{
+    OutputQueue queue{};
+    std::array<iovec, 4> buffers;
+    auto body = std::make_shared<const std::string>("0123456789");
+
+    queue << "abc";
+    queue.append(body, 2, 6);
+
+    queue.consume(2);
+    ASSERT_EQ(queue.gather(buffers), 2);
+    EXPECT_EQ(std::string_view(static_cast<const char*>(buffers[0].iov_base), buffers[0].iov_len), "c");
+    EXPECT_EQ(queue.str(), "c234567");
+
+    queue.consume(3);
+    ASSERT_EQ(queue.gather(buffers), 1);
+    EXPECT_EQ(buffers[0].iov_base, body->data() + 4);
+    EXPECT_EQ(queue.str(), "4567");
+
+    queue.consume(100);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(OutputQueueTests, GatherLimitedToBuffersGiven)
+{
+    OutputQueue queue{};
+    std::array<iovec, 2> buffers;
+    auto body = std::make_shared<const std::string>("body");
+
+    for (int i = 0; i < 3; i++) queue.append(body);
+
+    EXPECT_EQ(queue.gather(buffers), 2);
+    queue.consume(8);
+    EXPECT_EQ(queue.gather(buffers), 1);
+}
+
+TEST(OutputQueueTests, HighWatermark)
+{
+    OutputQueue queue{ 10 };
+
+    queue << "0123456789";
+    EXPECT_FALSE(queue.over_high_watermark());
+
+    queue << "a";
+    EXPECT_TRUE(queue.over_high_watermark());
+
+    queue.consume(5);
+    EXPECT_FALSE(queue.over_high_watermark());
+}
+
+TEST(OutputQueueTests, FilesWrittenOnTheirOwn)
+{
+    auto path = nimlib::Tests::temp_file("0123456789");
+    auto file = OpenFile::open(path);
+    unlink(path.c_str());
+    ASSERT_TRUE(file);
+
+    OutputQueue queue{};
+    std::array<iovec, 4> buffers;
+
+    queue << "head";
+    queue.append(file, 2, 6);
+    queue << "tail";
+    EXPECT_EQ(queue.size(), 14);
+    EXPECT_EQ(queue.str(), "head234567tail");
+
+    // Gathering stops before the file, which is only written once first.
+    EXPECT_FALSE(queue.front_file());
+    EXPECT_EQ(queue.gather(buffers), 1);
+    queue.consume(4);
+
+    auto range = queue.front_file();
+    ASSERT_TRUE(range);
+    EXPECT_EQ(range->file, file.get());
+    EXPECT_EQ(range->offset, 2);
+    EXPECT_EQ(range->size, 6);
+    EXPECT_EQ(queue.gather(buffers), 0);
+
+    queue.consume(4);
+    EXPECT_EQ(queue.front_file()->offset, 6);
+    EXPECT_EQ(queue.str(), "67tail");
+
+    queue.consume(2);
+    EXPECT_FALSE(queue.front_file());
+    EXPECT_EQ(queue.gather(buffers), 1);
+    EXPECT_EQ(file.use_count(), 1);
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../../src/utils/scan.h"
+
+namespace Scan = nimlib::Server::Utils::Scan;
+
+// Runs `check` once for every level this CPU can run, leaving the best
+// level in use afterwards.
+template <typename F>
+static void for_each_level(F check)
+{
+    for (auto level : { Scan::Level::SCALAR, Scan::Level::SSE2, Scan::Level::AVX2 })
+    {
+        if (!Scan::use_level(level)) continue;
+        SCOPED_TRACE(Scan::level_name(level));
+        check();
+    }
+
+    Scan::use_level(Scan::best_level());
+}
+
+// Lengths around the 16 and 32 byte blocks, where the vector loops hand
+// over to the scalar tail.
+static const std::vector<size_t> lengths{ 0, 1, 2, 15, 16, 17, 31, 32, 33, 47, 63, 64, 65, 100, 1000 };
+
+TEST(ScanTests, BestLevelIsUsable)
+{
+    EXPECT_TRUE(Scan::use_level(Scan::best_level()));
+    EXPECT_EQ(Scan::level(), Scan::best_level());
+    EXPECT_TRUE(Scan::use_level(Scan::Level::SCALAR));
+    EXPECT_EQ(Scan::level(), Scan::Level::SCALAR);
+    Scan::use_level(Scan::best_level());
+}
+
+TEST(ScanTests, FindLineEnd)
+{
+    for_each_level([]() {
+        for (size_t length : lengths)
+        {
+            for (size_t at = 0; at < length; at += 7)
+            {
+                for (char end : { '\r', '\n' })
+                {
+                    std::string s(length, 'a');
+                    s[at] = end;
+
+                    EXPECT_EQ(Scan::find_line_end(s), at) << length;
+                    EXPECT_EQ(Scan::find_line_end(s, at), at) << length;
+                    EXPECT_EQ(Scan::find_line_end(s, at + 1), std::string::npos) << length;
+                }
+            }
+
+            EXPECT_EQ(Scan::find_line_end(std::string(length, 'a')), std::string::npos);
+        }
+        });
+}
+
+TEST(ScanTests, FindChar)
+{
+    for_each_level([]() {
+        for (size_t length : lengths)
+        {
+            for (size_t at = 0; at < length; at += 5)
+            {
+                std::string s(length, 'a');
+                s[at] = ':';
+                if (at + 3 < length) s[at + 3] = ':';
+
+                EXPECT_EQ(Scan::find_char(s, ':'), at) << length;
+                EXPECT_EQ(Scan::find_char(s, ':', at + 1), at + 3 < length ? at + 3 : std::string::npos) << length;
+            }
+        }
+        });
+}
+
+TEST(ScanTests, ToLowerSameAsScalar)
+{
+    std::mt19937 random{ 42 };
+    std::uniform_int_distribution<int> byte{ 0, 255 };
+
+    for_each_level([&]() {
+        for (size_t length : lengths)
+        {
+            std::string s(length, '\0');
+            for (auto& c : s) c = static_cast<char>(byte(random));
+
+            std::string expected{ s };
+            for (auto& c : expected)
+            {
+                if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+            }
+
+            std::string lowered(length, '\0');
+            Scan::to_lower(s, lowered.data());
+            EXPECT_EQ(lowered, expected) << length;
+
+            // Lower casing in place.
+            Scan::to_lower(s, s.data());
+            EXPECT_EQ(s, expected) << length;
+        }
+        });
+}
+
+TEST(ScanTests, IsToken)
+{
+    const std::string special{ "!#$%&'*+-.^_`|~" };
+    auto token_char = [&special](unsigned char c) {
+        return (c < 0x80 && std::isalnum(c)) || special.find(c) != std::string::npos;
+        };
+
+    for_each_level([&]() {
+        EXPECT_FALSE(Scan::is_token(""));
+        EXPECT_TRUE(Scan::is_token("Content-Type"));
+        EXPECT_TRUE(Scan::is_token("X-Forwarded-For"));
+        EXPECT_FALSE(Scan::is_token("Host "));
+        EXPECT_FALSE(Scan::is_token("Ho\tst"));
+
+        // Every byte, at every position within a long name.
+        for (size_t length : lengths)
+        {
+            if (length == 0) continue;
+
+            for (int c = 0; c < 256; c++)
+            {
+                std::string name(length, 'x');
+                name[(c * 7) % length] = static_cast<char>(c);
+                EXPECT_EQ(Scan::is_token(name), token_char(c)) << length << " " << c;
+            }
+        }
+        });
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "../../src/utils/timing_wheel.h"
+
+using nimlib::Server::Utils::TimingWheel;
+using namespace std::chrono_literals;
+
+const TimingWheel::time_point t0{ TimingWheel::clock::now() };
+
+std::vector<int> sorted(std::vector<int> ids)
+{
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+TEST(TimingWheel, EmptyWheel)
+{
+    TimingWheel tw{ t0 };
+
+    EXPECT_EQ(tw.next_time_out(), -1);
+    EXPECT_EQ(tw.size(), 0);
+    EXPECT_TRUE(tw.advance(t0 + 1h).empty());
+    EXPECT_EQ(tw.now(), t0 + 1h);
+}
+
+TEST(TimingWheel, ExpiresAtDeadline)
+{
+    TimingWheel tw{ t0 };
+    tw.schedule(3, t0 + 5ms);
+
+    EXPECT_TRUE(tw.scheduled(3));
+    EXPECT_EQ(tw.next_time_out(), 5);
+    EXPECT_TRUE(tw.advance(t0 + 4ms).empty());
+    EXPECT_EQ(tw.next_time_out(), 1);
+    EXPECT_EQ(tw.advance(t0 + 5ms), std::vector<int>{ 3 });
+    EXPECT_FALSE(tw.scheduled(3));
+    EXPECT_EQ(tw.size(), 0);
+}
+
+TEST(TimingWheel, RelativeToLastAdvance)
+{
+    TimingWheel tw{ t0 };
+    tw.advance(t0 + 100ms);
+    tw.schedule(1, 10ms);
+
+    EXPECT_TRUE(tw.advance(t0 + 109ms).empty());
+    EXPECT_EQ(tw.advance(t0 + 110ms), std::vector<int>{ 1 });
+}
+
+TEST(TimingWheel, RefreshedAfterLongWait)
+{
+    TimingWheel tw{ t0 };
+    tw.schedule(1, t0 + 30s);
+
+    // The loop slept for a minute, then sets a deadline while it handles
+    // what woke it, before the wheel is advanced.
+    tw.refresh(t0 + 60s);
+    tw.schedule(2, 5s);
+
+    // Refreshing expires nothing and never goes back.
+    EXPECT_TRUE(tw.scheduled(1));
+    tw.refresh(t0 + 10s);
+    EXPECT_EQ(tw.now(), t0 + 60s);
+    EXPECT_EQ(tw.next_time_out(), 0);
+
+    EXPECT_EQ(tw.advance(t0 + 60s), std::vector<int>{ 1 });
+    EXPECT_GT(tw.next_time_out(), 0);
+    EXPECT_LE(tw.next_time_out(), 5000);
+    EXPECT_TRUE(tw.advance(t0 + 64999ms).empty());
+    EXPECT_EQ(tw.advance(t0 + 65s), std::vector<int>{ 2 });
+}
+
+TEST(TimingWheel, PastDeadlineExpiresOnNextTick)
+{
+    TimingWheel tw{ t0 };
+    tw.advance(t0 + 50ms);
+    tw.schedule(1, t0 + 10ms);
+
+    EXPECT_EQ(tw.next_time_out(), 1);
+    EXPECT_EQ(tw.advance(t0 + 51ms), std::vector<int>{ 1 });
+}
+
+TEST(TimingWheel, CancelAndReschedule)
+{
+    TimingWheel tw{ t0 };
+    tw.schedule(1, t0 + 5ms);
+    tw.schedule(2, t0 + 5ms);
+    tw.cancel(1);
+    tw.schedule(2, t0 + 20ms);
+
+    EXPECT_EQ(tw.size(), 1);
+    EXPECT_TRUE(tw.advance(t0 + 19ms).empty());
+    EXPECT_EQ(tw.advance(t0 + 20ms), std::vector<int>{ 2 });
+
+    tw.cancel(1);
+    tw.cancel(100);
+    EXPECT_EQ(tw.size(), 0);
+}
+
+TEST(TimingWheel, DeadlinesOnEveryLevel)
+{
+    TimingWheel tw{ t0 };
+    std::vector<std::chrono::milliseconds> deadlines{ 63ms, 64ms, 4'095ms, 4'096ms, 300'000ms, 16'777'216ms, 40'000'000ms };
+
+    for (int i = 0; i < deadlines.size(); i++) tw.schedule(i, t0 + deadlines[i]);
+
+    for (int i = 0; i < deadlines.size(); i++)
+    {
+        EXPECT_TRUE(tw.advance(t0 + deadlines[i] - 1ms).empty()) << deadlines[i].count();
+        EXPECT_GT(tw.next_time_out(), 0);
+        EXPECT_LE(tw.next_time_out(), 1);
+        EXPECT_EQ(tw.advance(t0 + deadlines[i]), std::vector<int>{ i }) << deadlines[i].count();
+    }
+}
+
+TEST(TimingWheel, NextTimeOutNeverOvershoots)
+{
+    TimingWheel tw{ t0 };
+    tw.schedule(1, t0 + 1'000'000ms);
+    auto now = t0;
+
+    // Sleeping for whatever the wheel asks for must land exactly on the
+    // deadline, never after it.
+    while (tw.size())
+    {
+        int time_out = tw.next_time_out();
+        ASSERT_GT(time_out, 0);
+        now += std::chrono::milliseconds(time_out);
+        ASSERT_LE(now, t0 + 1'000'000ms);
+        tw.advance(now);
+    }
+
+    EXPECT_EQ(now, t0 + 1'000'000ms);
+}
+
+TEST(TimingWheel, MatchesBruteForce)
+{
+    std::mt19937 random{ 42 };
+    std::uniform_int_distribution<int> deadline{ 0, 40'000'000 };
+    std::uniform_int_distribution<int> step{ 1, 100'000 };
+
+    TimingWheel tw{ t0 };
+    std::vector<long> expected(500, -1);
+
+    for (int id = 0; id < expected.size(); id++)
+    {
+        expected[id] = deadline(random);
+        tw.schedule(id, t0 + std::chrono::milliseconds(expected[id]));
+    }
+
+    long now = 0;
+    while (now <= 40'000'000)
+    {
+        now += step(random);
+
+        // Rescheduling some entries from time to time.
+        int id = step(random) % expected.size();
+        if (expected[id] > now)
+        {
+            expected[id] = now + step(random);
+            tw.schedule(id, t0 + std::chrono::milliseconds(expected[id]));
+        }
+
+        std::vector<int> due{};
+        for (int i = 0; i < expected.size(); i++)
+        {
+            if (expected[i] >= 0 && expected[i] <= now)
+            {
+                due.push_back(i);
+                expected[i] = -1;
+            }
+        }
+
+        EXPECT_EQ(sorted(tw.advance(t0 + std::chrono::milliseconds(now))), due) << now;
+    }
+
+    EXPECT_EQ(tw.size(), 0);
+}